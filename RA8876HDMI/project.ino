@@ -16,6 +16,7 @@ const char* pass = "0987654321";
 #include "ra8876.h"
 #include "ra8876-config.h"
 #include "ra8876-implementation.h"
+#include "ra8876-damage.h"
 
 RA8876 tft = RA8876(RA8876_CS, RA8876_RESET);
 
@@ -86,67 +87,97 @@ bool fetchDepartures(int direction, char out[3][5][32], size_t &outCount) {
 }
 
 
-void printUtf8Safe(const char* str) {
-  while (*str) {
-    if ((uint8_t)str[0] == 0xC3) {
-      switch ((uint8_t)str[1]) {
-        case 0xA5: tft.putChar(0xE5); break;
-        case 0xA4: tft.putChar(0xE4); break;
-        case 0xB6: tft.putChar(0xF6); break;
-        case 0x85: tft.putChar(0xC5); break;
-        case 0x84: tft.putChar(0xC4); break;
-        case 0x96: tft.putChar(0xD6); break;
-        default:   tft.putChar('?');  break;
-      }
-      str += 2;
-    } else tft.putChar(*str++);
+// the board is a retained grid of text cells: each refresh only the cells
+// whose text changed are erased and redrawn
+RA8876Damage board(tft);
+
+// the board names its colours with a handful of palette indices. it is
+// engine drawn text and fills, whose bus traffic is the same at every
+// colour depth, so the sketch stays at 16bpp; only indexed bulk writes get
+// cheaper at 8bpp (test/test-palette.cpp measures both)
+enum Ink { INK_BACKGROUND, INK_TEXT, INK_LINE, INK_STALE };
+const Color inks[] = { Color::Black, Color::White, Color::Yellow, Color::Red };
+
+const uint16_t cols[]    = { 50, 150, 300, 600, 700 };
+const uint16_t widths[]  = { 100, 150, 300, 100, 300 };
+const char*    headers[] = { "LINE", "TYPE", "DESTINATION", "TIME", "ETA" };
+
+// the ETA column is right aligned
+const RA8876TextAlign aligns[] = { RA8876_TEXT_ALIGN_LEFT, RA8876_TEXT_ALIGN_LEFT, RA8876_TEXT_ALIGN_LEFT,
+                                   RA8876_TEXT_ALIGN_LEFT, RA8876_TEXT_ALIGN_RIGHT };
+
+int titleCell[2], headerCell[2][5], rowCell[2][3][5];
+
+void setupBoard() {
+  uint16_t y = 80;
+  for (int dir = 0; dir < 2; dir++) {
+    titleCell[dir] = board.addCell(50, y - 40, 1180, 40);
+    for (int c = 0; c < 5; c++) headerCell[dir][c] = board.addCell(cols[c], y, widths[c], 40, aligns[c]);
+    y += 40;
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 5; c++) rowCell[dir][r][c] = board.addCell(cols[c], y, widths[c], 40, aligns[c]);
+      y += 40;
+    }
+    y += 40;
+  }
+}
+
+void fillDirection(int dir, char departures[3][5][32], size_t count) {
+  char text[32], title[48];
+
+  // the API delivers UTF-8, the cells hold bytes of the font encoding
+  tft.transcodeUtf8(departures[0][2], text, sizeof(text));
+  snprintf(title, sizeof(title), "Riktning %s", text);
+  board.setText(titleCell[dir], title, tft.paletteColor(INK_TEXT));
+  for (int c = 0; c < 5; c++) board.setText(headerCell[dir][c], headers[c], tft.paletteColor(INK_TEXT));
+
+  for (size_t r = 0; r < 3; r++) {
+    for (int c = 0; c < 5; c++) {
+      if (r >= count) { board.setText(rowCell[dir][r][c], "", tft.paletteColor(INK_TEXT)); continue; }
+      tft.transcodeUtf8(departures[r][c], text, sizeof(text));
+      board.setText(rowCell[dir][r][c], text, tft.paletteColor((c == 0) ? INK_LINE : INK_TEXT));
+    }
   }
 }
 
 void showDepartures() {
   Serial.println("Updating display with new departure data...");
-  tft.clearScreen(Color::Black);
-  tft.setFont(RA8876_FONT_SIZE_32, RA8876_FONT_ENCODING_8859_1);
-  tft.setTextScale(1);
-  uint16_t cols[] = { 50, 150, 300, 600, 700 }, y = 80;
-
-  tft.setTextColor(Color::White);
-  tft.setTextCursor(50, y - 40); tft.print("Riktning "); printUtf8Safe(departuresDir2[0][2]);
-  tft.setTextCursor(cols[0], y); tft.print("LINE");
-  tft.setTextCursor(cols[1], y); tft.print("TYPE");
-  tft.setTextCursor(cols[2], y); tft.print("DESTINATION");
-  tft.setTextCursor(cols[3], y); tft.print("TIME");
-  tft.setTextCursor(cols[4], y); tft.print("ETA");
-
-  y += 40;
-  for (size_t i = 0; i < countDir2; i++) {
-    tft.setTextColor(Color::Yellow); tft.setTextCursor(cols[0], y); tft.print(departuresDir2[i][0]);
-    tft.setTextColor(Color::White);
-    tft.setTextCursor(cols[1], y); tft.print(departuresDir2[i][1]);
-    tft.setTextCursor(cols[2], y); printUtf8Safe(departuresDir2[i][2]);
-    tft.setTextCursor(cols[3], y); tft.print(departuresDir2[i][3]);
-    tft.setTextCursor(cols[4], y); tft.print(departuresDir2[i][4]);
-    y += 40;
-  }
+  fillDirection(0, departuresDir2, countDir2);
+  fillDirection(1, departuresDir1, countDir1);
 
-  y += 40;
-  tft.setTextCursor(50, y - 40); tft.print("Riktning "); printUtf8Safe(departuresDir1[0][2]);
-  tft.setTextCursor(cols[0], y); tft.print("LINE");
-  tft.setTextCursor(cols[1], y); tft.print("TYPE");
-  tft.setTextCursor(cols[2], y); tft.print("DESTINATION");
-  tft.setTextCursor(cols[3], y); tft.print("TIME");
-  tft.setTextCursor(cols[4], y); tft.print("ETA");
-
-  y += 40;
-  for (size_t i = 0; i < countDir1; i++) {
-    tft.setTextColor(Color::Yellow); tft.setTextCursor(cols[0], y); tft.print(departuresDir1[i][0]);
-    tft.setTextColor(Color::White);
-    tft.setTextCursor(cols[1], y); tft.print(departuresDir1[i][1]);
-    tft.setTextCursor(cols[2], y); printUtf8Safe(departuresDir1[i][2]);
-    tft.setTextCursor(cols[3], y); tft.print(departuresDir1[i][3]);
-    tft.setTextCursor(cols[4], y); tft.print(departuresDir1[i][4]);
-    y += 40;
-  }
+  // erase and redraw what changed, then show the finished frame
+  board.update();
+
+  RA8876DamageStats st = board.getStats();
+  Serial.print("Redrew "); Serial.print(st.cellsDrawn); Serial.print("/"); Serial.print(st.cells);
+  Serial.print(" cells in "); Serial.print(st.rects); Serial.print(" rects, ");
+  Serial.print(st.bytes); Serial.print(" bytes, "); Serial.print(st.us); Serial.print(" us (saved ");
+  Serial.print(st.bytesSaved); Serial.print(" bytes, "); Serial.print(st.usSaved); Serial.println(" us)");
+
+  RA8876TextCacheStats cs = tft.getTextCacheStats();
+  Serial.print("Text cache: "); Serial.print(cs.hits); Serial.print(" hits, ");
+  Serial.print(cs.misses); Serial.print(" misses, "); Serial.print(cs.evictions); Serial.println(" evictions");
+}
+
+// a "data stale" badge floats over the board in a PIP window; showing or
+// hiding it never touches the board itself
+void setupStaleBadge() {
+  const RA8876Surface *badge = tft.allocSurface(200, 40);
+  if (badge == NULL) return;
+
+  tft.setCanvas(badge);
+  tft.clearScreen(tft.paletteColor(INK_STALE));
+  tft.setTextColor(tft.paletteColor(INK_TEXT));
+  tft.setTextCursor(8, 4);
+  tft.print("DATA STALE");
+  tft.setCanvas(NULL);
+
+  tft.setPip(RA8876_PIP_1, badge, 1040, 0);
+}
+
+void showStale(bool stale) {
+  tft.waitForVBlank();
+  tft.showPip(RA8876_PIP_1, stale);
 }
 
 unsigned long lastUpdate = 0;
@@ -172,20 +203,38 @@ void setup() {
   Serial.println("TFT init success.");
 
   tft.setFont(RA8876_FONT_SIZE_32, RA8876_FONT_ENCODING_8859_1);
-  tft.clearScreen(Color::Black);
+  tft.setPalette(inks, sizeof(inks) / sizeof(inks[0]));
+  tft.clearScreen(tft.paletteColor(INK_BACKGROUND));
+  board.setBackground(tft.paletteColor(INK_BACKGROUND));
 
-  fetchDepartures(2, departuresDir2, countDir2);
-  fetchDepartures(1, departuresDir1, countDir1);
+  // draw off-screen, showDepartures() presents each complete update
+  tft.setDoubleBuffer(true);
+
+  // engine fills and copies are queued; the erase of one cell runs while
+  // the next command is prepared, present() waits for the last of them
+  tft.setAsync(true);
+  setupBoard();
+  setupStaleBadge();
+
+  bool ok = fetchDepartures(2, departuresDir2, countDir2);
+  ok = fetchDepartures(1, departuresDir1, countDir1) && ok;
   showDepartures();
+  showStale(!ok);
   lastUpdate = millis();
 }
 
 void loop() {
+  // hand any queued engine commands to the chip
+  tft.poll();
+
   if (millis() - lastUpdate > 30000) {
     Serial.println("Refreshing departure data...");
     if (fetchDepartures(2, departuresDir2, countDir2) &&
         fetchDepartures(1, departuresDir1, countDir1)) {
       showDepartures();
+      showStale(false);
+    } else {
+      showStale(true);
     }
     lastUpdate = millis();
   }
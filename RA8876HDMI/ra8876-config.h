@@ -11,7 +11,7 @@
 //--------------------------------------------------------------------------
 // RA8876RamInfo
 
-RA8876RamInfo defaultRamInfo =
+constexpr RA8876RamInfo defaultRamInfo =
 {
   165000,            // 165 MHz
   3,                 // CAS latency 3
@@ -30,7 +30,7 @@ RA8876RamInfo defaultRamInfo =
 //
 // 1366x768 (DMT)
 //
-RA8876DisplayInfo defaultDisplayInfo =
+constexpr RA8876DisplayInfo defaultDisplayInfo =
 {
   1366,   // display width
   768 ,   // display height
@@ -52,7 +52,7 @@ RA8876DisplayInfo defaultDisplayInfo =
 //
 // 1280x720 (CEA-861)
 //
-RA8876DisplayInfo defaultDisplayInfo =
+constexpr RA8876DisplayInfo defaultDisplayInfo =
 {
   1280,   // Display width
   720,    // Display height
@@ -73,7 +73,7 @@ RA8876DisplayInfo defaultDisplayInfo =
 //
 // 1280x720 (CVT)
 //
-RA8876DisplayInfo defaultDisplayInfo =
+constexpr RA8876DisplayInfo defaultDisplayInfo =
 {
   1280,   // Display width
   720,    // Display height
@@ -93,7 +93,7 @@ RA8876DisplayInfo defaultDisplayInfo =
 //
 // 1280x720 (CVT-RB)
 //
-RA8876DisplayInfo defaultDisplayInfo =
+constexpr RA8876DisplayInfo defaultDisplayInfo =
 {
   1280,   // Display width
   720,    // Display height
@@ -116,7 +116,7 @@ RA8876DisplayInfo defaultDisplayInfo =
 //
 // 1024x768 (CVT)
 //
-RA8876DisplayInfo defaultDisplayInfo =
+constexpr RA8876DisplayInfo defaultDisplayInfo =
 {
   1024,   // Display width
   768,    // Display height
@@ -137,7 +137,7 @@ RA8876DisplayInfo defaultDisplayInfo =
 //
 // 1024x768 (CVT-RB)
 //
-RA8876DisplayInfo defaultDisplayInfo =
+constexpr RA8876DisplayInfo defaultDisplayInfo =
 {
   1024,   // Display width
   768,    // Display height
@@ -157,7 +157,7 @@ RA8876DisplayInfo defaultDisplayInfo =
 //
 // 1024x768 (DMT)
 //
-RA8876DisplayInfo defaultDisplayInfo =
+constexpr RA8876DisplayInfo defaultDisplayInfo =
 {
   1024,   // Display width
   768,    // Display height
@@ -180,7 +180,7 @@ RA8876DisplayInfo defaultDisplayInfo =
 //
 // 1024x600 (CVT)
 //
-RA8876DisplayInfo defaultDisplayInfo =
+constexpr RA8876DisplayInfo defaultDisplayInfo =
 {
   1024,   // Display width
   600,    // Display height
@@ -201,7 +201,7 @@ RA8876DisplayInfo defaultDisplayInfo =
 //
 // 1024x600 (CVT-RB)
 //
-RA8876DisplayInfo defaultDisplayInfo =
+constexpr RA8876DisplayInfo defaultDisplayInfo =
 {
   1024,   // Display width
   600,    // Display height
@@ -225,7 +225,7 @@ RA8876DisplayInfo defaultDisplayInfo =
 //
 // 800x600 (CVT)
 //
-RA8876DisplayInfo defaultDisplayInfo =
+constexpr RA8876DisplayInfo defaultDisplayInfo =
 {
   800,    // display width
   600,    // display height
@@ -245,7 +245,7 @@ RA8876DisplayInfo defaultDisplayInfo =
 //
 // 800x600 (CVT-RB)
 //
-RA8876DisplayInfo defaultDisplayInfo =
+constexpr RA8876DisplayInfo defaultDisplayInfo =
 {
   800,    // display width
   600,    // display height
@@ -266,7 +266,7 @@ RA8876DisplayInfo defaultDisplayInfo =
 //
 // 800x600 (DMT)
 //
-RA8876DisplayInfo defaultDisplayInfo =
+constexpr RA8876DisplayInfo defaultDisplayInfo =
 {
   800,    // display width
   600,    // display height
@@ -288,3 +288,25 @@ RA8876DisplayInfo defaultDisplayInfo =
 #endif
 
 //--------------------------------------------------------------------------
+// RA8876Clocks, RA8876DisplayTiming
+//
+// solved at compile time; an unusable configuration fails the build
+
+constexpr RA8876Clocks        defaultClocks        = ra8876Clocks(RA8876_OSC_CLOCK, defaultRamInfo.freq, defaultDisplayInfo.dotClock);
+constexpr RA8876DisplayTiming defaultDisplayTiming = ra8876DisplayTiming(defaultDisplayInfo);
+
+static_assert(defaultClocks.mem.k  != 0, "RA8876: no PLL parameters for the memory clock");
+static_assert(defaultClocks.core.k != 0, "RA8876: no PLL parameters for the core clock");
+static_assert(defaultClocks.scan.k != 0, "RA8876: no PLL parameters for the scan (dot) clock");
+
+// Data sheet section 6.1.1 rules:
+// 1. Core clock must be less than or equal to mem clock
+// 2. Core clock must be greater than half mem clock
+// 3. Core clock must be greater than (scan clock * 1.5)
+static_assert( defaultClocks.core.freq      <=  defaultClocks.mem.freq,  "RA8876: core clock exceeds the memory clock");
+static_assert((defaultClocks.core.freq * 2) >   defaultClocks.mem.freq,  "RA8876: core clock not above half the memory clock");
+static_assert( defaultClocks.core.freq      >  (defaultClocks.scan.freq + (defaultClocks.scan.freq >> 1)), "RA8876: core clock not above 1.5x the scan clock");
+
+static_assert(ra8876DisplayTimingValid(defaultDisplayInfo), "RA8876: display timing does not fit the timing registers");
+
+//--------------------------------------------------------------------------
@@ -0,0 +1,364 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+// RA8876 :: DAMAGE TRACKING
+//--------------------------------------------------------------------------
+
+// a retained grid of text cells on top of RA8876: the application sets
+// the content of every cell each refresh and update() only touches the
+// cells that differ from what was drawn last time. the boxes of changed
+// cells are merged into as few rectangles as possible, erased with
+// fillRectangle() and the new text is drawn into them from the text
+// cache (drawCachedText), clipped to its cell when it is too long.
+//
+//   RA8876Damage board(tft);
+//
+//   int eta = board.addCell(700, 120, 200, 40, RA8876_TEXT_ALIGN_RIGHT);
+//   ...
+//   board.setText(eta, "3 min", Color::White);
+//   board.update();
+
+#ifndef RA8876_DAMAGE_CELLS
+#define RA8876_DAMAGE_CELLS               48    // cells in the grid
+#endif
+
+#ifndef RA8876_DAMAGE_TEXT
+#define RA8876_DAMAGE_TEXT                32    // bytes of text per cell (including the terminator)
+#endif
+
+//--------------------------------------------------------------------------
+// RA8876DamageStats
+
+struct RA8876DamageStats
+{
+  uint16_t cells;       // cells in the grid
+  uint16_t cellsDrawn;  // cells redrawn by the last update
+  uint16_t rects;       // erase rectangles after merging
+
+  uint32_t bytes;       // SPI bytes used by the last update
+  uint32_t us;          // time taken by the last update
+  uint32_t bytesSaved;  // compared to the last full redraw
+  uint32_t usSaved;
+};
+
+//--------------------------------------------------------------------------
+// RA8876DamageCell
+
+struct RA8876DamageCell
+{
+  uint16_t x, y;        // box the cell owns on screen
+  uint16_t w, h;
+  uint8_t  align;       // RA8876TextAlign within the box
+
+  char     text [RA8876_DAMAGE_TEXT];   // wanted content
+  Color    color;
+  char     drawn[RA8876_DAMAGE_TEXT];   // content on screen
+  Color    drawnColor;
+  bool     dirty;       // redraw regardless of content
+};
+
+//--------------------------------------------------------------------------
+// RA8876DamageRect
+
+struct RA8876DamageRect
+{
+  uint16_t x1, y1;      // inclusive
+  uint16_t x2, y2;
+};
+
+//--------------------------------------------------------------------------
+// RA8876Damage
+
+class RA8876Damage
+{
+  private:
+    RA8876            &m_tft;
+    Color              m_background;
+
+    RA8876DamageCell   m_cells[RA8876_DAMAGE_CELLS];
+    int                m_cellCount;
+    RA8876DamageRect   m_rects[RA8876_DAMAGE_CELLS];
+    int                m_rectCount;
+
+    RA8876DamageStats  m_stats;
+    uint32_t           m_fullBytes;    // cost of the last full redraw
+    uint32_t           m_fullUs;
+
+    bool               changed(const RA8876DamageCell &c);
+    bool               mergeable(const RA8876DamageRect &a, const RA8876DamageRect &b);
+    void               merge();
+
+  public:
+    RA8876Damage(RA8876 &tft);
+
+    // grid
+    int                addCell(uint16_t x, uint16_t y, uint16_t w, uint16_t h, RA8876TextAlign align = RA8876_TEXT_ALIGN_LEFT);
+    void               setBackground(Color color);
+    void               setText(int cell, const char *text, Color color);
+
+    // forced redraw
+    void               invalidate();
+    void               invalidate(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+    // redraw what changed
+    RA8876Error        update();
+    RA8876DamageStats  getStats();
+};
+
+//--------------------------------------------------------------------------
+// RA8876Damage :: IMPLEMENTATION
+//--------------------------------------------------------------------------
+
+RA8876Damage::RA8876Damage(RA8876 &tft)
+  : m_tft(tft)
+{
+  m_background = Color::Black;
+  m_cellCount  = 0;
+  m_rectCount  = 0;
+  m_fullBytes  = 0;
+  m_fullUs     = 0;
+  memset(&m_stats, 0, sizeof(m_stats));
+}
+
+//--------------------------------------------------------------------------
+// grid
+
+int
+RA8876Damage::addCell(uint16_t x, uint16_t y, uint16_t w, uint16_t h, RA8876TextAlign align)
+{
+  RA8876DamageCell *c;
+
+  if ((m_cellCount == RA8876_DAMAGE_CELLS) || (w == 0) || (h == 0)) return -1;
+
+  c = &m_cells[m_cellCount];
+  c->x          = x;
+  c->y          = y;
+  c->w          = w;
+  c->h          = h;
+  c->align      = align;
+  c->text[0]    = 0;
+  c->color      = Color::White;
+  c->drawn[0]   = 0;
+  c->drawnColor = Color::White;
+  c->dirty      = true;         // the screen content is unknown
+
+  return m_cellCount++;
+}
+
+void
+RA8876Damage::setBackground(Color color)
+{
+  m_background = color;
+  invalidate();
+}
+
+void
+RA8876Damage::setText(int cell, const char *text, Color color)
+{
+  RA8876DamageCell *c;
+
+  if ((cell < 0) || (cell >= m_cellCount)) return;
+
+  c = &m_cells[cell];
+  snprintf(c->text, RA8876_DAMAGE_TEXT, "%s", (text != NULL) ? text : "");
+  c->color = color;
+}
+
+//--------------------------------------------------------------------------
+// forced redraw
+
+void
+RA8876Damage::invalidate()
+{
+  for (int i=0; i<m_cellCount; i++)
+    m_cells[i].dirty = true;
+}
+
+void
+RA8876Damage::invalidate(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+  for (int i=0; i<m_cellCount; i++)
+  {
+    RA8876DamageCell *c = &m_cells[i];
+    if (((uint32_t)c->x + c->w > x) && ((uint32_t)x + w > c->x) &&
+        ((uint32_t)c->y + c->h > y) && ((uint32_t)y + h > c->y))
+      c->dirty = true;
+  }
+}
+
+//--------------------------------------------------------------------------
+// redraw what changed
+
+bool
+RA8876Damage::changed(const RA8876DamageCell &c)
+{
+  // colour only matters when there is something to see
+  return c.dirty || (strcmp(c.text, c.drawn) != 0) ||
+         ((c.text[0] != 0) && ((c.color.r != c.drawnColor.r) ||
+                               (c.color.g != c.drawnColor.g) ||
+                               (c.color.b != c.drawnColor.b)));
+}
+
+// two rectangles merge only when their union covers no extra pixels;
+// erasing outside the damaged cells would wipe unchanged content
+bool
+RA8876Damage::mergeable(const RA8876DamageRect &a, const RA8876DamageRect &b)
+{
+  // same rows, touching or overlapping columns
+  if ((a.y1 == b.y1) && (a.y2 == b.y2))
+    return ((uint32_t)a.x2 + 1 >= b.x1) && ((uint32_t)b.x2 + 1 >= a.x1);
+
+  // same columns, touching or overlapping rows
+  if ((a.x1 == b.x1) && (a.x2 == b.x2))
+    return ((uint32_t)a.y2 + 1 >= b.y1) && ((uint32_t)b.y2 + 1 >= a.y1);
+
+  return false;
+}
+
+void
+RA8876Damage::merge()
+{
+  bool merged;
+
+  do
+  {
+    merged = false;
+    for (int i=0; i<m_rectCount; i++)
+    {
+      for (int j=i+1; j<m_rectCount; j++)
+      {
+        if (!mergeable(m_rects[i], m_rects[j])) continue;
+
+        if (m_rects[j].x1 < m_rects[i].x1) m_rects[i].x1 = m_rects[j].x1;
+        if (m_rects[j].y1 < m_rects[i].y1) m_rects[i].y1 = m_rects[j].y1;
+        if (m_rects[j].x2 > m_rects[i].x2) m_rects[i].x2 = m_rects[j].x2;
+        if (m_rects[j].y2 > m_rects[i].y2) m_rects[i].y2 = m_rects[j].y2;
+
+        m_rects[j] = m_rects[--m_rectCount];
+        merged = true;
+        j--;
+      }
+    }
+  }
+  while (merged);
+}
+
+RA8876Error
+RA8876Damage::update()
+{
+  RA8876Error err;
+  uint32_t    start, bytes;
+  bool        todo[RA8876_DAMAGE_CELLS];
+  int         i, n;
+
+  // default return value
+  err = RA8876_OK;
+
+  start = micros();
+  bytes = m_tft.getSpiStats().bytes;
+
+  // find the damage
+  n           = 0;
+  m_rectCount = 0;
+  for (i=0; i<m_cellCount; i++)
+  {
+    RA8876DamageCell *c = &m_cells[i];
+
+    todo[i] = changed(*c);
+    if (!todo[i]) continue;
+
+    m_rects[m_rectCount].x1 = c->x;
+    m_rects[m_rectCount].y1 = c->y;
+    m_rects[m_rectCount].x2 = c->x + c->w - 1;
+    m_rects[m_rectCount].y2 = c->y + c->h - 1;
+    m_rectCount++;
+    n++;
+  }
+
+  m_stats.cells      = m_cellCount;
+  m_stats.cellsDrawn = n;
+  if (n == 0)
+  {
+    m_stats.rects      = 0;
+    m_stats.bytes      = 0;
+    m_stats.us         = 0;
+    m_stats.bytesSaved = m_fullBytes;
+    m_stats.usSaved    = m_fullUs;
+    return err;
+  }
+
+  // erase
+  merge();
+  for (i=0; (i<m_rectCount) && (err == RA8876_OK); i++)
+    err = m_tft.fillRectangle(m_rects[i].x1, m_rects[i].y1, m_rects[i].x2, m_rects[i].y2, m_background);
+
+  // redraw
+  for (i=0; (i<m_cellCount) && (err == RA8876_OK); i++)
+  {
+    RA8876DamageCell *c = &m_cells[i];
+    if (!todo[i]) continue;
+
+    if (c->text[0] != 0)
+    {
+      // the text width is known up front, alignment costs nothing
+      uint16_t tw  = m_tft.getTextWidth(c->text);
+      uint16_t off = 0;
+      if (tw < c->w)
+      {
+        if (c->align == RA8876_TEXT_ALIGN_RIGHT)  off = c->w - tw;
+        if (c->align == RA8876_TEXT_ALIGN_CENTER) off = (c->w - tw) / 2;
+      }
+
+      m_tft.setTextColor(c->color);
+      if (tw <= c->w) err = m_tft.drawCachedText(c->x + off, c->y, c->text);
+      else
+      {
+        // too long for its box: cut off at the edge of the cell
+        RA8876Rect box = { c->x, c->y, c->w, c->h };
+        err = m_tft.pushClip(box);
+        if (err == RA8876_OK)
+        {
+          err = m_tft.drawCachedText(c->x, c->y, c->text);
+          RA8876Error pop = m_tft.popClip();
+          if (err == RA8876_OK) err = pop;
+        }
+      }
+      if (err != RA8876_OK) break;
+    }
+
+    memcpy(c->drawn, c->text, RA8876_DAMAGE_TEXT);
+    c->drawnColor = c->color;
+    c->dirty      = false;
+  }
+
+  // show it; the shown page is copied back so the next update starts
+  // from what is on screen (no-op without double buffering)
+  if (err == RA8876_OK) err = m_tft.present(true);
+
+  m_stats.rects = m_rectCount;
+  m_stats.bytes = m_tft.getSpiStats().bytes - bytes;
+  m_stats.us    = micros() - start;
+
+  // a full redraw is the baseline for the savings
+  if (n == m_cellCount)
+  {
+    m_fullBytes = m_stats.bytes;
+    m_fullUs    = m_stats.us;
+  }
+  m_stats.bytesSaved = (m_fullBytes > m_stats.bytes) ? (m_fullBytes - m_stats.bytes) : 0;
+  m_stats.usSaved    = (m_fullUs    > m_stats.us)    ? (m_fullUs    - m_stats.us)    : 0;
+
+  return err;
+}
+
+RA8876DamageStats
+RA8876Damage::getStats()
+{
+  return m_stats;
+}
+
+//--------------------------------------------------------------------------
@@ -0,0 +1,1267 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+// RA8876 :: HOST EMULATOR
+//--------------------------------------------------------------------------
+
+// a host (Linux) build of the driver: this file replaces Arduino.h, SPI.h
+// and ra8876.h, and attaches the driver to a register level model of the
+// RA8876 instead of real hardware.
+//
+//   #define RA8876_CONFIG       RA8876_CONFIG_1280x720
+//   #define RA8876_COLOR_DEPTH  16
+//   #define RA8876_SPI_SPEED    1000000
+//   #define RA8876_CS           10
+//   #define RA8876_RESET        2
+//
+//   #include "ra8876-host.h"
+//   #include "ra8876-config.h"
+//   #include "ra8876-implementation.h"
+//
+// the model covers the register file, canvas memory (SDRAM), the geometry
+// engine, BTE memory copy/solid fill, text mode cursor advance and the
+// status register and the INT output; the refresh (vertical sync and the
+// blank after it) follows the programmed display timing and scan clock,
+// and scanShift moves it against the host clock to model drift.
+// time is virtual: it advances with every SPI byte, chip-select toggle
+// and delay, and engine operations keep the chip busy for a time
+// proportional to the pixels they touch. the main window can be written
+// out as a PPM image or hashed for pixel exact comparisons.
+//
+// the SPI framing follows the datasheet: the first byte of a chip-select
+// frame is the cycle type and every byte after it is payload of that type.
+// frames the chip would take differently from what the driver meant (a
+// command frame selecting more than one register, a data stream into
+// anything but the memory port) are counted in protocolErrors.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+//--------------------------------------------------------------------------
+// Arduino compatibility
+
+#define LOW                               0
+#define HIGH                              1
+#define INPUT                             0
+#define OUTPUT                            1
+#define INPUT_PULLUP                      2
+#define CHANGE                            1
+#define FALLING                           2
+#define RISING                            3
+#define MSBFIRST                          1
+#define SPI_MODE3                         3
+
+#define constrain(x, lo, hi)              ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+#define digitalPinToInterrupt(p)          (p)
+
+void          pinMode(int pin, int mode);
+void          digitalWrite(int pin, int value);
+int           digitalRead(int pin);
+void          delay(unsigned long ms);
+void          delayMicroseconds(unsigned int us);
+unsigned long millis();
+unsigned long micros();
+void          yield();
+void          attachInterrupt(int irq, void (*isr)(), int mode);
+void          detachInterrupt(int irq);
+
+class Print
+{
+  private:
+    int             m_writeError;
+
+  protected:
+    void            setWriteError(int err = 1) { m_writeError = err; }
+
+  public:
+    Print() : m_writeError(0) {}
+    virtual ~Print() {}
+
+    int             getWriteError()   { return m_writeError; }
+    void            clearWriteError() { m_writeError = 0; }
+
+    virtual size_t  write(uint8_t c) = 0;
+    virtual size_t  write(const uint8_t *buf, size_t sz)
+    {
+      size_t n = 0;
+      while (sz--) n += write(*buf++);
+      return n;
+    }
+
+    size_t          write(const char *str)          { return write((const uint8_t *)str, strlen(str)); }
+    size_t          print(const char *str)          { return write(str); }
+    size_t          print(char c)                   { return write((uint8_t)c); }
+    size_t          print(long v)                   { char b[24]; snprintf(b, sizeof(b), "%ld", v); return write(b); }
+    size_t          print(unsigned long v)          { char b[24]; snprintf(b, sizeof(b), "%lu", v); return write(b); }
+    size_t          print(int v)                    { return print((long)v); }
+    size_t          print(unsigned int v)           { return print((unsigned long)v); }
+    size_t          println()                       { return write("\r\n"); }
+    template <typename T>
+    size_t          println(T v)                    { size_t n = print(v); return n + println(); }
+};
+
+struct SPISettings
+{
+  uint32_t clock;
+
+  SPISettings() : clock(4000000) {}
+  SPISettings(uint32_t clk, int order, int mode) : clock(clk) { (void)order; (void)mode; }
+};
+
+class SPIClass
+{
+  public:
+    void            begin() {}
+    void            end()   {}
+    void            beginTransaction(SPISettings settings);
+    void            endTransaction() {}
+    uint8_t         transfer(uint8_t x);
+    void            transfer(void *buf, size_t count);
+};
+
+extern SPIClass SPI;
+
+//--------------------------------------------------------------------------
+// driver foundations
+
+#include "ra8876.h"
+
+//--------------------------------------------------------------------------
+// RA8876Emulator
+
+class RA8876Emulator
+{
+  public:
+
+    // wiring
+    int                  csPin;
+    int                  resetPin;
+    int                  intPin;
+
+    // timing model (ns)
+    uint64_t             now;              // virtual time
+    uint32_t             spiClock;         // Hz
+    uint32_t             transferOverhead; // per SPI.transfer() call
+    uint32_t             pinOverhead;      // per digitalWrite()
+    uint32_t             pixelTime;        // per pixel touched by an engine
+    uint32_t             yieldTime;        // per yield() (host busy loop)
+    uint32_t             frameTime;        // panel refresh period (vsync interval)
+    uint32_t             blankTime;        // blanking at the start of every period
+    int64_t              scanShift;        // refresh ahead of virtual time (drift against the host clock)
+    uint32_t             fifoDepth;        // host memory write FIFO entries (text mode)
+    uint32_t             coreClock;        // Hz, CCLK (serial flash clock source)
+
+    // bus statistics (as seen by the chip)
+    uint32_t             spiBytes;
+    uint32_t             spiFrames;
+    uint32_t             spiTransfers;
+    uint32_t             statusReads;      // status read frames
+    uint32_t             protocolErrors;   // frames the chip does not take the way the driver meant them
+
+    // interrupt line (attachInterrupt)
+    void               (*isr)();
+    int                  isrMode;
+    uint32_t             interrupts;       // ISR invocations
+
+    // chip state
+    uint8_t              reg[256];
+    uint8_t              pip[2][RA8876_REG_PWH1 - RA8876_REG_PWDULX0 + 1];   // PIP1/PIP2 register sets
+    std::vector<uint8_t> sdram;
+    std::vector<uint8_t> flash[2];         // serial flash/ROM 0 and 1 (erased beyond the end)
+
+    RA8876Emulator(int cs = -1, int rst = -1, int irq = -1)
+    {
+      csPin            = cs;
+      resetPin         = rst;
+      intPin           = irq;
+      isr              = NULL;
+      isrMode          = FALLING;
+      interrupts       = 0;
+
+      now              = 0;
+      spiClock         = 4000000;
+      transferOverhead = 500;
+      pinOverhead      = 1000;
+      pixelTime        = 10;
+      yieldTime        = 1000;
+      frameTime        = 16666667;         // 60 Hz until the display timing is set
+      blankTime        = 0;
+      scanShift        = 0;
+      fifoDepth        = 16;
+      coreClock        = 100000000;
+
+      sdram.assign(8 * 1024 * 1024L, 0);
+      resetStats();
+      reset();
+    }
+
+    void
+    reset()
+    {
+      memset(reg, 0, sizeof(reg));
+      memset(pip, 0, sizeof(pip));
+      m_selected  = false;
+      m_frameLen  = 0;
+      m_frameType = 0;
+      m_cmd       = 0;
+      m_busyUntil = 0;
+      m_fifoUntil = 0;
+      m_fifoChar  = 0;
+      m_pixelLen  = 0;
+      m_cexpLeft  = 0;
+      m_task      = false;
+      m_dma       = false;
+      m_intLine   = HIGH;
+      m_frame     = scanTime() / frameTime;
+    }
+
+    void
+    resetStats()
+    {
+      spiBytes       = 0;
+      spiFrames      = 0;
+      spiTransfers   = 0;
+      statusReads    = 0;
+      protocolErrors = 0;
+    }
+
+    //----------------------------------------------------------------------
+    // bus interface
+
+    void
+    chipSelect(bool selected)
+    {
+      if (!selected && m_selected) frameEnd();
+      if (selected && !m_selected)
+      {
+        m_frameLen  = 0;
+        m_frameType = 0;
+        spiFrames++;
+      }
+      m_selected = selected;
+    }
+
+    // advance the INT output to the current time; a completed engine task
+    // or the start of a frame raises INTF and an enabled, unmasked flag
+    // pulls the line low
+    void
+    tick()
+    {
+      int line;
+
+      if (m_task && !busy())
+      {
+        m_task = false;
+        reg[RA8876_REG_INTF] |= m_dma ? RA8876_REG_INT_DMA : RA8876_REG_INT_CORE;
+        m_dma  = false;
+      }
+
+      // a new frame starts with vertical sync
+      if ((scanTime() / frameTime) != m_frame)
+      {
+        m_frame = scanTime() / frameTime;
+        reg[RA8876_REG_INTF] |= RA8876_REG_INT_VSYNC;
+      }
+
+      line = (reg[RA8876_REG_INTF] & reg[RA8876_REG_INTEN] & ~reg[RA8876_REG_MINTFR]) ? LOW : HIGH;
+      if ((line != m_intLine) && (isr != NULL))
+      {
+        if ((isrMode == CHANGE) ||
+            ((isrMode == FALLING) && (line == LOW)) ||
+            ((isrMode == RISING)  && (line == HIGH)))
+        {
+          interrupts++;
+          isr();
+        }
+      }
+      m_intLine = line;
+    }
+
+    int intLine() { return m_intLine; }
+
+    uint8_t
+    exchange(uint8_t x)
+    {
+      uint8_t r = 0;
+
+      now += (8000000000ULL / spiClock);
+      spiBytes++;
+      tick();
+      if (!m_selected) return 0xff;
+
+      if (m_frameLen == 0)
+      {
+        // the first byte of the frame is the cycle type, every byte after
+        // it is payload of that type
+        m_frameType = x;
+        if (x == RA8876_STATUS_READ) statusReads++;
+      }
+      else
+      if (m_frameType == RA8876_STATUS_READ)
+      {
+        r = status();
+      }
+      else
+      if (m_frameType == RA8876_DATA_READ)
+      {
+        r = dataRead();
+      }
+      else
+      if (m_frameType == RA8876_DATA_WRITE)
+      {
+        dataWrite(x);
+      }
+      else
+      if (m_frameType == RA8876_CMD_WRITE)
+      {
+        m_cmd = x;
+      }
+
+      m_frameLen++;
+      return r;
+    }
+
+    //----------------------------------------------------------------------
+    // inspection
+
+    uint16_t displayWidth()  { return ((reg[RA8876_REG_HDWR] + 1) * 8) + (reg[RA8876_REG_HDWFTR] & 0x07); }
+    uint16_t displayHeight() { return (reg16(RA8876_REG_VDHR0) & 0x7ff) + 1; }
+    bool     busy()          { return now < m_busyUntil; }
+
+    // scan position: a period starts with vertical sync, as the last
+    // visible pixel has gone out, and the blank runs up to the first one
+    uint64_t scanTime()      { return (uint64_t)((int64_t)now + scanShift); }
+    bool     inBlank()       { return (scanTime() % frameTime) < blankTime; }
+    uint32_t blankLeft()     { return inBlank() ? (uint32_t)(blankTime - (scanTime() % frameTime)) : 0; }
+
+    // read a pixel of the main window as 0x00RRGGBB
+    uint32_t
+    mainPixel(uint16_t x, uint16_t y)
+    {
+      int      bpp  = depthBytes((reg[RA8876_REG_MPWCTR] >> 2) & 0x03);
+      // the low two bits of the image width and window X are tied to 0
+      uint32_t addr = reg32(RA8876_REG_MISA0) +
+                      (((uint32_t)(y + reg16(RA8876_REG_MWULY0)) * (reg16(RA8876_REG_MIW0) & ~3)) +
+                                   (x + (reg16(RA8876_REG_MWULX0) & ~3))) * bpp;
+      uint8_t  r, g, b;
+
+      unpack(readPixel(addr, bpp), bpp, &r, &g, &b);
+      return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+
+    // read a pixel as scanned out: PIP1 above PIP2 above the main window
+    uint32_t
+    screenPixel(uint16_t x, uint16_t y)
+    {
+      static const uint8_t enable[2] = { RA8876_REG_MPWCTR_PIP1_MASK, RA8876_REG_MPWCTR_PIP2_MASK };
+
+      for (int i = 0; i < 2; i++)
+      {
+        if ((reg[RA8876_REG_MPWCTR] & enable[i]) == 0) continue;
+
+        int px = pip16(i, RA8876_REG_PWDULX0) & ~3;
+        int py = pip16(i, RA8876_REG_PWDULY0);
+        if ((x < px) || (x >= (px + (pip16(i, RA8876_REG_PWW0) & ~3))) ||
+            (y < py) || (y >= (py + pip16(i, RA8876_REG_PWH0)))) continue;
+
+        int      bpp  = depthBytes((reg[RA8876_REG_PIPCDEP] >> ((i == 0) ? 2 : 0)) & 0x03);
+        uint32_t addr = pip32(i, RA8876_REG_PISA0) +
+                        (((uint32_t)(y - py + pip16(i, RA8876_REG_PWIULY0)) * (pip16(i, RA8876_REG_PIW0) & ~3)) +
+                                     (x - px + (pip16(i, RA8876_REG_PWIULX0) & ~3))) * bpp;
+        uint8_t  r, g, b;
+
+        unpack(readPixel(addr, bpp), bpp, &r, &g, &b);
+        return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+      }
+
+      return mainPixel(x, y);
+    }
+
+    // FNV-1a hash of the visible screen, for pixel exact comparisons
+    uint32_t
+    frameHash()
+    {
+      uint32_t h = 2166136261UL;
+      for (uint16_t y = 0; y < displayHeight(); y++)
+        for (uint16_t x = 0; x < displayWidth(); x++)
+        {
+          uint32_t p = screenPixel(x, y);
+          for (int i = 0; i < 3; i++)
+          {
+            h ^= (p >> (i * 8)) & 0xff;
+            h *= 16777619UL;
+          }
+        }
+      return h;
+    }
+
+    // write the visible screen as a binary PPM (P6) image
+    bool
+    dumpPPM(const char *path)
+    {
+      FILE *f = fopen(path, "wb");
+      if (f == NULL) return false;
+
+      fprintf(f, "P6\n%d %d\n255\n", displayWidth(), displayHeight());
+      for (uint16_t y = 0; y < displayHeight(); y++)
+        for (uint16_t x = 0; x < displayWidth(); x++)
+        {
+          uint32_t p = screenPixel(x, y);
+          fputc((p >> 16) & 0xff, f);
+          fputc((p >>  8) & 0xff, f);
+          fputc( p        & 0xff, f);
+        }
+
+      fclose(f);
+      return true;
+    }
+
+  private:
+
+    bool                 m_selected;
+    uint32_t             m_frameLen;
+    uint8_t              m_frameType;
+    uint8_t              m_cmd;
+    uint64_t             m_busyUntil;      // core task (draw/BTE) busy
+    uint64_t             m_fifoUntil;      // host write FIFO draining
+    uint64_t             m_fifoChar;       // time to render the last character
+    uint8_t              m_pixel[3];       // partial pixel from the memory port
+    uint8_t              m_pixelLen;
+    uint32_t             m_cexpLeft;       // colour expansion pixels still to come
+    int                  m_cexpX;
+    int                  m_cexpY;
+    bool                 m_task;           // engine task running (INTF on completion)
+    bool                 m_dma;            // the task is a serial flash DMA
+    int                  m_intLine;
+    uint64_t             m_frame;          // vsync count
+
+    //----------------------------------------------------------------------
+    // display timing
+
+    // the refresh follows the timing registers and the scan clock PLL
+    // (data sheet 19.5 and 6.1.2) once they describe a display
+    void
+    scanTiming()
+    {
+      uint64_t clk, width, height, hTotal, vTotal;
+
+      clk    = ((uint64_t)RA8876_OSC_CLOCK * (reg[RA8876_REG_PPLLC2] + 1)) >> ((reg[RA8876_REG_PPLLC1] >> 1) & 0x07);
+      width  = displayWidth();
+      height = displayHeight();
+      hTotal = width + ((reg[RA8876_REG_HNDR] & 0x1f) + 1) * 8 + (reg[RA8876_REG_HNDFTR] & 0x0f) +
+                       ((reg[RA8876_REG_HSTR] & 0x1f) + 1) * 8 +
+                       ((reg[RA8876_REG_HPWR] & 0x1f) + 1) * 8;
+      vTotal = height + (reg16(RA8876_REG_VNDR0) & 0x3ff) + 1 +
+                        reg[RA8876_REG_VSTR] + 1 +
+                        (reg[RA8876_REG_VPWR] & 0x3f) + 1;
+      if ((reg[RA8876_REG_PPLLC2] == 0) || (clk == 0)) return;
+
+      // clk is in kHz, the periods in ns
+      frameTime = (uint32_t)((hTotal * vTotal * 1000000) / clk);
+      blankTime = (uint32_t)((((vTotal - height) * hTotal + (hTotal - width)) * 1000000) / clk);
+      m_frame   = scanTime() / frameTime;
+    }
+
+    //----------------------------------------------------------------------
+    // register helpers
+
+    uint16_t reg16(uint8_t r) { return reg[r] | ((uint16_t)reg[r + 1] << 8); }
+    uint32_t reg32(uint8_t r) { return reg16(r) | ((uint32_t)reg16(r + 2) << 16); }
+
+    // PIP register sets, indexed by the register address
+    uint16_t pip16(int i, uint8_t r) { r -= RA8876_REG_PWDULX0; return pip[i][r] | ((uint16_t)pip[i][r + 1] << 8); }
+    uint32_t pip32(int i, uint8_t r) { return pip16(i, r) | ((uint32_t)pip16(i, r + 2) << 16); }
+    int      pipSelected()           { return (reg[RA8876_REG_MPWCTR] & RA8876_REG_MPWCTR_PIPC_MASK) ? 1 : 0; }
+
+    void
+    set16(uint8_t r, uint16_t v)
+    {
+      reg[r]     =  v       & 0xff;
+      reg[r + 1] = (v >> 8) & 0xff;
+    }
+
+    //----------------------------------------------------------------------
+    // pixel helpers
+
+    static int
+    depthBytes(int code)
+    {
+      return (code == 0) ? 1 : ((code == 1) ? 2 : 3);
+    }
+
+    uint32_t
+    readPixel(uint32_t addr, int bpp)
+    {
+      uint32_t v = 0;
+      for (int i = 0; i < bpp; i++)
+        if ((addr + i) < sdram.size()) v |= (uint32_t)sdram[addr + i] << (i * 8);
+      return v;
+    }
+
+    void
+    writePixel(uint32_t addr, int bpp, uint32_t v)
+    {
+      for (int i = 0; i < bpp; i++)
+        if ((addr + i) < sdram.size()) sdram[addr + i] = (v >> (i * 8)) & 0xff;
+    }
+
+    static uint32_t
+    pack(uint8_t r, uint8_t g, uint8_t b, int bpp)
+    {
+      if (bpp == 1) return (r & 0xe0) | ((g & 0xe0) >> 3) | (b >> 6);
+      if (bpp == 2) return ((uint32_t)(r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3);
+      return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+
+    static void
+    unpack(uint32_t v, int bpp, uint8_t *r, uint8_t *g, uint8_t *b)
+    {
+      if (bpp == 1)
+      {
+        *r = (v & 0xe0); *r |= (*r >> 3) | (*r >> 6);
+        *g = (v & 0x1c) << 3; *g |= (*g >> 3) | (*g >> 6);
+        *b = (v & 0x03) << 6; *b |= (*b >> 2) | (*b >> 4) | (*b >> 6);
+      }
+      else
+      if (bpp == 2)
+      {
+        *r = (v >> 8) & 0xf8; *r |= *r >> 5;
+        *g = (v >> 3) & 0xfc; *g |= *g >> 6;
+        *b = (v << 3) & 0xf8; *b |= *b >> 5;
+      }
+      else
+      {
+        *r = (v >> 16) & 0xff;
+        *g = (v >>  8) & 0xff;
+        *b =  v        & 0xff;
+      }
+    }
+
+    //----------------------------------------------------------------------
+    // canvas (geometry engine, text and memory port target)
+
+    int canvasBytes() { return depthBytes(reg[RA8876_REG_AW_COLOR] & RA8876_REG_AW_COLOR_DEPTH_MASK); }
+
+    uint32_t
+    foreground()
+    {
+      return pack(reg[RA8876_REG_FGCR], reg[RA8876_REG_FGCG], reg[RA8876_REG_FGCB], canvasBytes());
+    }
+
+    bool
+    inActiveWindow(int x, int y)
+    {
+      int ax = reg16(RA8876_REG_AWUL_X0);
+      int ay = reg16(RA8876_REG_AWUL_Y0);
+      return (x >= ax) && (x < (ax + reg16(RA8876_REG_AW_WTH0))) &&
+             (y >= ay) && (y < (ay + reg16(RA8876_REG_AW_HT0)));
+    }
+
+    void
+    plot(int x, int y, uint32_t v)
+    {
+      int bpp = canvasBytes();
+      if (!inActiveWindow(x, y)) return;
+      writePixel(reg32(RA8876_REG_CVSSA0) + (((uint32_t)y * reg16(RA8876_REG_CVS_IMWTH0)) + x) * bpp, bpp, v);
+    }
+
+    void
+    span(int x1, int x2, int y, uint32_t v)
+    {
+      if (x1 > x2) { int t = x1; x1 = x2; x2 = t; }
+      for (int x = x1; x <= x2; x++) plot(x, y, v);
+    }
+
+    uint32_t
+    line(int x1, int y1, int x2, int y2, uint32_t v)
+    {
+      int dx =  abs(x2 - x1), sx = (x1 < x2) ? 1 : -1;
+      int dy = -abs(y2 - y1), sy = (y1 < y2) ? 1 : -1;
+      int e  = dx + dy;
+      uint32_t n = 0;
+
+      while (true)
+      {
+        plot(x1, y1, v); n++;
+        if ((x1 == x2) && (y1 == y2)) break;
+        int e2 = 2 * e;
+        if (e2 >= dy) { e += dy; x1 += sx; }
+        if (e2 <= dx) { e += dx; y1 += sy; }
+      }
+      return n;
+    }
+
+    //----------------------------------------------------------------------
+    // geometry engine
+
+    void
+    drawShape(uint8_t r, uint8_t cmd)
+    {
+      int      x1 = reg16(RA8876_REG_DLHSR0), y1 = reg16(RA8876_REG_DLVSR0);
+      int      x2 = reg16(RA8876_REG_DLHER0), y2 = reg16(RA8876_REG_DLVER0);
+      int      x3 = reg16(RA8876_REG_DTPH0),  y3 = reg16(RA8876_REG_DTPV0);
+      bool     fill = (cmd & 0x40) != 0;
+      uint32_t v = foreground();
+      uint32_t n = 0;
+
+      if (r == RA8876_REG_DCR0)
+      {
+        if ((cmd & 0x20) == 0) n = line(x1, y1, x2, y2, v);
+        else
+        if (!fill)
+        {
+          n  = line(x1, y1, x2, y2, v);
+          n += line(x2, y2, x3, y3, v);
+          n += line(x3, y3, x1, y1, v);
+        }
+        else
+        {
+          // inclusive edge-function fill over the bounding box
+          int minx = x1 < x2 ? (x1 < x3 ? x1 : x3) : (x2 < x3 ? x2 : x3);
+          int maxx = x1 > x2 ? (x1 > x3 ? x1 : x3) : (x2 > x3 ? x2 : x3);
+          int miny = y1 < y2 ? (y1 < y3 ? y1 : y3) : (y2 < y3 ? y2 : y3);
+          int maxy = y1 > y2 ? (y1 > y3 ? y1 : y3) : (y2 > y3 ? y2 : y3);
+          for (int y = miny; y <= maxy; y++)
+            for (int x = minx; x <= maxx; x++)
+            {
+              long e1 = (long)(x2 - x1) * (y - y1) - (long)(y2 - y1) * (x - x1);
+              long e2 = (long)(x3 - x2) * (y - y2) - (long)(y3 - y2) * (x - x2);
+              long e3 = (long)(x1 - x3) * (y - y3) - (long)(y1 - y3) * (x - x3);
+              if (((e1 >= 0) && (e2 >= 0) && (e3 >= 0)) ||
+                  ((e1 <= 0) && (e2 <= 0) && (e3 <= 0))) { plot(x, y, v); n++; }
+            }
+        }
+      }
+      else
+      {
+        switch ((cmd >> 4) & 0x03)
+        {
+          case 0: // ellipse/circle
+               n = ellipse(reg16(RA8876_REG_DEHR0), reg16(RA8876_REG_DEVR0),
+                           reg16(RA8876_REG_ELL_A0), reg16(RA8876_REG_ELL_B0), fill, v);
+               break;
+
+          case 1: // quarter curves are not modelled
+               break;
+
+          case 2: // rectangle
+          case 3: // rounded rectangle (modelled without the rounded corners)
+               if (x1 > x2) { int t = x1; x1 = x2; x2 = t; }
+               if (y1 > y2) { int t = y1; y1 = y2; y2 = t; }
+               if (fill)
+               {
+                 for (int y = y1; y <= y2; y++) span(x1, x2, y, v);
+                 n = (uint32_t)(x2 - x1 + 1) * (y2 - y1 + 1);
+               }
+               else
+               {
+                 n  = line(x1, y1, x2, y1, v);
+                 n += line(x1, y2, x2, y2, v);
+                 n += line(x1, y1, x1, y2, v);
+                 n += line(x2, y1, x2, y2, v);
+               }
+               break;
+        }
+      }
+
+      m_busyUntil = now + 1000 + (uint64_t)n * pixelTime;
+      m_task      = true;
+    }
+
+    uint32_t
+    ellipse(int cx, int cy, int a, int b, bool fill, uint32_t v)
+    {
+      uint32_t n = 0;
+      int      px = -1;
+
+      // walk the rows from the top; each row is a span (fill) or its ends
+      for (int dy = -b; dy <= b; dy++)
+      {
+        double t  = (b == 0) ? 1.0 : 1.0 - ((double)dy * dy) / ((double)b * b);
+        int    dx = (int)floor(a * sqrt(t < 0 ? 0 : t) + 0.5);
+
+        if (fill)
+        {
+          span(cx - dx, cx + dx, cy + dy, v);
+          n += (2 * dx) + 1;
+        }
+        else
+        {
+          // join horizontally to the previous row to keep the outline closed
+          int from = (px < 0) ? dx : (dy <= 0 ? px : dx);
+          int to   = (px < 0) ? dx : (dy <= 0 ? dx : px);
+          if (from > to) { int tt = from; from = to; to = tt; }
+          span(cx - to, cx - from, cy + dy, v);
+          span(cx + from, cx + to, cy + dy, v);
+          n += 2 * (to - from + 1);
+        }
+        px = dx;
+      }
+      return n;
+    }
+
+    //----------------------------------------------------------------------
+    // block transfer engine
+
+    struct Image
+    {
+      uint32_t addr;
+      uint16_t width;
+      uint16_t x, y;
+      int      bpp;
+    };
+
+    Image
+    image(uint8_t base, int bpp)
+    {
+      Image i;
+      i.addr  = reg32(base);
+      i.width = reg16(base + 4);
+      i.x     = reg16(base + 6);
+      i.y     = reg16(base + 8);
+      i.bpp   = bpp;
+      return i;
+    }
+
+    uint32_t
+    at(const Image &i, int dx, int dy)
+    {
+      return i.addr + (((uint32_t)(i.y + dy) * i.width) + (i.x + dx)) * i.bpp;
+    }
+
+    // S1 pixel: from the S1 image, or the constant colour that is held in
+    // the S1 start address registers (packed at the S1 image depth)
+    uint32_t
+    s1Pixel(const Image &s1, bool constant, int x, int y)
+    {
+      if (constant) return pack(reg[RA8876_REG_BTE_S1_RED], reg[RA8876_REG_BTE_S1_GREEN], reg[RA8876_REG_BTE_S1_BLUE], s1.bpp);
+      return readPixel(at(s1, x, y), s1.bpp);
+    }
+
+    static uint32_t
+    rop(uint8_t code, uint32_t s0, uint32_t s1)
+    {
+      switch (code)
+      {
+        case  0: return 0;
+        case  1: return ~(s0 | s1);
+        case  2: return ~s0 & s1;
+        case  3: return ~s0;
+        case  4: return s0 & ~s1;
+        case  5: return ~s1;
+        case  6: return s0 ^ s1;
+        case  7: return ~(s0 & s1);
+        case  8: return s0 & s1;
+        case  9: return ~(s0 ^ s1);
+        case 10: return s1;
+        case 11: return ~s0 | s1;
+        case 12: return s0;
+        case 13: return s0 | ~s1;
+        case 14: return s0 | s1;
+        default: return 0xffffffff;
+      }
+    }
+
+    void
+    bteStart()
+    {
+      uint8_t  ctrl1 = reg[RA8876_REG_BTE_CTRL1];
+      uint8_t  colr  = reg[RA8876_REG_BTE_COLR];
+      uint8_t  code  = (ctrl1 >> 4) & 0x0f;
+      bool     s1c   = ((colr & RA8876_REG_BTE_S1_DEPTH_MASK) == RA8876_REG_BTE_S1_CONSTANT_COLOR);
+      int      s0bpp = depthBytes((colr >> 5) & 0x03);
+      int      dbpp  = depthBytes( colr       & 0x03);
+      int      s1bpp = s1c ? dbpp : depthBytes((colr >> 2) & 0x03);
+      Image    s0    = image(RA8876_REG_BTE_S0_STR0,   s0bpp);
+      Image    s1    = image(RA8876_REG_BTE_S1_STR0,   s1bpp);
+      Image    d     = image(RA8876_REG_BTE_DEST_STR0, dbpp);
+      uint16_t w     = reg16(RA8876_REG_BTE_WTH0);
+      uint16_t h     = reg16(RA8876_REG_BTE_HIG0);
+      uint32_t mask  = (dbpp == 1) ? 0xff : ((dbpp == 2) ? 0xffff : 0xffffff);
+
+      switch (ctrl1 & RA8876_REG_BTE_OPERATION_MASK)
+      {
+        case RA8876_REG_BTE_MEM_CPY_ROP:
+             {
+               // read everything first so overlapping copies behave
+               std::vector<uint32_t> out((size_t)w * h);
+               for (int y = 0; y < h; y++)
+                 for (int x = 0; x < w; x++)
+                   out[(size_t)y * w + x] = rop(code, readPixel(at(s0, x, y), s0bpp),
+                                                      s1Pixel(s1, s1c, x, y)) & mask;
+               for (int y = 0; y < h; y++)
+                 for (int x = 0; x < w; x++)
+                   writePixel(at(d, x, y), dbpp, out[(size_t)y * w + x]);
+             }
+             break;
+
+        case RA8876_REG_BTE_MEM_CPY_CHROMA:
+             {
+               // S0 pixels matching the key (background colour) are skipped
+               uint32_t key = pack(reg[RA8876_REG_BGCR], reg[RA8876_REG_BGCG], reg[RA8876_REG_BGCB], s0bpp);
+               std::vector<uint32_t> out((size_t)w * h);
+               for (int y = 0; y < h; y++)
+                 for (int x = 0; x < w; x++)
+                   out[(size_t)y * w + x] = readPixel(at(s0, x, y), s0bpp);
+               for (int y = 0; y < h; y++)
+                 for (int x = 0; x < w; x++)
+                   if (out[(size_t)y * w + x] != key) writePixel(at(d, x, y), dbpp, out[(size_t)y * w + x] & mask);
+             }
+             break;
+
+        case RA8876_REG_BTE_MEM_CPY_OPACITY:
+             {
+               // S0 * alpha + S1 * (1 - alpha), alpha in 32nds
+               int a = reg[RA8876_REG_APB_CTRL] & RA8876_REG_APB_ALPHA_MASK;
+               if (a > RA8876_REG_APB_ALPHA_MAX) a = RA8876_REG_APB_ALPHA_MAX;
+               std::vector<uint32_t> out((size_t)w * h);
+               for (int y = 0; y < h; y++)
+                 for (int x = 0; x < w; x++)
+                 {
+                   uint8_t r0, g0, b0, r1, g1, b1;
+                   unpack(readPixel(at(s0, x, y), s0bpp), s0bpp, &r0, &g0, &b0);
+                   unpack(s1Pixel(s1, s1c, x, y),        s1bpp, &r1, &g1, &b1);
+                   out[(size_t)y * w + x] = pack((r0 * a + r1 * (32 - a)) / 32,
+                                                 (g0 * a + g1 * (32 - a)) / 32,
+                                                 (b0 * a + b1 * (32 - a)) / 32, dbpp);
+                 }
+               for (int y = 0; y < h; y++)
+                 for (int x = 0; x < w; x++)
+                   writePixel(at(d, x, y), dbpp, out[(size_t)y * w + x]);
+             }
+             break;
+
+        case RA8876_REG_BTE_PAT_FILL_ROP:
+             {
+               // S0 holds an 8x8 or 16x16 tile, repeated from the DEST origin
+               int size = (reg[RA8876_REG_BTE_CTRL0] & RA8876_REG_BTE_PATTERN_FORMAT16X16) ? 16 : 8;
+               for (int y = 0; y < h; y++)
+                 for (int x = 0; x < w; x++)
+                   writePixel(at(d, x, y), dbpp, rop(code, readPixel(at(s0, x % size, y % size), s0bpp),
+                                                           s1Pixel(s1, s1c, x, y)) & mask);
+             }
+             break;
+
+        case RA8876_REG_BTE_SOLID_FILL:
+             {
+               uint32_t v = pack(reg[RA8876_REG_FGCR], reg[RA8876_REG_FGCG], reg[RA8876_REG_FGCB], dbpp);
+               for (int y = 0; y < h; y++)
+                 for (int x = 0; x < w; x++)
+                   writePixel(at(d, x, y), dbpp, v);
+             }
+             break;
+
+        case RA8876_REG_BTE_MPU_WR_CEXP:
+        case RA8876_REG_BTE_MPU_WR_CEXP_CHROMA:
+             // the bitmap arrives through the memory port, busy until then
+             m_cexpLeft = (uint32_t)w * h;
+             m_cexpX    = 0;
+             m_cexpY    = 0;
+             if (m_cexpLeft == 0) break;
+             m_busyUntil = UINT64_MAX;
+             m_task      = true;
+             return;
+
+        default: // operation not modelled
+             break;
+      }
+
+      m_busyUntil = now + 1000 + (uint64_t)w * h * pixelTime;
+      m_task      = true;
+    }
+
+    //----------------------------------------------------------------------
+    // serial flash DMA (block mode)
+
+    uint8_t
+    flashRead(int sel, uint32_t addr)
+    {
+      return (addr < flash[sel].size()) ? flash[sel][addr] : 0xff;
+    }
+
+    // a w x h block of a picture SWTH pixels wide is copied byte for byte
+    // onto the canvas at DX, DY; the time taken is the flash clock
+    void
+    dmaStart()
+    {
+      uint8_t  ctrl = reg[RA8876_REG_SFL_CTRL];
+      int      sel  = (ctrl & RA8876_REG_SFL_CTRL_SELECT_MASK) ? 1 : 0;
+      int      bpp  = canvasBytes();
+      uint32_t src  = reg32(RA8876_REG_DMA_SSTR0);
+      uint16_t sw   = reg16(RA8876_REG_DMA_SWTH0);
+      uint16_t dx   = reg16(RA8876_REG_DMA_DX0);
+      uint16_t dy   = reg16(RA8876_REG_DMA_DY0);
+      uint16_t w    = reg16(RA8876_REG_DMA_DWTH0);
+      uint16_t h    = reg16(RA8876_REG_DMA_DHIGH0);
+      uint32_t base = reg32(RA8876_REG_CVSSA0);
+      uint16_t cw   = reg16(RA8876_REG_CVS_IMWTH0);
+      uint32_t sck  = coreClock / ((reg[RA8876_REG_SPI_DIVSOR] + 1) * 2);
+
+      // font mode: the flash belongs to the text engine
+      if ((ctrl & RA8876_REG_SFL_CTRL_MODE_MASK) != RA8876_REG_SFL_CTRL_MODE_DMA) return;
+      if ((ctrl & RA8876_REG_SFL_CTRL_ADDR_MASK) == RA8876_REG_SFL_CTRL_ADDR_24BIT) src &= 0xffffff;
+
+      for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+          for (int i = 0; i < bpp; i++)
+          {
+            uint32_t to = base + (((uint32_t)(dy + y) * cw) + (dx + x)) * bpp + i;
+            if (to < sdram.size()) sdram[to] = flashRead(sel, src + (((uint32_t)y * sw) + x) * bpp + i);
+          }
+
+      // a read command and address per row, then the data
+      m_busyUntil = now + 1000 + ((uint64_t)h * (40 + (uint32_t)w * bpp * 8) * 1000000000ULL) / sck;
+      m_task      = true;
+      m_dma       = true;
+    }
+
+    //----------------------------------------------------------------------
+    // text engine
+
+    void
+    textChar(uint8_t c)
+    {
+      int      ch  = ((reg[RA8876_REG_CCR0] >> 4) & 0x03) * 8 + 16;
+      int      cw  = ch / 2;
+      int      sx  = ((reg[RA8876_REG_CCR1] >> 2) & 0x03) + 1;
+      int      sy  = ( reg[RA8876_REG_CCR1]       & 0x03) + 1;
+      int      x   = reg16(RA8876_REG_F_CURX0);
+      int      y   = reg16(RA8876_REG_F_CURY0);
+      int      awx = reg16(RA8876_REG_AWUL_X0);
+      uint32_t v   = foreground();
+
+      // wrap at the right edge of the active window
+      if ((x + (cw * sx)) > (awx + reg16(RA8876_REG_AW_WTH0)))
+      {
+        x  = awx;
+        y += (ch * sy) + (reg[RA8876_REG_FLDR] & 0x1f);
+      }
+
+      // there is no character ROM; render a deterministic pattern per code
+      // so different text produces different (comparable) pixels
+      if (c != ' ')
+      {
+        for (int py = 0; py < ch * sy; py++)
+        {
+          int     gy   = ((py / sy) * 8) / ch;
+          uint8_t bits = (uint8_t)((c * 0x9e3779b1UL) >> ((gy * 3) % 24)) | 0x81;
+          for (int px = 0; px < cw * sx; px++)
+          {
+            int gx = ((px / sx) * 8) / cw;
+            if ((bits >> gx) & 1) plot(x + px, y + py, v);
+          }
+        }
+      }
+
+      x += (cw * sx) + (reg[RA8876_REG_F2FSSR] & 0x3f);
+      set16(RA8876_REG_F_CURX0, x);
+      set16(RA8876_REG_F_CURY0, y);
+
+      // characters queue up in the write FIFO and render one after another
+      m_fifoChar  = (uint64_t)cw * sx * ch * sy * pixelTime;
+      m_fifoUntil = ((m_fifoUntil > now) ? m_fifoUntil : now) + m_fifoChar;
+    }
+
+    //----------------------------------------------------------------------
+    // MPU write with colour expansion: one bit per pixel, msb first from the
+    // start bit (rop field), every row starts on a new byte
+
+    void
+    cexpWrite(uint8_t x)
+    {
+      uint8_t  ctrl1  = reg[RA8876_REG_BTE_CTRL1];
+      int      dbpp   = depthBytes(reg[RA8876_REG_BTE_COLR] & 0x03);
+      Image    d      = image(RA8876_REG_BTE_DEST_STR0, dbpp);
+      uint16_t w      = reg16(RA8876_REG_BTE_WTH0);
+      bool     chroma = (ctrl1 & RA8876_REG_BTE_OPERATION_MASK) == RA8876_REG_BTE_MPU_WR_CEXP_CHROMA;
+      uint32_t fg     = pack(reg[RA8876_REG_FGCR], reg[RA8876_REG_FGCG], reg[RA8876_REG_FGCB], dbpp);
+      uint32_t bg     = pack(reg[RA8876_REG_BGCR], reg[RA8876_REG_BGCG], reg[RA8876_REG_BGCB], dbpp);
+
+      for (int b = (m_cexpX == 0) ? ((ctrl1 >> 4) & 0x07) : 7; (b >= 0) && m_cexpLeft; b--)
+      {
+        bool on = (x & (1 << b)) != 0;
+        if (on || !chroma) writePixel(at(d, m_cexpX, m_cexpY), dbpp, on ? fg : bg);
+        m_cexpLeft--;
+
+        // the rest of the byte is padding
+        if (++m_cexpX == w) { m_cexpX = 0; m_cexpY++; break; }
+      }
+
+      if (m_cexpLeft == 0) m_busyUntil = now + 1000;
+    }
+
+    //----------------------------------------------------------------------
+    // memory port (graphics mode)
+
+    void
+    memoryWrite(uint8_t x)
+    {
+      int bpp = canvasBytes();
+
+      m_pixel[m_pixelLen++] = x;
+      if (m_pixelLen < bpp) return;
+      m_pixelLen = 0;
+
+      uint32_t v = m_pixel[0];
+      if (bpp > 1) v |= (uint32_t)m_pixel[1] << 8;
+      if (bpp > 2) v |= (uint32_t)m_pixel[2] << 16;
+
+      int cx = reg16(RA8876_REG_CURH0);
+      int cy = reg16(RA8876_REG_CURV0);
+      plot(cx, cy, v);
+
+      // advance, wrapping within the active window
+      cx++;
+      if (cx >= (reg16(RA8876_REG_AWUL_X0) + reg16(RA8876_REG_AW_WTH0)))
+      {
+        cx = reg16(RA8876_REG_AWUL_X0);
+        cy++;
+      }
+      set16(RA8876_REG_CURH0, cx);
+      set16(RA8876_REG_CURV0, cy);
+    }
+
+    //----------------------------------------------------------------------
+    // cycles
+
+    uint8_t
+    status()
+    {
+      uint8_t s = RA8876_STATUS_HMWFF_NF | RA8876_STATUS_HMRFF_NF | RA8876_STATUS_HMRFE_E |
+                  RA8876_STATUS_BRAM_READY | RA8876_STATUS_MODE_NORM;
+      if (now >= m_fifoUntil) s |= RA8876_STATUS_HMWFE_E;
+      if ((m_fifoUntil > now) && ((m_fifoUntil - now) > (fifoDepth - 1) * m_fifoChar))
+        s = (s & ~RA8876_STATUS_HMWFF_MASK) | RA8876_STATUS_HMWFF_F;
+      if (busy())             s |= RA8876_STATUS_TASK_BUSY;
+      return s;
+    }
+
+    // a frame is one cycle: a command write selects a single register and
+    // only the memory port takes a stream of data; anything else is a
+    // driver bug the chip would not report
+    void
+    frameEnd()
+    {
+      bool ok;
+
+      if (m_frameLen == 0) return;
+
+      switch (m_frameType)
+      {
+        case RA8876_CMD_WRITE:
+        case RA8876_DATA_READ:
+        case RA8876_STATUS_READ:
+             ok = (m_frameLen == 2);
+             break;
+
+        case RA8876_DATA_WRITE:
+             ok = (m_frameLen == 2) || (m_cmd == RA8876_REG_MRWDP);
+             break;
+
+        default:
+             ok = false;
+             break;
+      }
+
+      if (!ok) protocolErrors++;
+    }
+
+    uint8_t
+    dataRead()
+    {
+      if ((m_cmd >= RA8876_REG_PWDULX0) && (m_cmd <= RA8876_REG_PWH1)) return pip[pipSelected()][m_cmd - RA8876_REG_PWDULX0];
+      if (m_cmd == RA8876_REG_DMA_CTRL) return (m_dma && busy()) ? RA8876_REG_DMA_START : 0;
+      return reg[m_cmd];
+    }
+
+    void
+    dataWrite(uint8_t x)
+    {
+      if (m_cmd == RA8876_REG_MRWDP)
+      {
+        if      (m_cexpLeft)                                     cexpWrite(x);
+        else if (reg[RA8876_REG_ICR] & RA8876_REG_ICR_MODE_TEXT) textChar(x);
+        else                                                     memoryWrite(x);
+        return;
+      }
+
+      // interrupt flags: write 1 to clear
+      if (m_cmd == RA8876_REG_INTF)
+      {
+        reg[m_cmd] &= ~x;
+        tick();
+        return;
+      }
+
+      // the PIP registers address the window MPWCTR selects
+      if ((m_cmd >= RA8876_REG_PWDULX0) && (m_cmd <= RA8876_REG_PWH1))
+      {
+        pip[pipSelected()][m_cmd - RA8876_REG_PWDULX0] = x;
+        return;
+      }
+
+      reg[m_cmd] = x;
+      switch (m_cmd)
+      {
+
+        case RA8876_REG_SRR:
+             if (x & RA8876_REG_SRR_RESET) reset();
+             break;
+
+        case RA8876_REG_PPLLC1: case RA8876_REG_PPLLC2:
+        case RA8876_REG_HDWR:   case RA8876_REG_HDWFTR:
+        case RA8876_REG_HNDR:   case RA8876_REG_HNDFTR:
+        case RA8876_REG_HSTR:   case RA8876_REG_HPWR:
+        case RA8876_REG_VDHR0:  case RA8876_REG_VDHR1:
+        case RA8876_REG_VNDR0:  case RA8876_REG_VNDR1:
+        case RA8876_REG_VSTR:   case RA8876_REG_VPWR:
+             scanTiming();
+             break;
+
+        case RA8876_REG_CURH0: case RA8876_REG_CURH1:
+        case RA8876_REG_CURV0: case RA8876_REG_CURV1:
+             m_pixelLen = 0;
+             break;
+
+        case RA8876_REG_DMA_CTRL:
+             if (x & RA8876_REG_DMA_START) dmaStart();
+             reg[m_cmd] &= ~RA8876_REG_DMA_START;
+             break;
+
+        case RA8876_REG_DCR0:
+        case RA8876_REG_DCR1:
+             if (x & 0x80)
+             {
+               drawShape(m_cmd, x);
+               reg[m_cmd] &= ~0x80;
+             }
+             break;
+
+        case RA8876_REG_BTE_CTRL0:
+             if (x & RA8876_REG_BTE_ENABLE)
+             {
+               bteStart();
+               reg[m_cmd] &= ~RA8876_REG_BTE_ENABLE;
+             }
+             break;
+      }
+    }
+};
+
+//--------------------------------------------------------------------------
+// host bindings
+
+#ifndef RA8876_CS
+#define RA8876_CS                         -1
+#endif
+
+#ifndef RA8876_RESET
+#define RA8876_RESET                      -1
+#endif
+
+#ifndef RA8876_INT
+#define RA8876_INT                        -1
+#endif
+
+RA8876Emulator ra8876Emulator(RA8876_CS, RA8876_RESET, RA8876_INT);
+SPIClass       SPI;
+
+void SPIClass::beginTransaction(SPISettings settings)
+{
+  ra8876Emulator.spiClock = settings.clock;
+}
+
+uint8_t SPIClass::transfer(uint8_t x)
+{
+  ra8876Emulator.now += ra8876Emulator.transferOverhead;
+  ra8876Emulator.spiTransfers++;
+  return ra8876Emulator.exchange(x);
+}
+
+void SPIClass::transfer(void *buf, size_t count)
+{
+  uint8_t *p = (uint8_t *)buf;
+
+  ra8876Emulator.now += ra8876Emulator.transferOverhead;
+  ra8876Emulator.spiTransfers++;
+  while (count--)
+  {
+    *p = ra8876Emulator.exchange(*p);
+    p++;
+  }
+}
+
+void pinMode(int pin, int mode)
+{
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(int pin, int value)
+{
+  ra8876Emulator.now += ra8876Emulator.pinOverhead;
+  if (pin == ra8876Emulator.csPin) ra8876Emulator.chipSelect(value == LOW);
+  else
+  if ((pin == ra8876Emulator.resetPin) && (value == LOW)) ra8876Emulator.reset();
+}
+
+int digitalRead(int pin)
+{
+  if (pin == ra8876Emulator.intPin)
+  {
+    ra8876Emulator.tick();
+    return ra8876Emulator.intLine();
+  }
+  return HIGH;
+}
+
+void attachInterrupt(int irq, void (*isr)(), int mode)
+{
+  if (irq != ra8876Emulator.intPin) return;
+  ra8876Emulator.isr     = isr;
+  ra8876Emulator.isrMode = mode;
+}
+
+void detachInterrupt(int irq)
+{
+  if (irq == ra8876Emulator.intPin) ra8876Emulator.isr = NULL;
+}
+
+void delay(unsigned long ms)
+{
+  ra8876Emulator.now += (uint64_t)ms * 1000000ULL;
+  ra8876Emulator.tick();
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  ra8876Emulator.now += (uint64_t)us * 1000ULL;
+  ra8876Emulator.tick();
+}
+
+unsigned long millis()
+{
+  return (unsigned long)(ra8876Emulator.now / 1000000ULL);
+}
+
+unsigned long micros()
+{
+  return (unsigned long)(ra8876Emulator.now / 1000ULL);
+}
+
+void yield()
+{
+  ra8876Emulator.now += ra8876Emulator.yieldTime;
+  ra8876Emulator.tick();
+}
+
+//--------------------------------------------------------------------------
@@ -11,49 +11,206 @@
 //--------------------------------------------------------------------------
 // constructor and intialization
 
-RA8876::RA8876(int csPin, int resetPin)
+RA8876 *RA8876::m_intInstance = NULL;
+
+RA8876::RA8876(int csPin, int resetPin, int intPin)
 {
   m_csPin       = csPin;
   m_resetPin    = resetPin;
+  m_intPin      = intPin;
 
   m_width       = 0;
   m_height      = 0;
+  m_canvasHeight= 0;
+  m_canvasWidth = 0;
+  m_canvasAddr  = 0;
+  m_canvasStride= 0;
+  m_canvas      = NULL;
+  m_pageSize    = 0;
+  m_virtualWidth  = 0;
+  m_virtualHeight = 0;
+  m_scrollX     = 0;
+  m_scrollY     = 0;
+  m_pages       = 1;
+  m_drawPage    = 0;
+  m_showPage    = 0;
   m_depth       = 0;
   m_bpp         = 0;
+  m_clipDepth   = 0;
+  m_ramTop      = 0;
+  memset(m_surfaces, 0, sizeof(m_surfaces));
+  m_patterns    = NULL;
+  memset(m_patternSize, 0, sizeof(m_patternSize));
+  m_textCache   = NULL;
+  invalidateTextCache();
+  resetTextCacheStats();
+  memset(m_pip, 0, sizeof(m_pip));
+
+  m_assets      = NULL;
+  m_assetCount  = 0;
+  m_flashCtrl   = ((RA8876_FLASH_SELECT == 1) ? RA8876_REG_SFL_CTRL_SELECT_1 : RA8876_REG_SFL_CTRL_SELECT_0) |
+                  RA8876_REG_SFL_CTRL_MODE_DMA   | RA8876_REG_SFL_CTRL_ADDR_24BIT |
+                  RA8876_REG_SFL_CTRL_WAVE_MODE0 | RA8876_REG_SFL_CTRL_READ_FAST;
+  m_flashDivisor= RA8876_FLASH_DIVISOR;
+
+  memset(m_paletteLut, 0, sizeof(m_paletteLut));
+  m_paletteSize = 0;
 
-  m_oscClock    = 11000;  // Suggested OSC frequency is 11.0592MHz
   m_ramInfo     = &defaultRamInfo;
   m_displayInfo = &defaultDisplayInfo;
+  m_clocks      = &defaultClocks;
+  m_timing      = &defaultDisplayTiming;
   m_textColor   = Color::White;
+  m_textCursorX = 0;
+  m_textCursorY = 0;
+
+  m_fontTable   = NULL;
+  m_replacement = '?';
+  m_utf8Char    = 0;
+  m_utf8Need    = 0;
+
+  m_spiDepth    = 0;
+  m_spiCmd      = 0;
+  m_txLen       = 0;
+  resetSpiStats();
+  shadowInvalidate();
+
+  // status wait timeouts (us)
+  m_waitTimeout[RA8876_WAIT_MODE_NORMAL]       = 250000;
+  m_waitTimeout[RA8876_WAIT_MEMORY_READY]      = 250000;
+  m_waitTimeout[RA8876_WAIT_STATUS_IDLE]       = 250000;
+  m_waitTimeout[RA8876_WAIT_EMPTY_FIFO_READ]   = 10000;
+  m_waitTimeout[RA8876_WAIT_EMPTY_FIFO_WRITE]  = 10000;
+  m_waitTimeout[RA8876_WAIT_FULL_FIFO_READ]    = 10000;
+  m_waitTimeout[RA8876_WAIT_FULL_FIFO_WRITE]   = 10000;
+  m_waitTimeout[RA8876_WAIT_VSYNC]             = 100000;
+  resetWaitHistogram();
+
+  m_vblankAt    = 0;
+  m_vblankValid = false;
+  m_frameAt     = 0;
+  m_frameBytes  = 0;
+  m_frameBudget = 0;
+  resetFrameStats();
+
+  m_async       = false;
+  m_engineBusy  = false;
+  m_queueHead   = 0;
+  m_queueCount  = 0;
+
+  m_intPending  = false;
+  m_intCallback = NULL;
+
+  m_textRun     = false;
 }
 
 //--------------------------------------------------------------------------
 // SPI interface
+//
+// the first byte of a chip-select frame is the cycle type, every byte
+// after it is payload of that type. the chip takes one command or data
+// write cycle a frame (a second byte of a data frame only goes to the
+// memory port), so each cycle goes out as a frame of its own, on the bus
+// before regWrite() returns: there is nothing to flush before a delay or
+// a wait on the chip. only the memory port streams (see below).
+
+void RA8876::_spiBegin()
+{
+  if (m_spiDepth++ == 0) RA8876_SPI_BUS.beginTransaction(m_spiSettings);
+}
 
-void RA8876::_spiCmdWrite(uint8_t x)
+void RA8876::_spiEnd()
+{
+  if (--m_spiDepth == 0) RA8876_SPI_BUS.endTransaction();
+}
+
+void RA8876::_spiWrite(uint8_t type, uint8_t x)
 {
+  uint8_t buf[2];
+
+  if (type == RA8876_CMD_WRITE) m_spiCmd = x;
+
+  // SPI.transfer() overwrites the buffer
+  buf[0] = type;
+  buf[1] = x;
   digitalWrite(m_csPin, LOW);
-  SPI.transfer(RA8876_CMD_WRITE);
-  SPI.transfer(x);
+  RA8876_SPI_BUS.transfer(buf, 2);
   digitalWrite(m_csPin, HIGH);
+  m_spiStats.bytes += 2;
+  m_spiStats.frames++;
+  m_spiStats.transfers++;
 }
 
-void RA8876::_spiDatWrite(uint8_t x)
+// streamed data frame: the data write cycle type followed by any number
+// of data bytes under one chip-select assertion. only the memory port
+// (MRWDP) takes a stream, any other register would be written repeatedly
+
+void RA8876::_spiStreamBegin()
 {
   digitalWrite(m_csPin, LOW);
-  SPI.transfer(RA8876_DATA_WRITE);
-  SPI.transfer(x);
+  m_txBuf[m_txLen++] = RA8876_DATA_WRITE;
+  m_spiStats.frames++;
+}
+
+void RA8876::_spiStreamWrite(uint8_t x)
+{
+  if (m_txLen == RA8876_SPI_BUFFER_SIZE) _spiStreamSend();
+  m_txBuf[m_txLen++] = x;
+}
+
+void RA8876::_spiStreamWrite(const uint8_t *buf, size_t sz)
+{
+  while (sz)
+  {
+    size_t n;
+
+    if (m_txLen == RA8876_SPI_BUFFER_SIZE) _spiStreamSend();
+    n = RA8876_SPI_BUFFER_SIZE - m_txLen;
+    if (n > sz) n = sz;
+
+    // SPI.transfer() overwrites the buffer, so always go through m_txBuf
+    memcpy(&m_txBuf[m_txLen], buf, n);
+    m_txLen += n;
+    buf     += n;
+    sz      -= n;
+  }
+}
+
+void RA8876::_spiStreamSend()
+{
+  RA8876_SPI_BUS.transfer(m_txBuf, m_txLen);
+  m_spiStats.bytes += m_txLen;
+  m_spiStats.transfers++;
+  m_txLen = 0;
+}
+
+void RA8876::_spiStreamEnd()
+{
+  if (m_txLen) _spiStreamSend();
   digitalWrite(m_csPin, HIGH);
 }
 
+void RA8876::_spiCmdWrite(uint8_t x)
+{
+  _spiWrite(RA8876_CMD_WRITE, x);
+}
+
+void RA8876::_spiDatWrite(uint8_t x)
+{
+  _spiWrite(RA8876_DATA_WRITE, x);
+}
+
 uint8_t RA8876::_spiDatRead()
 {
   uint8_t x;
 
   digitalWrite(m_csPin, LOW);
-  SPI.transfer(RA8876_DATA_READ);
-  x = SPI.transfer(0xff);
+  RA8876_SPI_BUS.transfer(RA8876_DATA_READ);
+  x = RA8876_SPI_BUS.transfer(0xff);
   digitalWrite(m_csPin, HIGH);
+  m_spiStats.bytes += 2;
+  m_spiStats.frames++;
+  m_spiStats.transfers += 2;
   return x;
 }
 
@@ -62,47 +219,151 @@ uint8_t RA8876::_spiSTSRead()
   uint8_t x;
 
   digitalWrite(m_csPin, LOW);
-  SPI.transfer(RA8876_STATUS_READ);
-  x = SPI.transfer(0);
+  RA8876_SPI_BUS.transfer(RA8876_STATUS_READ);
+  x = RA8876_SPI_BUS.transfer(0);
   digitalWrite(m_csPin, HIGH);
+  m_spiStats.bytes += 2;
+  m_spiStats.frames++;
+  m_spiStats.transfers += 2;
   return x;
 }
 
 void RA8876::regWrite(uint8_t reg, uint8_t v)
 {
+  if (shadowed(reg))
+  {
+    uint8_t bit = (1 << (reg & 7));
+
+    // skip the write if the register already holds this value
+    if ((m_shadowValid[reg >> 3] & bit) && (m_shadow[reg] == v))
+    {
+      m_spiStats.writesAvoided++;
+      return;
+    }
+
+    // the BTE enable bit clears itself when the operation completes
+    if (reg == RA8876_REG_BTE_CTRL0) m_shadow[reg] = v & ~RA8876_REG_BTE_ENABLE;
+    else                             m_shadow[reg] = v;
+    m_shadowValid[reg >> 3] |= bit;
+  }
+
   _spiCmdWrite(reg);
   _spiDatWrite(v);
 }
 
 void RA8876::regWrite16(uint8_t reg, uint16_t v)
 {
-  // write two consecutive registers
-  _spiCmdWrite(reg);
-  _spiDatWrite( v       & 0xff);
-  _spiCmdWrite(reg + 1);
-  _spiDatWrite((v >> 8) & 0xff);
+  // write two consecutive registers (through the shadow cache)
+  regWrite(reg,      v       & 0xff);
+  regWrite(reg + 1, (v >> 8) & 0xff);
 }
 
 void RA8876::regWrite32(uint8_t reg, uint32_t v)
 {
-  // write four consecutive registers
-  _spiCmdWrite(reg);
-  _spiDatWrite( v        & 0xff);
-  _spiCmdWrite(reg + 1);
-  _spiDatWrite((v  >> 8) & 0xff);
-  _spiCmdWrite(reg + 2);
-  _spiDatWrite((v >> 16) & 0xff);
-  _spiCmdWrite(reg + 3);
-  _spiDatWrite((v >> 24) & 0xff);
+  // write four consecutive registers (through the shadow cache)
+  regWrite(reg,      v        & 0xff);
+  regWrite(reg + 1, (v  >> 8) & 0xff);
+  regWrite(reg + 2, (v >> 16) & 0xff);
+  regWrite(reg + 3, (v >> 24) & 0xff);
 }
 
 uint8_t 
 RA8876::regRead(uint8_t reg)
+{
+  uint8_t x;
+
+  if (shadowed(reg))
+  {
+    uint8_t bit = (1 << (reg & 7));
+
+    // driver owned register, the chip holds what we last wrote
+    if (m_shadowValid[reg >> 3] & bit)
+    {
+      m_spiStats.readsAvoided++;
+
+#if RA8876_SHADOW_VERIFY
+      x = regReadRaw(reg);
+      if (x != m_shadow[reg])
+      {
+        m_spiStats.mismatches++;
+        m_shadow[reg] = x;
+      }
+#endif
+
+      return m_shadow[reg];
+    }
+
+    // first access, populate the shadow
+    x = regReadRaw(reg);
+    m_shadow[reg] = x;
+    m_shadowValid[reg >> 3] |= bit;
+    return x;
+  }
+
+  return regReadRaw(reg);
+}
+
+uint8_t 
+RA8876::regReadRaw(uint8_t reg)
 {
   _spiCmdWrite(reg);
   return _spiDatRead();
 }
 
+//--------------------------------------------------------------------------
+// shadow register cache
+//
+// registers the driver writes and the chip never modifies on its own are
+// mirrored in m_shadow; reads are served locally and writes of unchanged
+// values are skipped. trigger registers (DCR0/DCR1, SRR, BFRCR, DMA),
+// registers that auto-increment (graphic/text cursors) and the PIP window
+// registers (two windows behind one address range) are never cached.
+
+bool
+RA8876::shadowed(uint8_t reg)
+{
+  return ((reg >= RA8876_REG_MACR)      && (reg <= RA8876_REG_ICR))         ||
+         ((reg >= RA8876_REG_MPWCTR)    && (reg <= RA8876_REG_MWULY1))      ||
+         ((reg >= RA8876_REG_CVSSA0)    && (reg <= RA8876_REG_AW_COLOR))    ||
+         ((reg >= RA8876_REG_DLHSR0)    && (reg <= RA8876_REG_DTPV1))       ||
+         ((reg >= RA8876_REG_ELL_A0)    && (reg <= RA8876_REG_DEVR1))       ||
+         ((reg >= RA8876_REG_BTE_CTRL0) && (reg <= RA8876_REG_APB_CTRL))    ||
+         (reg == RA8876_REG_SFL_CTRL)   || (reg == RA8876_REG_SPI_DIVSOR)   ||
+         ((reg >= RA8876_REG_CCR0)      && (reg <= RA8876_REG_FGCB));
+}
+
+void
+RA8876::shadowInvalidate()
+{
+  memset(m_shadowValid, 0, sizeof(m_shadowValid));
+}
+
+int
+RA8876::verifyShadow()
+{
+  int mismatches = 0;
+
+  _spiBegin();
+
+  // compare every cached register against the chip
+  for (int reg = 0; reg < 256; reg++)
+  {
+    if ((m_shadowValid[reg >> 3] & (1 << (reg & 7))) == 0) continue;
+
+    uint8_t x = regReadRaw(reg);
+    if (x != m_shadow[reg])
+    {
+      m_shadow[reg] = x;
+      mismatches++;
+    }
+  }
+
+  _spiEnd();
+
+  m_spiStats.mismatches += mismatches;
+  return mismatches;
+}
+
 //--------------------------------------------------------------------------
 // reset functionality
 
@@ -114,254 +375,206 @@ RA8876::hardReset()
   delay(5);
   digitalWrite(m_resetPin, HIGH);
   delay(5);
+
+  // register contents are back to defaults
+  shadowInvalidate();
 }
 
-void
+RA8876Error
 RA8876::softReset()
 {
-  SPI.beginTransaction(m_spiSettings);
+  RA8876Error err;
+
+  _spiBegin();
 
   // trigger soft reset
   regWrite(RA8876_REG_SRR, RA8876_REG_SRR_RESET);
   delay(5);
 
+  // register contents are back to defaults
+  shadowInvalidate();
+
   // wait for normal operation
-  waitUntilModeNormal();
+  err = waitUntilModeNormal();
+
+  _spiEnd();
 
-  SPI.endTransaction();
+  return err;
 }
 
 //--------------------------------------------------------------------------
 // status waitUntilxxxx
+//
+// the status register (or INTF, for vsync) is polled immediately; while
+// the condition is not met the poll interval backs off exponentially from
+// 1 us up to RA8876_WAIT_BACKOFF_MAX, until the per-condition timeout
+// expires. the time taken is recorded in a per-condition histogram.
 
-bool
-RA8876::waitUntilModeNormal()
-{ 
-  bool ok = false;
-  for (size_t i=0; i < 250; i++)
-  {
-    delay(1);
-    ok = ((_spiSTSRead() & RA8876_STATUS_MODE_MASK) == RA8876_STATUS_MODE_NORM);
-    if (ok) break;
-  }
-  return ok;
-}
-
-bool
-RA8876::waitUntilMemoryReady()
+uint8_t
+RA8876::waitRead(RA8876WaitCondition cond)
 {
-  bool ok = false;
-
-  for (size_t i=0; i < 250; i++)
-  {
-    delay(1);
-    ok = ((_spiSTSRead() & RA8876_STATUS_BRAM_MASK) == RA8876_STATUS_BRAM_READY);
-    if (ok) break;
-  }
-
-  return ok;
+  if (cond == RA8876_WAIT_VSYNC) return regReadRaw(RA8876_REG_INTF);
+  return _spiSTSRead();
 }
 
-bool
-RA8876::waitUntilStatusIdle()
+RA8876Error
+RA8876::waitUntil(RA8876WaitCondition cond, uint8_t mask, uint8_t value)
 {
-  bool ok = false;
+  RA8876Error err;
+  uint32_t    start, elapsed, backoff;
+
+  // default return value
+  err = RA8876_OK;
 
-  for (size_t i=0; i < 250; i++)
+  // fast path: condition already met
+  if ((waitRead(cond) & mask) == value)
   {
-    delay(1);
-    ok = ((_spiSTSRead() & RA8876_STATUS_TASK_MASK) == RA8876_STATUS_TASK_IDLE);
-    if (ok) break;
+    m_waitHistogram[cond][0]++;
+    return err;
   }
 
-  return ok;
-}
+  start   = micros();
+  backoff = 1;
+  while (true)
+  {
+    delayMicroseconds(backoff);
+    if ((waitRead(cond) & mask) == value) break;
 
-bool
-RA8876::waitUntilEmptyFifoRead()
-{
-  bool ok = false;
+    if ((micros() - start) >= m_waitTimeout[cond])
+    {
+      err = RA8876_ERROR_TIMEOUT;
+      break;
+    }
 
-  for (size_t i=0; i < 250; i++)
-  {
-    delay(1);
-    ok = ((_spiSTSRead() & RA8876_STATUS_HMRFE_MASK) == RA8876_STATUS_HMRFE_E);
-    if (ok) break;
+    if (backoff < RA8876_WAIT_BACKOFF_MAX) backoff <<= 1;
   }
+  elapsed = micros() - start;
 
-  return ok;
+  waitRecord(cond, err, elapsed);
+
+  return err;
 }
 
-bool
-RA8876::waitUntilEmptyFifoWrite()
+void
+RA8876::waitRecord(RA8876WaitCondition cond, RA8876Error err, uint32_t elapsed)
 {
-  bool ok = false;
+  uint8_t bucket;
 
-  for (size_t i=0; i < 250; i++)
+  // record the wait time
+  if (err != RA8876_OK) bucket = 7;
+  else
   {
-    delay(1);
-    ok = ((_spiSTSRead() & RA8876_STATUS_HMWFE_MASK) == RA8876_STATUS_HMWFE_E);
-    if (ok) break;
+    bucket = 1;
+    while ((bucket < 6) && (elapsed >= (16UL << ((bucket - 1) * 2)))) bucket++;
   }
+  m_waitHistogram[cond][bucket]++;
+}
 
-  return ok;
+RA8876Error
+RA8876::waitUntilModeNormal()
+{ 
+  return waitUntil(RA8876_WAIT_MODE_NORMAL,      RA8876_STATUS_MODE_MASK,  RA8876_STATUS_MODE_NORM);
 }
 
-bool
-RA8876::waitUntilFullFifoRead()
+RA8876Error
+RA8876::waitUntilMemoryReady()
 {
-  bool ok = false;
-
-  for (size_t i=0; i < 250; i++)
-  {
-    delay(1);
-    ok = ((_spiSTSRead() & RA8876_STATUS_HMRFF_MASK) == RA8876_STATUS_HMRFF_F);
-    if (ok) break;
-  }
-
-  return ok;
+  return waitUntil(RA8876_WAIT_MEMORY_READY,     RA8876_STATUS_BRAM_MASK,  RA8876_STATUS_BRAM_READY);
 }
 
-bool
-RA8876::waitUntilFullFifoWrite()
+RA8876Error
+RA8876::waitUntilStatusIdle()
 {
-  bool ok = false;
-
-  for (size_t i=0; i < 250; i++)
-  {
-    delay(1);
-    ok = ((_spiSTSRead() & RA8876_STATUS_HMWFF_MASK) == RA8876_STATUS_HMWFF_F);
-    if (ok) break;
-  }
-
-  return ok;
+  return waitUntil(RA8876_WAIT_STATUS_IDLE,      RA8876_STATUS_TASK_MASK,  RA8876_STATUS_TASK_IDLE);
 }
 
-//--------------------------------------------------------------------------
-// initialization
-
-bool
-RA8876::calcPllParams(uint32_t targetFreq, int kMax, RA8876PllParams *pll)
+// completion of an issued engine command: with the INT pin wired the ISR
+// flag is watched instead of the status register, costing no SPI traffic
+RA8876Error
+RA8876::waitUntilEngineIdle()
 {
-  bool     found;
-  int      foundk, foundn;
-  int      testk,  testn;
-  uint32_t fvco, freq, error;
-  uint32_t foundFreq;
-  uint32_t foundError;  // amount lower than requested frequency
+  RA8876Error err;
+  uint32_t    start;
 
-  // k of 0 (i.e. 2 ** 0 = 1) is possible, but not sure if it's a good idea.
-  found = false;
-  for (testk = 1; testk <= kMax; testk++)
-  {
-    if (m_oscClock % (1 << testk))   continue; // step size with this k would be fractional
+  if (m_intPin < 0) return waitUntilStatusIdle();
 
-    testn = (targetFreq / (m_oscClock / (1 << testk))) - 1;
-    if ((testn < 1) || (testn > 63)) continue; // param n out of range for this k
+  // default return value
+  err = RA8876_OK;
 
-    // fvco constraint found in data sheet section 6.1.2
-    fvco = m_oscClock * (testn + 1);
-    if ((fvco < 250000) && (fvco > 500000)) continue;  // fvco out of range
+  if (m_intPending)
+  {
+    m_waitHistogram[RA8876_WAIT_STATUS_IDLE][0]++;
+    return err;
+  }
 
-    // found some usable params, but perhaps at a lower frequency than requested.
-    freq = (m_oscClock * (testn + 1)) / (1 << testk);
-    error = targetFreq - freq;
-    if ((!found) || (found && (foundError > error)))
+  start = micros();
+  while (!m_intPending)
+  {
+    if ((micros() - start) >= m_waitTimeout[RA8876_WAIT_STATUS_IDLE])
     {
-      found      = true;
-      foundk     = testk;
-      foundn     = testn;
-
-      // keep for further potential refinement
-      foundFreq  = freq;
-      foundError = error;
-
-      // no need to keep searching if the frequency match was exact
-      if (foundError == 0) break;
+      err = RA8876_ERROR_TIMEOUT;
+      break;
     }
+    yield();
   }
 
-  if (found)
-  {
-    pll->freq = foundFreq;
-    pll->k    = foundk;
-    pll->n    = foundn;
-    pll->m    = 0; // this is always 0
-  }
+  waitRecord(RA8876_WAIT_STATUS_IDLE, err, micros() - start);
 
-  return found;
+  return err;
 }
 
-bool
-RA8876::calcClocks()
+RA8876Error
+RA8876::waitUntilEmptyFifoRead()
 {
-  bool     ok;
-  uint32_t memClock;
-  uint32_t coreClock;
-  uint32_t scanClock;
-
-  // default return value
-  ok = false;
-
-  // Data sheet section 2.5 gives max clocks:
-  //  memClock : 166 MHz
-  //  coreClock: 120 MHz (133MHz if not using internal font)
-  //  scanClock: 100 MHz
-
-  // mem clock target is the same as buffer ram speed, but capped at 166 MHz
-  memClock = m_ramInfo->freq;
-  if (memClock > 166000) memClock = 166000;
-  if (!calcPllParams(memClock, 3, &m_memPll)) goto ra8876_calcClocks_done;
-
-  // core clock target will be the same as the mem clock, but capped to 120mHz
-  coreClock = m_memPll.freq;
-  if (coreClock > 120000) coreClock = 120000;
-  if (!calcPllParams(coreClock, 3, &m_corePll)) goto ra8876_calcClocks_done;
-
-  // scan clock target will be the display's dot clock, but capped at 100 MHz
-  scanClock = m_displayInfo->dotClock;
-  if (scanClock > 100000) scanClock = 100000;
-  if (!calcPllParams(scanClock, 7, &m_scanPll)) goto ra8876_calcClocks_done;
+  return waitUntil(RA8876_WAIT_EMPTY_FIFO_READ,  RA8876_STATUS_HMRFE_MASK, RA8876_STATUS_HMRFE_E);
+}
 
-#if 0
+RA8876Error
+RA8876::waitUntilEmptyFifoWrite()
+{
+  return waitUntil(RA8876_WAIT_EMPTY_FIFO_WRITE, RA8876_STATUS_HMWFE_MASK, RA8876_STATUS_HMWFE_E);
+}
 
-  // display the clocks
-  dbgUART.println(F("\nMem\n---"));
-  dbgUART.print(F("Requested kHz: ")); dbgUART.println(m_ramInfo->freq);
-  dbgUART.print(F("Actual kHz   : ")); dbgUART.println(m_memPll.freq);
-  dbgUART.print(F("PLL k        : ")); dbgUART.println(m_memPll.k);
-  dbgUART.print(F("PLL n        : ")); dbgUART.println(m_memPll.n);
-
-  dbgUART.println(F("\nCore\n----"));
-  dbgUART.print(F("kHz          : ")); dbgUART.println(m_corePll.freq);
-  dbgUART.print(F("PLL k        : ")); dbgUART.println(m_corePll.k);
-  dbgUART.print(F("PLL n        : ")); dbgUART.println(m_corePll.n);
-
-  dbgUART.println(F("\nScan\n----"));
-  dbgUART.print(F("Requested kHz: ")); dbgUART.println(m_displayInfo->dotClock);
-  dbgUART.print(F("Actual kHz   : ")); dbgUART.println(m_scanPll.freq);
-  dbgUART.print(F("PLL k        : ")); dbgUART.println(m_scanPll.k);
-  dbgUART.print(F("PLL n        : ")); dbgUART.println(m_scanPll.n);
-  dbgUART.println();
+RA8876Error
+RA8876::waitUntilFullFifoRead()
+{
+  return waitUntil(RA8876_WAIT_FULL_FIFO_READ,   RA8876_STATUS_HMRFF_MASK, RA8876_STATUS_HMRFF_F);
+}
 
-#endif
+RA8876Error
+RA8876::waitUntilFullFifoWrite()
+{
+  return waitUntil(RA8876_WAIT_FULL_FIFO_WRITE,  RA8876_STATUS_HMWFF_MASK, RA8876_STATUS_HMWFF_F);
+}
 
-  // Data sheet section 6.1.1 rules:
-  // 1. Core clock must be less than or equal to mem clock
-  // 2. Core clock must be greater than half mem clock
-  // 3. Core clock must be greater than (scan clock * 1.5)
-  if  (m_corePll.freq      >   m_memPll.freq) goto ra8876_calcClocks_done;
-  if ((m_corePll.freq * 2) <=  m_memPll.freq) goto ra8876_calcClocks_done;
-  if  (m_corePll.freq      <= (m_scanPll.freq + (m_scanPll.freq >> 1))) goto ra8876_calcClocks_done;
+// room for another byte; shares the FULL_FIFO_WRITE timeout and histogram
+RA8876Error
+RA8876::waitUntilNotFullFifoWrite()
+{
+  return waitUntil(RA8876_WAIT_FULL_FIFO_WRITE,  RA8876_STATUS_HMWFF_MASK, RA8876_STATUS_HMWFF_NF);
+}
 
-  // got here? everything worked
-  ok = true;
+void
+RA8876::setWaitTimeout(RA8876WaitCondition cond, uint32_t us)
+{
+  if (cond < RA8876_WAIT_COUNT) m_waitTimeout[cond] = us;
+}
 
-ra8876_calcClocks_done:
+const uint32_t *
+RA8876::getWaitHistogram(RA8876WaitCondition cond)
+{
+  return m_waitHistogram[cond];
+}
 
-  return ok;
+void
+RA8876::resetWaitHistogram()
+{
+  memset(m_waitHistogram, 0, sizeof(m_waitHistogram));
 }
 
+//--------------------------------------------------------------------------
+// initialization
+
 bool 
 RA8876::initPLL()
 {
@@ -371,17 +584,17 @@ RA8876::initPLL()
   // default return value
   ok = false;
 
-  SPI.beginTransaction(m_spiSettings);
+  _spiBegin();
 
   // configure PLL registers based on values
-  regWrite(RA8876_REG_MPLLC1, m_memPll.k << 1  | m_memPll.m);
-  regWrite(RA8876_REG_MPLLC2, m_memPll.n);
+  regWrite(RA8876_REG_MPLLC1, m_clocks->mem.k << 1  | m_clocks->mem.m);
+  regWrite(RA8876_REG_MPLLC2, m_clocks->mem.n);
 
-  regWrite(RA8876_REG_SPLLC1, m_corePll.k << 1 | m_corePll.m);
-  regWrite(RA8876_REG_SPLLC2, m_corePll.n);
+  regWrite(RA8876_REG_SPLLC1, m_clocks->core.k << 1 | m_clocks->core.m);
+  regWrite(RA8876_REG_SPLLC2, m_clocks->core.n);
 
-  regWrite(RA8876_REG_PPLLC1, m_scanPll.k << 1 | m_scanPll.m);
-  regWrite(RA8876_REG_PPLLC2, m_scanPll.n);
+  regWrite(RA8876_REG_PPLLC1, m_clocks->scan.k << 1 | m_clocks->scan.m);
+  regWrite(RA8876_REG_PPLLC2, m_clocks->scan.n);
 
   // trigger a reconfiguration of the PLLs (toggle bit)
   reg = regRead(RA8876_REG_CCR);
@@ -395,20 +608,20 @@ RA8876::initPLL()
   // check the changes were made successfully
   ok = ((regRead(RA8876_REG_CCR) & RA8876_REG_CCR_CONF_PLL) == RA8876_REG_CCR_CONF_PLL);
 
-  SPI.endTransaction();
+  _spiEnd();
 
   return ok;
 }
 
 bool
-RA8876::initMemory(RA8876RamInfo *info)
+RA8876::initMemory(const RA8876RamInfo *info)
 {
   bool ok;
 
   // default return value
   ok = false;
 
-  SPI.beginTransaction(m_spiSettings);
+  _spiBegin();
 
   // Data sheet 19.12: buffer RAM control registers
 
@@ -424,9 +637,9 @@ RA8876::initMemory(RA8876RamInfo *info)
   regWrite(RA8876_REG_BFRCR, RA8876_REG_BFRCR_INIT);
 
   // wait for buffer RAM to be ready
-  ok = waitUntilMemoryReady();
+  ok = (waitUntilMemoryReady() == RA8876_OK);
 
-  SPI.endTransaction();
+  _spiEnd();
 
   return ok;
 }
@@ -441,7 +654,7 @@ RA8876::initDisplay()
   // default return value
   ok = false;
 
-  SPI.beginTransaction(m_spiSettings);
+  _spiBegin();
 
   //
   // setup the video output stream
@@ -491,32 +704,32 @@ RA8876::initDisplay()
   regWrite(RA8876_REG_PCSR, reg);
 
   // set display width
-  regWrite(RA8876_REG_HDWR,         ((m_displayInfo->width / 8) - 1)            & 0xff);
-  regWrite(RA8876_REG_HDWFTR,        (m_displayInfo->width % 8)                 & 0x07);
+  regWrite(RA8876_REG_HDWR,   m_timing->hdwr);
+  regWrite(RA8876_REG_HDWFTR, m_timing->hdwftr);
 
   // set display height
-  regWrite(RA8876_REG_VDHR0,         (m_displayInfo->height - 1)                & 0xff);
-  regWrite(RA8876_REG_VDHR1,        ((m_displayInfo->height - 1) >> 8)          & 0x07);
+  regWrite(RA8876_REG_VDHR0,  m_timing->vdhr0);
+  regWrite(RA8876_REG_VDHR1,  m_timing->vdhr1);
 
   // set horizontal non-display (back porch)
-  regWrite(RA8876_REG_HNDR,         ((m_displayInfo->hBackPorch / 8) - 1)       & 0x1f);
-  regWrite(RA8876_REG_HNDFTR,        (m_displayInfo->hBackPorch % 8)            & 0x0f);
+  regWrite(RA8876_REG_HNDR,   m_timing->hndr);
+  regWrite(RA8876_REG_HNDFTR, m_timing->hndftr);
 
   // set horizontal start position (front porch)
-  regWrite(RA8876_REG_HSTR,        (((m_displayInfo->hFrontPorch + 4) / 8) - 1) & 0x1f);
+  regWrite(RA8876_REG_HSTR,   m_timing->hstr);
 
   // set HSYNC pulse width
-  regWrite(RA8876_REG_HPWR,        (((m_displayInfo->hPulseWidth + 4) / 8) - 1) & 0x1f);
+  regWrite(RA8876_REG_HPWR,   m_timing->hpwr);
 
   // set vertical non-display (back porch)
-  regWrite(RA8876_REG_VNDR0,        (m_displayInfo->vBackPorch - 1)             & 0xff);
-  regWrite(RA8876_REG_VNDR1,       ((m_displayInfo->vBackPorch - 1) >> 8)       & 0x03);
+  regWrite(RA8876_REG_VNDR0,  m_timing->vndr0);
+  regWrite(RA8876_REG_VNDR1,  m_timing->vndr1);
 
   // set vertical start position (front porch)
-  regWrite(RA8876_REG_VSTR,         (m_displayInfo->vFrontPorch - 1)            & 0xff);
+  regWrite(RA8876_REG_VSTR,   m_timing->vstr);
 
   // set VSYNC pulse width
-  regWrite(RA8876_REG_VPWR,         (m_displayInfo->vPulseWidth - 1)            & 0x3f);
+  regWrite(RA8876_REG_VPWR,   m_timing->vpwr);
 
   //
   // setup the window and active canvas
@@ -526,9 +739,7 @@ RA8876::initDisplay()
   reg = regRead(RA8876_REG_MPWCTR);
   reg = (reg & ~RA8876_REG_MPWCTR_PIP1_MASK)   | RA8876_REG_MPWCTR_PIP1_DISABLE; // disable PIP1
   reg = (reg & ~RA8876_REG_MPWCTR_PIP2_MASK)   | RA8876_REG_MPWCTR_PIP2_DISABLE; // disable PIP2
-       if (m_depth ==  8) reg = (reg & ~RA8876_REG_MPWCTR_DEPTH_MASK) | RA8876_REG_MPWCTR_DEPTH_8BPP;  // 8bpp
-  else if (m_depth == 16) reg = (reg & ~RA8876_REG_MPWCTR_DEPTH_MASK) | RA8876_REG_MPWCTR_DEPTH_16BPP; // 16bpp
-  else if (m_depth == 24) reg = (reg & ~RA8876_REG_MPWCTR_DEPTH_MASK) | RA8876_REG_MPWCTR_DEPTH_24BPP; // 24bpp
+  reg = (reg & ~RA8876_REG_MPWCTR_DEPTH_MASK)  | RA8876PixelFormat::mpwctr;     // main image depth
   reg = (reg & ~RA8876_REG_MPWCTR_SYNC_MASK)   | RA8876_REG_MPWCTR_SYNC_ENABLE; // sync enable
   regWrite(RA8876_REG_MPWCTR, reg);
 
@@ -564,9 +775,31 @@ RA8876::initDisplay()
   regWrite(RA8876_REG_AWUL_Y0,       0);
   regWrite(RA8876_REG_AWUL_Y1,       0);
 
+  // a display page holds one full screen (until setVirtualSize)
+  m_virtualWidth  = m_width;
+  m_virtualHeight = m_height;
+  m_scrollX       = 0;
+  m_scrollY       = 0;
+  m_pageSize = (uint32_t)m_width * m_height * m_bpp;
+
+  // pattern tiles and the text cache are the first surfaces (top of RAM),
+  // the canvas must stay clear of them
+  memset(m_surfaces, 0, sizeof(m_surfaces));
+  memset(m_patternSize, 0, sizeof(m_patternSize));
+  memset(m_pip, 0, sizeof(m_pip));   // both disabled above
+  m_canvas    = NULL;
+  m_ramTop    = m_ramInfo->sz;
+  m_patterns  = surfaceFit(16, 16 * RA8876_PATTERN_SLOTS, RA8876PixelFormat::depth);
+  m_textCache = surfaceFit(RA8876_TEXT_CACHE_WIDTH, RA8876_TEXT_CACHE_HEIGHT * RA8876_TEXT_CACHE_SLOTS, RA8876PixelFormat::depth);
+  invalidateTextCache();
+
   // set active window dimensions - this is logical height, not display height
-  height = (m_ramInfo->sz / ((uint32_t)m_width * (m_depth >> 3)));
+  height = (m_ramTop / ((uint32_t)m_width * m_bpp));
   if (height > 4095) height = 4095; // this is the maximum height as per document
+  m_canvasHeight = height;
+  m_canvasWidth  = m_width;
+  m_canvasAddr   = 0;
+  m_canvasStride = m_width;
   regWrite(RA8876_REG_AW_WTH0,        m_width        & 0xff);
   regWrite(RA8876_REG_AW_WTH1,       (m_width  >> 8) & 0xff);
   regWrite(RA8876_REG_AW_HT0,           height       & 0xff);
@@ -583,9 +816,7 @@ RA8876::initDisplay()
   // set canvas addressing mode/colour depth
   reg = regRead(RA8876_REG_AW_COLOR);
   reg = (reg & ~RA8876_REG_AW_COLOR_ADDR_MASK) | RA8876_REG_AW_COLOR_ADDR_BLOCK;
-       if (m_depth ==  8) reg = (reg & ~RA8876_REG_AW_COLOR_DEPTH_MASK) | RA8876_REG_AW_COLOR_DEPTH_8BPP;  // 8bpp
-  else if (m_depth == 16) reg = (reg & ~RA8876_REG_AW_COLOR_DEPTH_MASK) | RA8876_REG_AW_COLOR_DEPTH_16BPP; // 16bpp
-  else if (m_depth == 24) reg = (reg & ~RA8876_REG_AW_COLOR_DEPTH_MASK) | RA8876_REG_AW_COLOR_DEPTH_24BPP; // 24bpp
+  reg = (reg & ~RA8876_REG_AW_COLOR_DEPTH_MASK) | RA8876PixelFormat::awColor;   // canvas image depth
   regWrite(RA8876_REG_AW_COLOR, reg);
 
   //
@@ -629,11 +860,7 @@ RA8876::initDisplay()
   regWrite(RA8876_REG_BTE_DEST_Y1,    0);
 
   // S0, S0 and DST color depths
-  reg = 0;
-       if (m_depth ==  8) reg = RA8876_REG_BTE_S0_DEPTH_8BPP  | RA8876_REG_BTE_S1_DEPTH_8BPP  | RA8876_REG_BTE_DEST_DEPTH_8BPP;  // 8bpp
-  else if (m_depth == 16) reg = RA8876_REG_BTE_S0_DEPTH_16BPP | RA8876_REG_BTE_S1_DEPTH_16BPP | RA8876_REG_BTE_DEST_DEPTH_16BPP; // 16bpp
-  else if (m_depth == 24) reg = RA8876_REG_BTE_S0_DEPTH_24BPP | RA8876_REG_BTE_S1_DEPTH_24BPP | RA8876_REG_BTE_DEST_DEPTH_24BPP; // 24bpp
-  regWrite(RA8876_REG_BTE_COLR, reg);
+  regWrite(RA8876_REG_BTE_COLR, RA8876PixelFormat::bteColr);
 
   //
   // initialization is complete
@@ -644,7 +871,7 @@ RA8876::initDisplay()
   reg = (reg & ~RA8876_REG_DPCR_DISPLAY_MASK)  | RA8876_REG_DPCR_DISPLAY_ON; // display on
   regWrite(RA8876_REG_DPCR, reg);
 
-  SPI.endTransaction();
+  _spiEnd();
 
   // if we got here, all ok
   ok = true;
@@ -655,15 +882,16 @@ RA8876::initDisplay()
 bool
 RA8876::init()
 {
-  bool ok;
+  bool        ok;
+  RA8876Error err;
 
   // default return value
   ok = false;
 
   m_width  = m_displayInfo->width;
   m_height = m_displayInfo->height;
-  m_depth  = RA8876_COLOR_DEPTH;
-  m_bpp    = (m_depth << 3);       // 8bpp = 1, 16bpp = 2, 24bpp = 3
+  m_depth  = RA8876PixelFormat::depth;
+  m_bpp    = RA8876PixelFormat::bytes; // 8bpp = 1, 16bpp = 2, 24bpp = 3
 
   // set up chip select pin
   pinMode(m_csPin, OUTPUT);
@@ -679,26 +907,41 @@ RA8876::init()
     hardReset();
   }
 
-  // calculate the clocks required
-  if (!calcClocks()) goto ra8876_init_done;
-
-  SPI.begin();
+  RA8876_SPI_BUS.begin();
   m_spiSettings = SPISettings(RA8876_SPI_SPEED, MSBFIRST, SPI_MODE3);
 
   // SPI is now up, can do a soft reset if no hard reset was possible earlier
-  if (m_resetPin < 0) softReset();
+  if ((m_resetPin < 0) && (softReset() != RA8876_OK)) goto ra8876_init_done;
 
   // initialize PLL, memory and the display
   if (!initPLL())             goto ra8876_init_done;
   if (!initMemory(m_ramInfo)) goto ra8876_init_done;
   if (!initDisplay())         goto ra8876_init_done;
 
+  // route core task completion to the INT pin, if wired
+  if (m_intPin >= 0)
+  {
+    pinMode(m_intPin, INPUT_PULLUP);
+    m_intInstance = this;
+    m_intPending  = false;
+    attachInterrupt(digitalPinToInterrupt(m_intPin), _isr, FALLING);
+
+    _spiBegin();
+    regWrite(RA8876_REG_MINTFR, 0x00);
+    regWrite(RA8876_REG_INTF,   0xff);
+    regWrite(RA8876_REG_INTEN,  RA8876_REG_INT_CORE | RA8876_REG_INT_DMA);
+    _spiEnd();
+  }
+
   // set default font
   setFont(RA8876_FONT_SIZE_16);
   setTextScale(1);
 
   // ensure the chip is in graphics mode
-  setGraphicsMode();
+  _spiBegin();
+  err = setGraphicsMode();
+  _spiEnd();
+  if (err != RA8876_OK) goto ra8876_init_done;
 
   // if we got here, we are good
   ok = true;
@@ -713,7 +956,7 @@ RA8876::colorBarTest(bool enabled)
 {
   uint8_t reg;
 
-  SPI.beginTransaction(m_spiSettings);
+  _spiBegin();
 
   // toggle the display test color bar bit as needed
   reg = regRead(RA8876_REG_DPCR);
@@ -721,7 +964,52 @@ RA8876::colorBarTest(bool enabled)
   else         reg = (reg & ~RA8876_REG_DPCR_TEST_MASK) | RA8876_REG_DPCR_TEST_DISABLE;
   regWrite(RA8876_REG_DPCR, reg);
 
-  SPI.endTransaction();
+  _spiEnd();
+}
+
+//--------------------------------------------------------------------------
+// SPI bus statistics
+
+RA8876SpiStats
+RA8876::getSpiStats()
+{
+  return m_spiStats;
+}
+
+void
+RA8876::resetSpiStats()
+{
+  m_spiStats.bytes     = 0;
+  m_spiStats.frames    = 0;
+  m_spiStats.transfers = 0;
+
+  m_spiStats.readsAvoided  = 0;
+  m_spiStats.writesAvoided = 0;
+  m_spiStats.mismatches    = 0;
+}
+
+//--------------------------------------------------------------------------
+// interrupt
+//
+// the INT output of the controller is optional; when wired (intPin in the
+// constructor) the core task and serial flash DMA finished interrupts are
+// enabled and engine completion is signalled by the ISR rather than polled
+// over SPI. one instance only: the ISR has no context argument.
+
+void
+RA8876::_isr()
+{
+  RA8876 *self = m_intInstance;
+
+  if (self == NULL) return;
+  self->m_intPending = true;
+  if (self->m_intCallback != NULL) self->m_intCallback();
+}
+
+void
+RA8876::setCompletionCallback(RA8876Callback cb)
+{
+  m_intCallback = cb;
 }
 
 //--------------------------------------------------------------------------
@@ -740,572 +1028,3337 @@ RA8876::getDisplayHeight()
 };
 
 //--------------------------------------------------------------------------
-// chip mode
-
+// vertical blank and frame pacing
+//
+// a line is the visible pixels, the front porch, the sync pulse and the
+// back porch; a frame is the visible rows followed by as many lines of
+// front porch, sync and back porch. the vertical sync flag is raised as
+// the last visible pixel has been scanned: the horizontal blank of that
+// row and all lines of the vertical blank go by before the first visible
+// pixel, which is the time a front buffer can be updated (or the main
+// window moved) without tearing.
+
+// the scan as the chip runs it: the timing registers count the porches
+// and pulses in steps of 8 pixels, so the totals can be a few clocks off
+// the RA8876DisplayInfo they were derived from
 void
-RA8876::setTextMode()
+RA8876::scanTiming(uint32_t *hTotal, uint32_t *vTotal, uint32_t *hBlank, uint32_t *vBlank)
 {
-  uint8_t reg;
+  uint32_t width, height;
+
+  width   = ((uint32_t)m_timing->hdwr + 1) * 8 + m_timing->hdwftr;
+  height  = (((uint32_t)m_timing->vdhr1 << 8) | m_timing->vdhr0) + 1;
+  *hBlank = ((uint32_t)m_timing->hndr + 1) * 8 + m_timing->hndftr +   // back porch
+            ((uint32_t)m_timing->hstr + 1) * 8 +                      // front porch
+            ((uint32_t)m_timing->hpwr + 1) * 8;                       // sync
+  *vBlank = ((((uint32_t)m_timing->vndr1 << 8) | m_timing->vndr0) + 1) +
+            ((uint32_t)m_timing->vstr + 1) +
+            ((uint32_t)m_timing->vpwr + 1);
+  *hTotal = width  + *hBlank;
+  *vTotal = height + *vBlank;
+}
 
-  // restore text colour
-  regWrite(RA8876_REG_FGCR, m_textColor.r);
-  regWrite(RA8876_REG_FGCG, m_textColor.g);
-  regWrite(RA8876_REG_FGCB, m_textColor.b);
+uint32_t
+RA8876::getFrameTime()
+{
+  uint32_t hTotal, vTotal, hBlank, vBlank, clk;
 
-  // wait for previous tasks to complete
-  waitUntilStatusIdle();
+  scanTiming(&hTotal, &vTotal, &hBlank, &vBlank);
 
-  // set text mode
-  reg = regRead(RA8876_REG_ICR);
-  reg = (reg & ~RA8876_REG_ICR_MODE_MASK) | RA8876_REG_ICR_MODE_TEXT;
-  regWrite(RA8876_REG_ICR, reg);
+  // the scan clock the PLL actually runs at, not the one asked for
+  clk = (m_clocks->scan.freq != 0) ? m_clocks->scan.freq : m_displayInfo->dotClock;
+
+  return (uint32_t)(((uint64_t)hTotal * vTotal * 1000) / clk);
 }
 
-void
-RA8876::setGraphicsMode()
+uint32_t
+RA8876::getBlankTime()
 {
-  uint8_t reg;
+  uint32_t hTotal, vTotal, hBlank, vBlank, clk;
 
-  // wait for previous tasks to complete
-  waitUntilStatusIdle();
+  scanTiming(&hTotal, &vTotal, &hBlank, &vBlank);
+  clk = (m_clocks->scan.freq != 0) ? m_clocks->scan.freq : m_displayInfo->dotClock;
 
-  // set graphics mode
-  reg = regRead(RA8876_REG_ICR);
-  reg = (reg & ~RA8876_REG_ICR_MODE_MASK) | RA8876_REG_ICR_MODE_GRAPHIC;
-  regWrite(RA8876_REG_ICR, reg);
+  // the rest of the last visible row and every line of the vertical blank
+  return (uint32_t)((((uint64_t)vBlank * hTotal + hBlank) * 1000) / clk);
 }
 
-//--------------------------------------------------------------------------
-// drawing
+// returns as the next vertical blank starts (or straight away when the
+// last one is still usable)
+RA8876Error
+RA8876::waitForVBlank()
+{
+  RA8876Error err;
+  uint32_t    frame, phase, start, before;
 
-void
-RA8876::clearScreen(Color color) 
-{ 
-  setTextCursor(0, 0); 
-  fillRectangle(0, 0, m_width, m_height, color);
-};
+  // default return value
+  err = RA8876_OK;
 
-void
-RA8876::putPixel(uint16_t x, uint16_t y, Color color)
-{
-  SPI.beginTransaction(m_spiSettings);
-
-  // set the location of the pixel
-  regWrite(RA8876_REG_CURH0,  x       & 0xff);
-  regWrite(RA8876_REG_CURH1, (x >> 8) & 0xff);
-  regWrite(RA8876_REG_CURV0,  y       & 0xff);
-  regWrite(RA8876_REG_CURV1, (y >> 8) & 0xff);
+  frame = getFrameTime();
 
-  // draw the pixel
-  switch (m_depth)
-  {
-    case 24:
-         {
-           _spiCmdWrite(RA8876_REG_MRWDP);
-           _spiDatWrite(color.b);
-           _spiDatWrite(color.g);
-           _spiDatWrite(color.r);
-         }
-         break;
+  _spiBegin();
 
-    case 16:
-         {
-           uint16_t rgb565 = color.toRGB565();
-           _spiCmdWrite(RA8876_REG_MRWDP);
-           _spiDatWrite( rgb565       & 0xff);
-           _spiDatWrite((rgb565 >> 8) & 0xff);
-         }
-         break;
+  // where the scan is, from the last sync seen
+  phase = m_vblankValid ? ((micros() - m_vblankAt) % frame) : 0;
 
-    case 8:
-         {
-           uint8_t rgb332 = color.toRGB332();
-          _spiCmdWrite(RA8876_REG_MRWDP);
-          _spiDatWrite( rgb332       & 0xff);
-         }
-         break;
+  if (m_vblankValid && (phase < getBlankTime()) &&
+      (regReadRaw(RA8876_REG_INTF) & RA8876_REG_INT_VSYNC))
+  {
+    // this blank has only just started, it is still usable
+    m_vblankAt = micros() - phase;
+    m_waitHistogram[RA8876_WAIT_VSYNC][0]++;
   }
-
-  SPI.endTransaction();
-}
-
-void
-RA8876::putPixels(uint16_t x, uint16_t y, Color *color, size_t cnt)
-{
-  SPI.beginTransaction(m_spiSettings);
-
-  // set the location of the pixel
-  regWrite(RA8876_REG_CURH0,  x       & 0xff);
-  regWrite(RA8876_REG_CURH1, (x >> 8) & 0xff);
-  regWrite(RA8876_REG_CURV0,  y       & 0xff);
-  regWrite(RA8876_REG_CURV1, (y >> 8) & 0xff);
-
-  // draw the pixel
-  switch (m_depth)
+  else
   {
-    case 24:
-         {
-           _spiCmdWrite(RA8876_REG_MRWDP);
-           for (size_t i=0; i<cnt; i++)
-           {
-             _spiDatWrite(color[i].b);
-             _spiDatWrite(color[i].g);
-             _spiDatWrite(color[i].r);
-           }
-         }
-         break;
-
-    case 16:
-         {
-           _spiCmdWrite(RA8876_REG_MRWDP);
-           for (size_t i=0; i<cnt; i++)
-           {
-             uint16_t rgb565 = color[i].toRGB565();
-             _spiDatWrite( rgb565       & 0xff);
-             _spiDatWrite((rgb565 >> 8) & 0xff);
-           }
-         }
-         break;
+    // a stale flag is cleared first, before sleeping: a sync that comes
+    // while sleeping towards the predicted one (the prediction drifts) is
+    // then still caught, on the first poll
+    regWrite(RA8876_REG_INTF, RA8876_REG_INT_VSYNC);
+    before = micros();
+    if (m_vblankValid && ((frame - phase) > RA8876_VBLANK_MARGIN))
+      delayMicroseconds(frame - phase - RA8876_VBLANK_MARGIN);
+
+    // the sync came after the last poll that did not see it: that poll is
+    // taken as the start of the blank, so the time left is never over
+    // estimated by the poll interval
+    start = micros();
+    while ((regReadRaw(RA8876_REG_INTF) & RA8876_REG_INT_VSYNC) == 0)
+    {
+      before = micros();
+      if ((before - start) >= m_waitTimeout[RA8876_WAIT_VSYNC])
+      {
+        err = RA8876_ERROR_TIMEOUT;
+        break;
+      }
+      delayMicroseconds(RA8876_VBLANK_POLL);
+    }
+    waitRecord(RA8876_WAIT_VSYNC, err, micros() - start);
 
-    case 8:
-         {
-           _spiCmdWrite(RA8876_REG_MRWDP);
-           for (size_t i=0; i<cnt; i++)
-           {
-             uint8_t rgb332 = color[i].toRGB332();
-             _spiDatWrite( rgb332       & 0xff);
-           }
-         }
-         break;
+    if (err == RA8876_OK)
+    {
+      m_vblankAt    = before;
+      m_vblankValid = true;
+    }
   }
 
-  SPI.endTransaction();
-}
+  // the flag is consumed
+  regWrite(RA8876_REG_INTF, RA8876_REG_INT_VSYNC);
 
-void
-RA8876::drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color)
-{
-  drawTwoPointShape(x1, y1, x2, y2, color, RA8876_REG_DCR0, RA8876_REG_DCR0_DRAW_LINE);
-};
+  _spiEnd();
 
-void
-RA8876::drawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color)
-{ 
-  drawTwoPointShape(x1, y1, x2, y2, color, RA8876_REG_DCR1, RA8876_REG_DCR1_DRAW_RECT);
-};
+  return err;
+}
 
-void
-RA8876::fillRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color)
+uint32_t
+RA8876::getBlankTimeLeft()
 {
-  drawTwoPointShape(x1, y1, x2, y2, color, RA8876_REG_DCR1, RA8876_REG_DCR1_DRAW_RECT_FILL);
-};
+  uint32_t since, blank;
 
-void
-RA8876::drawTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, Color color)
-{
-  drawThreePointShape(x1, y1, x2, y2, x3, y3, color, RA8876_REG_DCR0, RA8876_REG_DCR0_DRAW_TRIANGLE);
-};
+  if (!m_vblankValid) return 0;
 
-void
-RA8876::fillTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, Color color)
-{
-  drawThreePointShape(x1, y1, x2, y2, x3, y3, color, RA8876_REG_DCR0, RA8876_REG_DCR0_DRAW_TRIANGLE_FILL);
-};
+  since = (micros() - m_vblankAt) % getFrameTime();
+  blank = getBlankTime();
+  return (since < blank) ? (blank - since) : 0;
+}
 
 void
-RA8876::drawCircle(uint16_t x, uint16_t y, uint16_t radius, Color color)
+RA8876::setFrameBudget(uint32_t bytes)
 {
-  drawEllipseShape(x, y, radius, radius, color, RA8876_REG_DCR1, RA8876_REG_DCR1_DRAW_CIRCLE);
-};
+  m_frameBudget = bytes;
+}
 
-void
-RA8876::fillCircle(uint16_t x, uint16_t y, uint16_t radius, Color color)
+// one call per frame: finishes the last frame, waits for the blank and
+// renews the byte budget. a ticker that moves one step after every call
+// runs at the refresh rate, and work larger than the budget is spread
+// over as many frames as it needs
+RA8876Error
+RA8876::beginFrame()
 {
-  drawEllipseShape(x, y, radius, radius, color, RA8876_REG_DCR1, RA8876_REG_DCR1_DRAW_CIRCLE_FILL);
-};
+  RA8876Error err;
+  uint32_t    frame, interval, n, error;
 
-void
-RA8876::drawEllipse(uint16_t x, uint16_t y, uint16_t x_radius, uint16_t y_radius, Color color)
-{
-  drawEllipseShape(x, y, x_radius, y_radius, color, RA8876_REG_DCR1, RA8876_REG_DCR1_DRAW_ELLIPSE);
-};
+  // the last frame must be out of the way
+  err = flush();
+  if (err != RA8876_OK) return err;
 
-void
-RA8876::fillEllipse(uint16_t x, uint16_t y, uint16_t x_radius, uint16_t y_radius, Color color)
-{
-  drawEllipseShape(x, y, x_radius, y_radius, color, RA8876_REG_DCR1, RA8876_REG_DCR1_DRAW_ELLIPSE_FILL);
-};
+  if ((m_frameStats.frames != 0) && (m_frameBudget != 0) &&
+      ((m_spiStats.bytes - m_frameBytes) > m_frameBudget)) m_frameStats.overBudget++;
 
-//--------------------------------------------------------------------------
-// bte engine
-void
-RA8876::bteMemoryCopy(uint16_t sx, uint16_t sy, uint16_t dx, uint16_t dy, uint16_t w, uint16_t h)
-{
-  uint8_t reg;
+  err = waitForVBlank();
+  if (err != RA8876_OK) return err;
 
-  SPI.beginTransaction(m_spiSettings);
+  // how far the frames are from a steady rate
+  if (m_frameStats.frames != 0)
+  {
+    frame    = getFrameTime();
+    interval = m_vblankAt - m_frameAt;
+    n        = (interval + (frame / 2)) / frame;
+    error    = (interval > (n * frame)) ? (interval - (n * frame)) : ((n * frame) - interval);
+
+    if (n > 1) m_frameStats.missed += n - 1;
+    if (error > m_frameStats.maxErrorUs) m_frameStats.maxErrorUs = error;
+    m_frameStats.lastUs = interval;
+  }
+  m_frameStats.frames++;
 
-  // set S0 co-ordinates
-  regWrite(RA8876_REG_BTE_S0_X0,    sx       & 0xff);
-  regWrite(RA8876_REG_BTE_S0_X1,   (sx >> 8) & 0xff);
-  regWrite(RA8876_REG_BTE_S0_Y0,    sy       & 0xff);
-  regWrite(RA8876_REG_BTE_S0_Y1,   (sy >> 8) & 0xff);
+  m_frameAt    = m_vblankAt;
+  m_frameBytes = m_spiStats.bytes;
 
-  // set DEST co-ordinates
-  regWrite(RA8876_REG_BTE_DEST_X0,  dx       & 0xff);
-  regWrite(RA8876_REG_BTE_DEST_X1, (dx >> 8) & 0xff);
-  regWrite(RA8876_REG_BTE_DEST_Y0,  dy       & 0xff);
-  regWrite(RA8876_REG_BTE_DEST_Y1, (dy >> 8) & 0xff);
-
-  // set the copy width and height
-  regWrite(RA8876_REG_BTE_WTH0,     w       & 0xff);
-  regWrite(RA8876_REG_BTE_WTH1,    (w >> 8) & 0xff);
-  regWrite(RA8876_REG_BTE_HIG0,     h       & 0xff);
-  regWrite(RA8876_REG_BTE_HIG1,    (h >> 8) & 0xff);
-
-  // define the BTE mode to use - simply copy source to destination
-  reg = RA8876_REG_BTE_ROP_CODE_12 | RA8876_REG_BTE_MEM_CPY_ROP; // copy with ROP where DEST = S0
-  regWrite(RA8876_REG_BTE_CTRL1, reg);
+  return err;
+}
 
-  // start the operation
-  reg = regRead(RA8876_REG_BTE_CTRL0);
-  reg |= RA8876_REG_BTE_ENABLE;
-  regWrite(RA8876_REG_BTE_CTRL0, reg);
+// 0xffffffff without a budget
+uint32_t
+RA8876::getFrameBytesLeft()
+{
+  uint32_t used;
 
-  // wait for completion
-  waitUntilStatusIdle();
+  if (m_frameBudget == 0) return 0xffffffff;
 
-  SPI.endTransaction();
+  used = m_spiStats.bytes - m_frameBytes;
+  return (used < m_frameBudget) ? (m_frameBudget - used) : 0;
 }
 
-//--------------------------------------------------------------------------
-// font utils
-
-uint8_t
-RA8876::getFontEncoding(RA8876FontEncoding enc)
+RA8876FrameStats
+RA8876::getFrameStats()
 {
-  uint8_t e;
-  switch (enc)
-  {
-    case RA8876_FONT_ENCODING_8859_2: e = 0x01; break;
-    case RA8876_FONT_ENCODING_8859_4: e = 0x02; break;
-    case RA8876_FONT_ENCODING_8859_5: e = 0x03; break;
-    default:                          e = 0x00; break; // ISO-8859-1
-  }
+  return m_frameStats;
+}
 
-  return e;
+void
+RA8876::resetFrameStats()
+{
+  memset(&m_frameStats, 0, sizeof(m_frameStats));
 }
 
-void 
-RA8876::setFont(RA8876FontSize sz, RA8876FontEncoding enc)
+//--------------------------------------------------------------------------
+// virtual canvas and hardware scrolling
+//
+// a display page can be larger than the screen. the main window shows a
+// screen sized part of it from the scroll position on: content is drawn
+// once and moving the window costs a register update, no pixels. the
+// chip ties the low two bits of the window X position and of the image
+// width to 0, so horizontal steps are 4 pixels.
+
+RA8876Error
+RA8876::setVirtualSize(uint16_t w, uint16_t h)
 {
-  m_fontSize   = sz;
-  m_fontFlags  = 0;
+  RA8876Error err;
+  uint32_t    size;
 
-  SPI.beginTransaction(m_spiSettings);
+  if ((w < m_width) || (h < m_height)) return RA8876_ERROR_PARAMETER;
+  w = (w + 3) & ~3;
 
-  regWrite(RA8876_REG_CCR0, 0x00 | ((sz & 0x03) << 4) | getFontEncoding(enc));
+  // every display page grows, the surfaces above must stay clear
+  size = (uint32_t)w * h * m_bpp;
+  if ((m_pages * size) > m_ramTop) return RA8876_ERROR_MEMORY;
 
-  uint8_t ccr1 = regRead(RA8876_REG_CCR1);
-  ccr1 |= 0x40;  // transparent background
-  regWrite(RA8876_REG_CCR1, ccr1);
+  // the pages are laid out again; nothing may still be drawing into them
+  err = flush();
+  if (err != RA8876_OK) return err;
 
-  SPI.endTransaction();
-}
+  _spiBegin();
 
-void 
-RA8876::setTextCursor(uint16_t x, uint16_t y)
-{
-  SPI.beginTransaction(m_spiSettings);
+  err = waitUntilStatusIdle();
+  if (err == RA8876_OK)
+  {
+    m_virtualWidth  = w;
+    m_virtualHeight = h;
+    m_pageSize      = size;
+
+    regWrite32(RA8876_REG_MISA0, m_showPage * m_pageSize);
+    regWrite16(RA8876_REG_MIW0,  m_virtualWidth);
+    scrollTo(0, 0);
+    setCanvasPage(m_drawPage);
+  }
 
-  regWrite16(RA8876_REG_F_CURX0,  x       & 0xff);
-  regWrite16(RA8876_REG_F_CURX1, (x >> 8) & 0xff);
-  regWrite16(RA8876_REG_F_CURY0,  y       & 0xff);
-  regWrite16(RA8876_REG_F_CURY1, (y >> 8) & 0xff);
+  _spiEnd();
 
-  SPI.endTransaction();
+  return err;
 }
 
-uint16_t 
-RA8876::getTextCursorX()
+uint16_t
+RA8876::getVirtualWidth()
 {
-  uint16_t x;
-
-  SPI.beginTransaction(m_spiSettings);
-  x  = (uint16_t)regRead(RA8876_REG_F_CURX0);
-  x |= (uint16_t)regRead(RA8876_REG_F_CURX1) << 8;
-  SPI.endTransaction();
-
-  return x;
+  return m_virtualWidth;
 }
 
-uint16_t 
-RA8876::getTextCursorY()
+uint16_t
+RA8876::getVirtualHeight()
 {
-  uint16_t y;
-
-  SPI.beginTransaction(m_spiSettings);
-  y  = (uint16_t)regRead(RA8876_REG_F_CURY0);
-  y |= (uint16_t)regRead(RA8876_REG_F_CURY1) << 8;
-  SPI.endTransaction();
-
-  return y;
+  return m_virtualHeight;
 }
 
-uint16_t 
-RA8876::getTextHeight()
+// takes effect with the next frame scanned; call it right after
+// waitForVBlank() (or beginFrame()) for a scroll without tearing
+void
+RA8876::scrollTo(uint16_t x, uint16_t y)
 {
-  return ((m_fontSize + 2) * 8) * m_textScaleY;
+  if (x > (m_virtualWidth  - m_width))  x = m_virtualWidth  - m_width;
+  if (y > (m_virtualHeight - m_height)) y = m_virtualHeight - m_height;
+  x &= ~3;
+
+  // unchanged halves are not sent (shadow cache)
+  _spiBegin();
+  regWrite16(RA8876_REG_MWULX0, x);
+  regWrite16(RA8876_REG_MWULY0, y);
+  _spiEnd();
+
+  m_scrollX = x;
+  m_scrollY = y;
 }
 
-uint16_t 
-RA8876::getTextWidth()
+uint16_t
+RA8876::getScrollX()
 {
-  return ((m_fontSize + 2) * 4) * m_textScaleY;
+  return m_scrollX;
 }
 
-void
-RA8876::setTextColor(Color color) 
-{ 
-  m_textColor = color;
+uint16_t
+RA8876::getScrollY()
+{
+  return m_scrollY;
 }
 
+//--------------------------------------------------------------------------
+// double buffering
+//
+// SDRAM holds two display pages back to back. drawing (geometry, BTE,
+// text and memory writes) targets the canvas page (CVSSA) while the main
+// window (MISA) shows the other; present() swaps them at vertical sync so
+// a complete frame appears at once.
+
 void
-RA8876::setTextScale(int scale) 
+RA8876::setCanvasPage(uint8_t page)
 {
-  setTextScale(scale, scale);
+  m_drawPage = page;
+  applyCanvas();
 }
 
+// the canvas (geometry, text, memory writes and bte destination) is the
+// draw page or a surface
 void
-RA8876::setTextScale(int xScale, int yScale)
+RA8876::applyCanvas()
 {
-  uint8_t reg;
-
-  xScale = constrain(xScale, 1, 4); // keep within values 1, 2, 3 and 4
-  yScale = constrain(yScale, 1, 4); // keep within values 1, 2, 3 and 4
-
-  m_textScaleX = xScale;
-  m_textScaleY = yScale;
-
-  SPI.beginTransaction(m_spiSettings);
+  uint32_t addr;
+  uint32_t height;
+  uint16_t stride;
 
-  reg = regRead(RA8876_REG_CCR1);
-  reg = (reg & ~RA8876_REG_CCR1_XSCALE_MASK) | RA8876_REG_CCR1_XSCALE(xScale - 1);
-  reg = (reg & ~RA8876_REG_CCR1_YSCALE_MASK) | RA8876_REG_CCR1_YSCALE(yScale - 1);
-  regWrite(RA8876_REG_CCR1, reg);
+  if (m_canvas != NULL)
+  {
+    addr          = m_canvas->addr;
+    stride        = m_canvas->stride;
+    height        = m_canvas->height;
+    m_canvasWidth = m_canvas->width;
+  }
+  else
+  {
+    addr          = m_drawPage * m_pageSize;
+    stride        = m_virtualWidth;
+    m_canvasWidth = m_virtualWidth;
 
-  SPI.endTransaction();
+    // the logical height is whatever RAM is left above the page
+    height = (m_ramTop - addr) / ((uint32_t)m_virtualWidth * m_bpp);
+  }
+  if (height > 4095) height = 4095;
+  m_canvasHeight = height;
+  m_canvasAddr   = addr;
+  m_canvasStride = stride;
+
+  // canvas and BTE windows follow
+  regWrite32(RA8876_REG_CVSSA0,        addr);
+  regWrite16(RA8876_REG_CVS_IMWTH0,    stride);
+  regWrite32(RA8876_REG_BTE_S0_STR0,   addr);
+  regWrite32(RA8876_REG_BTE_S1_STR0,   addr);
+  regWrite16(RA8876_REG_BTE_S1_WTH0,   stride);
+  regWrite32(RA8876_REG_BTE_DEST_STR0, addr);
+  regWrite16(RA8876_REG_BTE_DEST_WTH0, stride);
+  applyClip();
 }
 
-void
-RA8876::putChar(char c) 
+RA8876Error
+RA8876::setDoubleBuffer(bool enabled)
 {
-  putChars(&c, 1);
-}
+  RA8876Error err;
 
-void
-RA8876::putChars(const char *buf, size_t sz)
-{
-  SPI.beginTransaction(m_spiSettings);
+  // nothing may still be drawing into the current canvas
+  err = flush();
+  if (err != RA8876_OK) return err;
 
-  setTextMode();
+  if (enabled && ((2 * m_pageSize) > m_ramTop)) return RA8876_ERROR_MEMORY;
 
-  // write characters
-  _spiCmdWrite(RA8876_REG_MRWDP);
-  for (size_t i = 0; i < sz; i++)
+  _spiBegin();
+  err = waitUntilStatusIdle();
+  if (err == RA8876_OK)
   {
-    _spiDatWrite(buf[i]);
-    waitUntilEmptyFifoWrite();
+    m_pages  = enabled ? 2 : 1;
+    m_canvas = NULL;
+    setCanvasPage(enabled ? (m_showPage ^ 1) : m_showPage);
   }
+  _spiEnd();
 
-  setGraphicsMode();
-
-  SPI.endTransaction();
+  return err;
 }
 
-void
-RA8876::putChar16(uint16_t c)
+RA8876Error
+RA8876::present(bool copy)
 {
-  putChars16(&c, 1);
-}
+  RA8876Error   err;
+  RA8876Command c;
+  uint8_t       shown;
 
-void
-RA8876::putChars16(const uint16_t *buf, size_t sz)
-{
-  SPI.beginTransaction(m_spiSettings);
+  // the frame must be complete before it is shown
+  err = flush();
+  if (err != RA8876_OK) return err;
+  if (m_pages < 2) return err;
 
-  // this is a text mode operation
-  setTextMode();
+  _spiBegin();
 
-  // write characters
-  _spiCmdWrite(RA8876_REG_MRWDP);
-  for (size_t i = 0; i < sz; i++)
+  err = waitUntilStatusIdle();
+  if (err != RA8876_OK) goto ra8876_present_done;
+
+  // flip during vertical sync
+  err = waitForVBlank();
+  if (err != RA8876_OK) goto ra8876_present_done;
+  regWrite32(RA8876_REG_MISA0, m_drawPage * m_pageSize);
+
+  // drawing carries on in the new back page
+  shown      = m_drawPage;
+  m_showPage = shown;
+  m_canvas   = NULL;
+  setCanvasPage(shown ^ 1);
+
+  // optionally start the new back page as a copy of the shown one
+  if (copy)
   {
-    _spiDatWrite((buf[i] >> 8) & 0xff);
-    waitUntilEmptyFifoWrite();
-    _spiDatWrite( buf[i]       & 0xff);
-    waitUntilEmptyFifoWrite();
+    c.type  = RA8876_COMMAND_BTE_COPY;
+    c.addr  = shown * m_pageSize;
+    c.width = m_virtualWidth;
+    c.p[0] = 0;              c.p[1] = 0;
+    c.p[2] = 0;              c.p[3] = 0;
+    c.p[4] = m_virtualWidth; c.p[5] = m_virtualHeight;
+    err = submit(c);
+    if (err == RA8876_OK) err = flush();
   }
 
-  // revert back to graphics mode
-  setGraphicsMode();
+ra8876_present_done:;
 
-  SPI.endTransaction();
-}
+  _spiEnd();
 
-size_t
-RA8876::write(uint8_t c)
-{
-  return write(&c, 1);
+  return err;
 }
 
-size_t 
-RA8876::write(const uint8_t *buf, size_t sz)
+//--------------------------------------------------------------------------
+// surfaces
+//
+// display memory above the display pages is handed out as surfaces. they
+// are placed top down, each one in the highest free block it fits, so the
+// memory that is left stays in one piece next to the pages where the
+// canvas and a second page can use it. the table only records what is in
+// use: freeing a surface joins its block with the free ones around it.
+
+RA8876Surface *
+RA8876::surfaceFit(uint16_t w, uint16_t h, uint8_t depth)
 {
-  SPI.beginTransaction(m_spiSettings);
+  RA8876Surface *s;
+  uint32_t       size, low, top, addr, best;
+  uint16_t       stride;
+  bool           found;
+  int            i, j, slot;
 
-  // this is a text mode operation
-  setTextMode();
+  // default return value
+  s = NULL;
 
-  // set current register for writing to memory
-  _spiCmdWrite(RA8876_REG_MRWDP);
-  for (size_t i = 0; i < sz; i++)
-  {
-    uint8_t c = buf[i];
+  // canvas, bte and pixel packing all work at the one colour depth
+  if ((m_ramInfo == NULL) || (w == 0) || (h == 0) || (depth != RA8876PixelFormat::depth)) return s;
+
+  // image widths are a multiple of 4 pixels
+  stride = (w + 3) & ~3;
+  size   = (uint32_t)stride * h * m_bpp;
+  low    = (uint32_t)m_pages * m_pageSize;
 
-    if (c == '\r'); // ignored
+  // a free block ends at the top of RAM or where a surface starts
+  slot  = -1;
+  best  = 0;
+  found = false;
+  for (i=-1; i<RA8876_SURFACES; i++)
+  {
+    if (i < 0) top = m_ramInfo->sz;
     else
-    if (c == '\n')
     {
-      setTextCursor(0, getTextCursorY() + getTextHeight());
-      _spiCmdWrite(RA8876_REG_MRWDP);  // reset current register for writing to memory
+      if (!m_surfaces[i].used)
+      {
+        if (slot < 0) slot = i;
+        continue;
+      }
+      top = m_surfaces[i].addr;
     }
-    else
-    if ((m_fontFlags & RA8876_FONT_FLAG_XLAT_FULLWIDTH) && ((c >= 0x21) || (c <= 0x7F)))
-    {
-      // translate ASCII to Unicode fullwidth form (for Chinese fonts that lack ASCII)
-      uint16_t fwc = c - 0x21 + 0xFF01;
 
-      _spiDatWrite((fwc >> 8) & 0xff);
-      waitUntilEmptyFifoWrite();
-      _spiDatWrite( fwc       & 0xff);
-      waitUntilEmptyFifoWrite();
-    }
-    else
+    if (top < (low + size)) continue;
+    addr = (top - size) & ~((uint32_t)RA8876_SURFACE_ALIGN - 1);
+    if (addr < low) continue;
+
+    // the block must really be free down to addr
+    for (j=0; j<RA8876_SURFACES; j++)
     {
-      _spiDatWrite(c);
-      waitUntilEmptyFifoWrite();
+      if (m_surfaces[j].used &&
+          (addr < (m_surfaces[j].addr + m_surfaces[j].size)) && (m_surfaces[j].addr < (addr + size))) break;
     }
+    if (j < RA8876_SURFACES) continue;
+
+    if (!found || (addr > best)) best = addr;
+    found = true;
   }
+  if (!found || (slot < 0)) return s;
 
-  // revert back to graphics mode
-  setGraphicsMode();
+  s = &m_surfaces[slot];
+  s->addr   = best;
+  s->size   = size;
+  s->width  = w;
+  s->height = h;
+  s->stride = stride;
+  s->depth  = depth;
+  s->used   = true;
 
-  SPI.endTransaction();
+  if (best < m_ramTop) m_ramTop = best;
 
-  return sz;
+  return s;
 }
 
-//--------------------------------------------------------------------------
-// low-level drawing operations
-
-void
-RA8876::drawTwoPointShape(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color, uint8_t reg, uint8_t cmd)
+// the canvas of a page reaches up to the lowest surface; after a surface
+// is freed it may grow
+RA8876Error
+RA8876::surfaceChanged()
 {
-  SPI.beginTransaction(m_spiSettings);
+  RA8876Error err;
+  uint32_t    top;
+  int         i;
+
+  // default return value
+  err = RA8876_OK;
+
+  top = m_ramInfo->sz;
+  for (i=0; i<RA8876_SURFACES; i++)
+    if (m_surfaces[i].used && (m_surfaces[i].addr < top)) top = m_surfaces[i].addr;
+  if (top == m_ramTop) return err;
+  m_ramTop = top;
 
-  // first point
-  regWrite(RA8876_REG_DLHSR0,  x1       & 0xff);
-  regWrite(RA8876_REG_DLHSR1, (x1 >> 8) & 0xff);
-  regWrite(RA8876_REG_DLVSR0,  y1       & 0xff);
-  regWrite(RA8876_REG_DLVSR1, (y1 >> 8) & 0xff);
+  if (m_canvas == NULL)
+  {
+    _spiBegin();
+    err = waitUntilStatusIdle();
+    if (err == RA8876_OK) applyCanvas();
+    _spiEnd();
+  }
+
+  return err;
+}
 
-  // second point
-  regWrite(RA8876_REG_DLHER0,  x2       & 0xff);
-  regWrite(RA8876_REG_DLHER1, (x2 >> 8) & 0xff);
-  regWrite(RA8876_REG_DLVER0,  y2       & 0xff);
-  regWrite(RA8876_REG_DLVER1, (y2 >> 8) & 0xff);
+const RA8876Surface *
+RA8876::allocSurface(uint16_t w, uint16_t h, uint8_t depth)
+{
+  RA8876Surface *s;
+  uint32_t       top;
 
-  // colour
-  regWrite(RA8876_REG_FGCR,    color.r);
-  regWrite(RA8876_REG_FGCG,    color.g);
-  regWrite(RA8876_REG_FGCB,    color.b);
+  // nothing may still be drawing into the memory the surface takes
+  if (flush() != RA8876_OK) return NULL;
 
-  // draw
-  regWrite(reg, cmd);
+  top = m_ramTop;
+  s   = surfaceFit(w, h, depth);
+  if ((s == NULL) || (m_ramTop == top) || (m_canvas != NULL)) return s;
 
-  // wait for completion
-  waitUntilStatusIdle();
+  // the canvas of the page must not reach into the new surface
+  _spiBegin();
+  if (waitUntilStatusIdle() == RA8876_OK) applyCanvas();
+  else
+  {
+    s->used  = false;
+    s        = NULL;
+    m_ramTop = top;
+  }
+  _spiEnd();
 
-  SPI.endTransaction();
+  return s;
 }
 
-void
-RA8876::drawThreePointShape(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, Color color, uint8_t reg, uint8_t cmd)
+RA8876Error
+RA8876::freeSurface(const RA8876Surface *surface)
 {
-  SPI.beginTransaction(m_spiSettings);
-
-  // first point
-  regWrite(RA8876_REG_DLHSR0,  x1       & 0xff);
-  regWrite(RA8876_REG_DLHSR1, (x1 >> 8) & 0xff);
-  regWrite(RA8876_REG_DLVSR0,  y1       & 0xff);
-  regWrite(RA8876_REG_DLVSR1, (y1 >> 8) & 0xff);
+  RA8876Error err;
+  int         i;
 
-  // second point
-  regWrite(RA8876_REG_DLHER0,  x2       & 0xff);
-  regWrite(RA8876_REG_DLHER1, (x2 >> 8) & 0xff);
-  regWrite(RA8876_REG_DLVER0,  y2       & 0xff);
-  regWrite(RA8876_REG_DLVER1, (y2 >> 8) & 0xff);
+  for (i=0; i<RA8876_SURFACES; i++)
+    if ((&m_surfaces[i] == surface) && m_surfaces[i].used) break;
 
-  // third point
-  regWrite(RA8876_REG_DTPH0,   x3       & 0xff);
-  regWrite(RA8876_REG_DTPH1,  (x3 >> 8) & 0xff);
-  regWrite(RA8876_REG_DTPV0,   y3       & 0xff);
-  regWrite(RA8876_REG_DTPV1,  (y3 >> 8) & 0xff);
+  // the pattern tiles and the text cache belong to the driver
+  if ((i == RA8876_SURFACES) || (surface == m_patterns) || (surface == m_textCache)) return RA8876_ERROR_PARAMETER;
 
-  // colour
-  regWrite(RA8876_REG_FGCR,   color.r);
-  regWrite(RA8876_REG_FGCG,   color.g);
-  regWrite(RA8876_REG_FGCB,   color.b);
+  // a queued copy may still read from it
+  err = flush();
+  if (err != RA8876_OK) return err;
 
-  // draw
-  regWrite(reg, cmd);
+  if (m_canvas == surface)
+  {
+    err = setCanvas(NULL);
+    if (err != RA8876_OK) return err;
+  }
 
-  // wait for completion
-  waitUntilStatusIdle();
+  // a window must not show the memory once it is handed out again
+  for (int p=RA8876_PIP_1; p<=RA8876_PIP_2; p++)
+  {
+    if (m_pip[p].surface != surface) continue;
+    showPip((RA8876PipWindow)p, false);
+    m_pip[p].surface = NULL;
+  }
 
-  SPI.endTransaction();
+  m_surfaces[i].used = false;
+  return surfaceChanged();
 }
 
-void
-RA8876::drawEllipseShape(uint16_t x, uint16_t y, uint16_t xrad, uint16_t yrad, Color color, uint8_t reg, uint8_t cmd)
+RA8876SurfaceStats
+RA8876::getSurfaceStats()
 {
-  SPI.beginTransaction(m_spiSettings);
+  RA8876SurfaceStats st;
+  uint32_t           addr, end, gap, free;
+  int                i, next;
 
-  // first point
-  regWrite(RA8876_REG_DEHR0,   x       & 0xff);
-  regWrite(RA8876_REG_DEHR1,  (x >> 8) & 0xff);
-  regWrite(RA8876_REG_DEVR0,   y       & 0xff);
-  regWrite(RA8876_REG_DEVR1,  (y >> 8) & 0xff);
+  memset(&st, 0, sizeof(st));
+  if (m_ramInfo == NULL) return st;
 
-  // radii
-  regWrite(RA8876_REG_ELL_A0,  xrad       & 0xff);
-  regWrite(RA8876_REG_ELL_A1, (xrad >> 8) & 0xff);
-  regWrite(RA8876_REG_ELL_B0,  yrad       & 0xff);
-  regWrite(RA8876_REG_ELL_B1, (yrad >> 8) & 0xff);
+  addr     = (uint32_t)m_pages * m_pageSize;
+  st.total = m_ramInfo->sz - addr;
 
-  // colour
-  regWrite(RA8876_REG_FGCR,    color.r);
-  regWrite(RA8876_REG_FGCG,    color.g);
-  regWrite(RA8876_REG_FGCB,    color.b);
+  // walk the surfaces in address order, the gaps between them are free
+  free = 0;
+  do
+  {
+    next = -1;
+    for (i=0; i<RA8876_SURFACES; i++)
+    {
+      if (m_surfaces[i].used && (m_surfaces[i].addr >= addr) &&
+          ((next < 0) || (m_surfaces[i].addr < m_surfaces[next].addr))) next = i;
+    }
 
-  // draw
-  regWrite(reg, cmd);
+    end = (next < 0) ? m_ramInfo->sz : m_surfaces[next].addr;
+    gap = end - addr;
+    if (gap != 0)
+    {
+      st.freeBlocks++;
+      free += gap;
+      if (gap > st.largest) st.largest = gap;
+    }
+
+    if (next >= 0)
+    {
+      st.surfaces++;
+      st.used += m_surfaces[next].size;
+      addr     = m_surfaces[next].addr + m_surfaces[next].size;
+    }
+  }
+  while (next >= 0);
+
+  st.fragmentation = (free != 0) ? (uint8_t)(100 - (uint32_t)(((uint64_t)st.largest * 100) / free)) : 0;
+
+  return st;
+}
+
+// drawing goes into the surface until the canvas is set back to the
+// display (NULL); present() always sets it back
+RA8876Error
+RA8876::setCanvas(const RA8876Surface *surface)
+{
+  RA8876Error err;
+
+  // clip regions are canvas co-ordinates
+  if (m_clipDepth != 0) return RA8876_ERROR_CLIP;
+  if ((surface != NULL) && !surface->used) return RA8876_ERROR_PARAMETER;
+
+  // the canvas moves; nothing may still be drawing into it
+  err = flush();
+  if (err != RA8876_OK) return err;
+
+  _spiBegin();
+  err = waitUntilStatusIdle();
+  if (err == RA8876_OK)
+  {
+    m_canvas = surface;
+    applyCanvas();
+  }
+  _spiEnd();
+
+  return err;
+}
+
+//--------------------------------------------------------------------------
+// picture-in-picture windows
+//
+// both windows are programmed through one set of registers (0x2A-0x3B),
+// MPWCTR selects which window they address; they are not shadowed, the
+// state kept in m_pip skips writes that would change nothing. the chip
+// ties the low two bits of the window X position, width and image X to
+// 0, like it does for the main window. changes show with the next frame
+// scanned; make them right after waitForVBlank() to avoid a torn frame
+
+void
+RA8876::pipSelect(RA8876PipWindow pip)
+{
+  uint8_t reg;
+
+  reg = regRead(RA8876_REG_MPWCTR);
+  reg = (reg & ~RA8876_REG_MPWCTR_PIPC_MASK) |
+        ((pip == RA8876_PIP_2) ? RA8876_REG_MPWCTR_PIPC_PIP2 : RA8876_REG_MPWCTR_PIPC_PIP1);
+  regWrite(RA8876_REG_MPWCTR, reg);
+}
+
+// shows w x h pixels of the surface (default: all of it) at x, y on the
+// screen; whether the window is visible does not change
+RA8876Error
+RA8876::setPip(RA8876PipWindow pip, const RA8876Surface *surface, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+  RA8876Pip *p;
+  uint8_t    reg, depth;
+
+  if ((pip > RA8876_PIP_2) || (surface == NULL) || !surface->used) return RA8876_ERROR_PARAMETER;
+
+  if (w == 0) w = surface->width;
+  if (h == 0) h = surface->height;
+  x &= ~3;
+  w &= ~3;
+  if ((w == 0) || (h == 0) || (w > surface->width) || (h > surface->height) ||
+      (((uint32_t)x + w) > (uint32_t)m_width) || (((uint32_t)y + h) > (uint32_t)m_height))
+    return RA8876_ERROR_PARAMETER;
+
+  // the window has its own depth, independent of the main window
+  if      (surface->depth == 8)  depth = RA8876_REG_PIPCDEP_PIP1_8BPP;
+  else if (surface->depth == 16) depth = RA8876_REG_PIPCDEP_PIP1_16BPP;
+  else                           depth = RA8876_REG_PIPCDEP_PIP1_24BPP;
+
+  _spiBegin();
+
+  // PIP2 uses the same codes two bits lower
+  reg = regRead(RA8876_REG_PIPCDEP);
+  if (pip == RA8876_PIP_1) reg = (reg & ~RA8876_REG_PIPCDEP_PIP1_MASK) |  depth;
+  else                     reg = (reg & ~RA8876_REG_PIPCDEP_PIP2_MASK) | (depth >> 2);
+  regWrite(RA8876_REG_PIPCDEP, reg);
+
+  pipSelect(pip);
+  regWrite32(RA8876_REG_PISA0,   surface->addr);
+  regWrite16(RA8876_REG_PIW0,    surface->stride);
+  regWrite16(RA8876_REG_PWIULX0, 0);
+  regWrite16(RA8876_REG_PWIULY0, 0);
+  regWrite16(RA8876_REG_PWW0,    w);
+  regWrite16(RA8876_REG_PWH0,    h);
+  regWrite16(RA8876_REG_PWDULX0, x);
+  regWrite16(RA8876_REG_PWDULY0, y);
+
+  _spiEnd();
+
+  p = &m_pip[pip];
+  p->surface = surface;
+  p->x       = x;
+  p->y       = y;
+  p->w       = w;
+  p->h       = h;
+  p->sx      = 0;
+  p->sy      = 0;
+
+  return RA8876_OK;
+}
+
+RA8876Error
+RA8876::movePip(RA8876PipWindow pip, uint16_t x, uint16_t y)
+{
+  RA8876Pip *p;
+
+  if ((pip > RA8876_PIP_2) || (m_pip[pip].surface == NULL)) return RA8876_ERROR_PARAMETER;
+
+  p  = &m_pip[pip];
+  x &= ~3;
+  if ((((uint32_t)x + p->w) > (uint32_t)m_width) || (((uint32_t)y + p->h) > (uint32_t)m_height))
+    return RA8876_ERROR_PARAMETER;
+
+  if ((x == p->x) && (y == p->y)) return RA8876_OK;
+
+  _spiBegin();
+  pipSelect(pip);
+  if (x != p->x) regWrite16(RA8876_REG_PWDULX0, x);
+  if (y != p->y) regWrite16(RA8876_REG_PWDULY0, y);
+  _spiEnd();
+
+  p->x = x;
+  p->y = y;
+
+  return RA8876_OK;
+}
+
+// moves the part of the surface the window shows (a ticker in a wide
+// surface scrolls without redrawing); clamped to the surface
+RA8876Error
+RA8876::scrollPip(RA8876PipWindow pip, uint16_t sx, uint16_t sy)
+{
+  RA8876Pip *p;
+
+  if ((pip > RA8876_PIP_2) || (m_pip[pip].surface == NULL)) return RA8876_ERROR_PARAMETER;
+
+  p = &m_pip[pip];
+  if (sx > (p->surface->width  - p->w)) sx = p->surface->width  - p->w;
+  if (sy > (p->surface->height - p->h)) sy = p->surface->height - p->h;
+  sx &= ~3;
+
+  if ((sx == p->sx) && (sy == p->sy)) return RA8876_OK;
+
+  _spiBegin();
+  pipSelect(pip);
+  if (sx != p->sx) regWrite16(RA8876_REG_PWIULX0, sx);
+  if (sy != p->sy) regWrite16(RA8876_REG_PWIULY0, sy);
+  _spiEnd();
+
+  p->sx = sx;
+  p->sy = sy;
+
+  return RA8876_OK;
+}
+
+RA8876Error
+RA8876::showPip(RA8876PipWindow pip, bool visible)
+{
+  uint8_t reg, mask;
+
+  if ((pip > RA8876_PIP_2) || (visible && (m_pip[pip].surface == NULL))) return RA8876_ERROR_PARAMETER;
+
+  mask = (pip == RA8876_PIP_1) ? RA8876_REG_MPWCTR_PIP1_MASK : RA8876_REG_MPWCTR_PIP2_MASK;
+
+  // MPWCTR is shadowed, an unchanged state is not sent
+  _spiBegin();
+  reg = regRead(RA8876_REG_MPWCTR);
+  reg = visible ? (reg | mask) : (reg & ~mask);
+  regWrite(RA8876_REG_MPWCTR, reg);
+  _spiEnd();
+
+  m_pip[pip].visible = visible;
+
+  return RA8876_OK;
+}
+
+RA8876Pip
+RA8876::getPip(RA8876PipWindow pip)
+{
+  RA8876Pip p;
+
+  memset(&p, 0, sizeof(p));
+  if (pip <= RA8876_PIP_2) p = m_pip[pip];
+
+  return p;
+}
+
+//--------------------------------------------------------------------------
+// serial flash assets
+//
+// the DMA copies a block of a picture in the flash onto the canvas at the
+// flash clock of the controller. it is an engine command like the bte
+// (queued in async mode); the destination is clipped by the driver and
+// the source start moves along with it
+
+void
+RA8876::setAssetManifest(const RA8876Asset *assets, uint16_t count)
+{
+  m_assets     = assets;
+  m_assetCount = (assets != NULL) ? count : 0;
+}
+
+RA8876Error
+RA8876::setAssetFlash(uint8_t flash, uint8_t divisor, bool addr32)
+{
+  RA8876Error err;
+
+  if (flash > 1) return RA8876_ERROR_PARAMETER;
+
+  // queued copies were set up for the flash as it was
+  err = flush();
+  if (err != RA8876_OK) return err;
+
+  m_flashCtrl    = ((flash == 1) ? RA8876_REG_SFL_CTRL_SELECT_1 : RA8876_REG_SFL_CTRL_SELECT_0) |
+                   RA8876_REG_SFL_CTRL_MODE_DMA |
+                   (addr32 ? RA8876_REG_SFL_CTRL_ADDR_32BIT : RA8876_REG_SFL_CTRL_ADDR_24BIT) |
+                   RA8876_REG_SFL_CTRL_WAVE_MODE0 | RA8876_REG_SFL_CTRL_READ_FAST;
+  m_flashDivisor = divisor;
+
+  return err;
+}
+
+const RA8876Asset *
+RA8876::findAsset(const char *name)
+{
+  if (name == NULL) return NULL;
+
+  for (uint16_t i=0; i<m_assetCount; i++)
+    if (strcmp(m_assets[i].name, name) == 0) return &m_assets[i];
+
+  return NULL;
+}
+
+RA8876Error
+RA8876::loadAsset(const char *name, uint16_t x, uint16_t y)
+{
+  return loadAsset(findAsset(name), x, y);
+}
+
+RA8876Error
+RA8876::loadAsset(const RA8876Asset *asset, uint16_t x, uint16_t y)
+{
+  if (asset == NULL) return RA8876_ERROR_PARAMETER;
+  return loadAsset(asset, 0, 0, x, y, asset->width, asset->height);
+}
+
+// w x h pixels from sx, sy of the image (an icon out of a sheet) onto the
+// canvas at x, y
+RA8876Error
+RA8876::loadAsset(const RA8876Asset *asset, uint16_t sx, uint16_t sy, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+  RA8876Command c;
+  uint16_t      cx, cy;
+
+  // the copy is byte for byte, the image must be in the canvas format
+  if ((asset == NULL) || (asset->depth != m_depth) ||
+      (((uint32_t)sx + w) > asset->width) || (((uint32_t)sy + h) > asset->height)) return RA8876_ERROR_PARAMETER;
+
+  cx = x; cy = y;
+  if (!clipRect(&x, &y, &w, &h)) return RA8876_OK;
+  sx += x - cx;
+  sy += y - cy;
+
+  c.type  = RA8876_COMMAND_DMA;
+  c.addr  = asset->offset + (((uint32_t)sy * asset->width) + sx) * m_bpp;
+  c.width = asset->width;
+  c.p[0]  = x; c.p[1] = y;
+  c.p[2]  = w; c.p[3] = h;
+  return submit(c);
+}
+
+// the image in a surface of its own (for bteBlit() or a PIP window); NULL
+// when it is not in the manifest, there is no room or the copy failed
+const RA8876Surface *
+RA8876::loadAssetSurface(const char *name)
+{
+  const RA8876Asset   *a;
+  const RA8876Surface *s;
+  RA8876Command        c;
+  RA8876Error          err;
+
+  a = findAsset(name);
+  if ((a == NULL) || (a->depth != m_depth)) return NULL;
+
+  s = allocSurface(a->width, a->height);
+  if (s == NULL) return NULL;
+
+  _spiBegin();
+
+  err = waitUntilStatusIdle();
+  if (err == RA8876_OK)
+  {
+    // point the canvas at the surface for the copy
+    regWrite32(RA8876_REG_CVSSA0,     s->addr);
+    regWrite16(RA8876_REG_CVS_IMWTH0, s->stride);
+    setActiveWindow(0, 0, s->width, s->height);
+
+    c.type  = RA8876_COMMAND_DMA;
+    c.addr  = a->offset;
+    c.width = a->width;
+    c.p[0]  = 0;        c.p[1] = 0;
+    c.p[2]  = a->width; c.p[3] = a->height;
+    execute(c);
+    err = waitUntilEngineIdle();
+    if (err == RA8876_OK) m_engineBusy = false;
+
+    // and back to the canvas
+    applyCanvas();
+  }
+
+  _spiEnd();
+
+  // the copy did not finish: the surface is handed back as it is, as
+  // freeSurface() would only wait for the engine again (the next command
+  // still does, the engine stays busy)
+  if (err != RA8876_OK)
+  {
+    ((RA8876Surface *)s)->used = false;
+    surfaceChanged();
+    s = NULL;
+  }
+
+  return s;
+}
+
+//--------------------------------------------------------------------------
+// chip mode
+
+RA8876Error
+RA8876::setTextMode()
+{
+  RA8876Error err;
+  uint8_t     reg;
+
+  // queued engine commands use the foreground colour too
+  err = flush();
+  if (err != RA8876_OK) return err;
+
+  // restore text colour
+  regWrite(RA8876_REG_FGCR, m_textColor.r);
+  regWrite(RA8876_REG_FGCG, m_textColor.g);
+  regWrite(RA8876_REG_FGCB, m_textColor.b);
+
+  // wait for previous tasks to complete
+  err = waitUntilStatusIdle();
+  if (err != RA8876_OK) return err;
+
+  // set text mode
+  reg = regRead(RA8876_REG_ICR);
+  reg = (reg & ~RA8876_REG_ICR_MODE_MASK) | RA8876_REG_ICR_MODE_TEXT;
+  regWrite(RA8876_REG_ICR, reg);
+
+  return err;
+}
+
+RA8876Error
+RA8876::setGraphicsMode()
+{
+  RA8876Error err;
+  uint8_t     reg;
+
+  // wait for previous tasks to complete
+  err = waitUntilStatusIdle();
+  if (err != RA8876_OK) return err;
+
+  // set graphics mode
+  reg = regRead(RA8876_REG_ICR);
+  reg = (reg & ~RA8876_REG_ICR_MODE_MASK) | RA8876_REG_ICR_MODE_GRAPHIC;
+  regWrite(RA8876_REG_ICR, reg);
+
+  return err;
+}
+
+//--------------------------------------------------------------------------
+// active window
+
+void
+RA8876::setActiveWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+  regWrite16(RA8876_REG_AWUL_X0, x);
+  regWrite16(RA8876_REG_AWUL_Y0, y);
+  regWrite16(RA8876_REG_AW_WTH0, w);
+  regWrite16(RA8876_REG_AW_HT0,  h);
+}
+
+RA8876Error
+RA8876::beginRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+  return beginRect(x, y, w, h, x, y);
+}
+
+RA8876Error
+RA8876::beginRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t cx, uint16_t cy)
+{
+  RA8876Error err;
+
+  // memory writes must not overtake a queued or running draw/BTE operation
+  err = flush();
+  if (err != RA8876_OK) return err;
+  err = waitUntilStatusIdle();
+  if (err != RA8876_OK) return err;
+
+  // memory writes wrap within the active window; confine it to the rect
+  setActiveWindow(x, y, w, h);
+  regWrite16(RA8876_REG_CURH0, cx);
+  regWrite16(RA8876_REG_CURV0, cy);
+
+  // open the memory port for a streamed write
+  _spiCmdWrite(RA8876_REG_MRWDP);
+  _spiStreamBegin();
+
+  return err;
+}
+
+RA8876Error
+RA8876::endRect()
+{
+  RA8876Error err;
+
+  _spiStreamEnd();
+
+  // let the FIFO drain before the window changes underneath it
+  err = waitUntilEmptyFifoWrite();
+
+  // restore the clip region as active window
+  applyClip();
+
+  return err;
+}
+
+//--------------------------------------------------------------------------
+// clipping
+
+void
+RA8876::applyClip()
+{
+  RA8876Rect c;
+
+  // an empty region draws nothing (see clipEmpty), the chip only needs
+  // a valid window
+  c = getClip();
+  setActiveWindow(c.x, c.y, (c.w != 0) ? c.w : 1, (c.h != 0) ? c.h : 1);
+}
+
+// intersects a rectangle with the clip region (the canvas without one);
+// false when nothing is left
+bool
+RA8876::clipRect(uint16_t *x, uint16_t *y, uint16_t *w, uint16_t *h)
+{
+  RA8876Rect c;
+  uint32_t   x2, y2;
+
+  // without a clip region the rectangle is kept to the canvas: memory
+  // writes past its right edge would land at the start of the next row
+  c  = getClip();
+  x2 = (uint32_t)*x + *w;
+  y2 = (uint32_t)*y + *h;
+  if (x2 > (uint32_t)c.x + c.w) x2 = (uint32_t)c.x + c.w;
+  if (y2 > (uint32_t)c.y + c.h) y2 = (uint32_t)c.y + c.h;
+  if (*x < c.x) *x = c.x;
+  if (*y < c.y) *y = c.y;
+  if ((x2 <= *x) || (y2 <= *y)) return false;
+
+  *w = x2 - *x;
+  *h = y2 - *y;
+  return true;
+}
+
+bool
+RA8876::clipEmpty()
+{
+  return (m_clipDepth != 0) && ((m_clip[m_clipDepth - 1].w == 0) || (m_clip[m_clipDepth - 1].h == 0));
+}
+
+RA8876Error
+RA8876::pushClip(RA8876Rect r)
+{
+  RA8876Error err;
+
+  if (m_clipDepth == RA8876_CLIP_DEPTH) return RA8876_ERROR_CLIP;
+
+  // nested regions can only get smaller
+  if (!clipRect(&r.x, &r.y, &r.w, &r.h)) r.w = r.h = 0;
+
+  // queued operations were clipped against the old region
+  err = flush();
+  if (err != RA8876_OK) return err;
+
+  _spiBegin();
+  err = waitUntilStatusIdle();
+  if (err == RA8876_OK)
+  {
+    m_clip[m_clipDepth++] = r;
+    applyClip();
+  }
+  _spiEnd();
+
+  return err;
+}
+
+RA8876Error
+RA8876::popClip()
+{
+  RA8876Error err;
+
+  if (m_clipDepth == 0) return RA8876_ERROR_CLIP;
+
+  err = flush();
+  if (err != RA8876_OK) return err;
+
+  _spiBegin();
+  err = waitUntilStatusIdle();
+  if (err == RA8876_OK)
+  {
+    m_clipDepth--;
+    applyClip();
+  }
+  _spiEnd();
+
+  return err;
+}
+
+RA8876Rect
+RA8876::getClip()
+{
+  RA8876Rect c;
+
+  if (m_clipDepth != 0) return m_clip[m_clipDepth - 1];
+
+  // the whole canvas
+  c.x = 0;
+  c.y = 0;
+  c.w = m_canvasWidth;
+  c.h = m_canvasHeight;
+  return c;
+}
+
+//--------------------------------------------------------------------------
+// drawing
+
+RA8876Error
+RA8876::clearScreen(Color color) 
+{ 
+  setTextCursor(0, 0); 
+
+  // the (virtual) screen, or all of a surface when that is the canvas
+  if (m_canvas != NULL) return bteSolidFill(0, 0, m_canvas->width, m_canvas->height, color);
+  return bteSolidFill(0, 0, m_virtualWidth, m_virtualHeight, color);
+};
+
+void
+RA8876::putPixel(uint16_t x, uint16_t y, Color color)
+{
+  uint8_t  buf[RA8876PixelFormat::bytes];
+  uint16_t w, h;
+  int      i;
+
+  w = 1;
+  h = 1;
+  if (!clipRect(&x, &y, &w, &h)) return;
+
+  // pixels must land after any queued engine commands
+  flush();
+
+  _spiBegin();
+
+  // set the location of the pixel
+  regWrite16(RA8876_REG_CURH0, x);
+  regWrite16(RA8876_REG_CURV0, y);
+
+  // draw the pixel
+  RA8876PixelFormat::pack(&color, buf, 1);
+  _spiCmdWrite(RA8876_REG_MRWDP);
+  for (i=0; i<RA8876PixelFormat::bytes; i++)
+    _spiDatWrite(buf[i]);
+
+  _spiEnd();
+}
+
+void
+RA8876::putPixels(uint16_t x, uint16_t y, Color *color, size_t cnt)
+{
+  uint8_t  buf[16 * RA8876PixelFormat::bytes];
+  uint16_t cx, w, h;
+
+  // the run is clipped to the part inside the clip region
+  cx = x;
+  w  = (cnt > 0xffff) ? 0xffff : cnt;
+  h  = 1;
+  if (m_clipDepth != 0)
+  {
+    if (!clipRect(&cx, &y, &w, &h)) return;
+    color += cx - x;
+    cnt    = w;
+    x      = cx;
+  }
+
+  // pixels must land after any queued engine commands
+  flush();
+
+  _spiBegin();
+
+  // set the location of the pixel
+  regWrite16(RA8876_REG_CURH0, x);
+  regWrite16(RA8876_REG_CURV0, y);
+
+  // draw the pixels, converted in chunks and streamed in one frame
+  _spiCmdWrite(RA8876_REG_MRWDP);
+  _spiStreamBegin();
+  while (cnt)
+  {
+    size_t n = (cnt > 16) ? 16 : cnt;
+    RA8876PixelFormat::pack(color, buf, n);
+    _spiStreamWrite(buf, n * RA8876PixelFormat::bytes);
+    color += n;
+    cnt   -= n;
+  }
+  _spiStreamEnd();
+
+  _spiEnd();
+}
+
+RA8876Error
+RA8876::writeRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *rgb565)
+{
+  RA8876Error err;
+  uint16_t    cx, cy, cw, ch, i, j;
+
+  if (RA8876PixelFormat::depth != 16) return RA8876_ERROR_DEPTH;
+
+  // only the part inside the clip region is sent
+  cx = x; cy = y; cw = w; ch = h;
+  if (!clipRect(&cx, &cy, &cw, &ch)) return RA8876_OK;
+  rgb565 += (uint32_t)(cy - y) * w + (cx - x);
+
+  _spiBegin();
+
+  err = beginRect(cx, cy, cw, ch);
+  if (err == RA8876_OK)
+  {
+    // pixels are sent low byte first
+    for (j=0; j<ch; j++)
+    {
+      for (i=0; i<cw; i++)
+      {
+        _spiStreamWrite( rgb565[i]       & 0xff);
+        _spiStreamWrite((rgb565[i] >> 8) & 0xff);
+      }
+      rgb565 += w;
+    }
+    err = endRect();
+  }
+
+  _spiEnd();
+
+  return err;
+}
+
+RA8876Error
+RA8876::writeRect8(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *rgb332)
+{
+  RA8876Error err;
+  uint16_t    cx, cy, cw, ch, j;
+
+  if (RA8876PixelFormat::depth != 8) return RA8876_ERROR_DEPTH;
+
+  // only the part inside the clip region is sent
+  cx = x; cy = y; cw = w; ch = h;
+  if (!clipRect(&cx, &cy, &cw, &ch)) return RA8876_OK;
+  rgb332 += ((uint32_t)(cy - y) * w + (cx - x));
+
+  _spiBegin();
+
+  err = beginRect(cx, cy, cw, ch);
+  if (err == RA8876_OK)
+  {
+    // whole rows go out in one piece
+    if (cw == w) _spiStreamWrite(rgb332, (uint32_t)w * ch);
+    else
+    {
+      for (j=0; j<ch; j++)
+      {
+        _spiStreamWrite(rgb332, (uint32_t)cw);
+        rgb332 += (uint32_t)w;
+      }
+    }
+    err = endRect();
+  }
+
+  _spiEnd();
+
+  return err;
+}
+
+RA8876Error
+RA8876::writeRect24(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *bgr888)
+{
+  RA8876Error err;
+  uint16_t    cx, cy, cw, ch, j;
+
+  if (RA8876PixelFormat::depth != 24) return RA8876_ERROR_DEPTH;
+
+  // only the part inside the clip region is sent
+  cx = x; cy = y; cw = w; ch = h;
+  if (!clipRect(&cx, &cy, &cw, &ch)) return RA8876_OK;
+  bgr888 += ((uint32_t)(cy - y) * w + (cx - x)) * 3;
+
+  _spiBegin();
+
+  err = beginRect(cx, cy, cw, ch);
+  if (err == RA8876_OK)
+  {
+    // whole rows go out in one piece
+    if (cw == w) _spiStreamWrite(bgr888, (uint32_t)w * ch * 3);
+    else
+    {
+      for (j=0; j<ch; j++)
+      {
+        _spiStreamWrite(bgr888, (uint32_t)cw * 3);
+        bgr888 += (uint32_t)w * 3;
+      }
+    }
+    err = endRect();
+  }
+
+  _spiEnd();
+
+  return err;
+}
+
+RA8876Error
+RA8876::drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color)
+{
+  return drawTwoPointShape(x1, y1, x2, y2, color, RA8876_REG_DCR0, RA8876_REG_DCR0_DRAW_LINE);
+};
+
+RA8876Error
+RA8876::drawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color)
+{ 
+  return drawTwoPointShape(x1, y1, x2, y2, color, RA8876_REG_DCR1, RA8876_REG_DCR1_DRAW_RECT);
+};
+
+RA8876Error
+RA8876::fillRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color)
+{
+  return drawTwoPointShape(x1, y1, x2, y2, color, RA8876_REG_DCR1, RA8876_REG_DCR1_DRAW_RECT_FILL);
+};
+
+RA8876Error
+RA8876::drawTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, Color color)
+{
+  return drawThreePointShape(x1, y1, x2, y2, x3, y3, color, RA8876_REG_DCR0, RA8876_REG_DCR0_DRAW_TRIANGLE);
+};
+
+RA8876Error
+RA8876::fillTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, Color color)
+{
+  return drawThreePointShape(x1, y1, x2, y2, x3, y3, color, RA8876_REG_DCR0, RA8876_REG_DCR0_DRAW_TRIANGLE_FILL);
+};
+
+RA8876Error
+RA8876::drawCircle(uint16_t x, uint16_t y, uint16_t radius, Color color)
+{
+  return drawEllipseShape(x, y, radius, radius, color, RA8876_REG_DCR1, RA8876_REG_DCR1_DRAW_CIRCLE);
+};
+
+RA8876Error
+RA8876::fillCircle(uint16_t x, uint16_t y, uint16_t radius, Color color)
+{
+  return drawEllipseShape(x, y, radius, radius, color, RA8876_REG_DCR1, RA8876_REG_DCR1_DRAW_CIRCLE_FILL);
+};
+
+RA8876Error
+RA8876::drawEllipse(uint16_t x, uint16_t y, uint16_t x_radius, uint16_t y_radius, Color color)
+{
+  return drawEllipseShape(x, y, x_radius, y_radius, color, RA8876_REG_DCR1, RA8876_REG_DCR1_DRAW_ELLIPSE);
+};
+
+RA8876Error
+RA8876::fillEllipse(uint16_t x, uint16_t y, uint16_t x_radius, uint16_t y_radius, Color color)
+{
+  return drawEllipseShape(x, y, x_radius, y_radius, color, RA8876_REG_DCR1, RA8876_REG_DCR1_DRAW_ELLIPSE_FILL);
+};
+
+//--------------------------------------------------------------------------
+// bte engine
+RA8876Error
+RA8876::bteMemoryCopy(uint16_t sx, uint16_t sy, uint16_t dx, uint16_t dy, uint16_t w, uint16_t h)
+{
+  return bteMemoryCopy(NULL, sx, sy, dx, dy, w, h);
+}
+
+// copies out of a surface (NULL = the canvas itself) onto the canvas
+RA8876Error
+RA8876::bteMemoryCopy(const RA8876Surface *src, uint16_t sx, uint16_t sy, uint16_t dx, uint16_t dy, uint16_t w, uint16_t h)
+{
+  RA8876Command c;
+  uint16_t      cx, cy;
+
+  if ((src != NULL) && !src->used) return RA8876_ERROR_PARAMETER;
+
+  // the source moves with the clipped destination
+  cx = dx; cy = dy;
+  if (!clipRect(&dx, &dy, &w, &h)) return RA8876_OK;
+  sx += dx - cx;
+  sy += dy - cy;
+
+  c.type  = RA8876_COMMAND_BTE_COPY;
+  c.addr  = (src != NULL) ? src->addr   : m_canvasAddr;
+  c.width = (src != NULL) ? src->stride : m_canvasStride;
+  c.p[0]  = sx; c.p[1] = sy;
+  c.p[2]  = dx; c.p[3] = dy;
+  c.p[4]  = w;  c.p[5] = h;
+  return submit(c);
+}
+
+// combines a surface (NULL = the canvas itself) with the canvas under the
+// destination, see RA8876BlitOp
+RA8876Error
+RA8876::bteBlit(const RA8876Surface *src, uint16_t sx, uint16_t sy, uint16_t dx, uint16_t dy, uint16_t w, uint16_t h, const RA8876BlitOp &op)
+{
+  RA8876Command c;
+  uint16_t      cx, cy;
+
+  if (((src != NULL) && !src->used) || (op.mode > RA8876_BLIT_BLEND_COLOR) || (op.rop > RA8876_ROP_WHITE))
+    return RA8876_ERROR_PARAMETER;
+
+  // the source moves with the clipped destination
+  cx = dx; cy = dy;
+  if (!clipRect(&dx, &dy, &w, &h)) return RA8876_OK;
+  sx += dx - cx;
+  sy += dy - cy;
+
+  c.addr  = (src != NULL) ? src->addr   : m_canvasAddr;
+  c.width = (src != NULL) ? src->stride : m_canvasStride;
+  c.p[0]  = sx; c.p[1] = sy;
+  c.p[2]  = dx; c.p[3] = dy;
+  c.p[4]  = w;  c.p[5] = h;
+  c.color = op.color;
+
+  switch (op.mode)
+  {
+    case RA8876_BLIT_ROP:
+         // a plain copy does not need the destination read back
+         c.type = (op.rop == RA8876_ROP_SRC) ? RA8876_COMMAND_BTE_COPY : RA8876_COMMAND_BTE_BLIT;
+         c.reg  = (op.rop << 4) | RA8876_REG_BTE_MEM_CPY_ROP;
+         break;
+
+    case RA8876_BLIT_CHROMA:
+         c.type = RA8876_COMMAND_BTE_COPY_CHROMA;
+         break;
+
+    default:
+         c.type = (op.mode == RA8876_BLIT_BLEND) ? RA8876_COMMAND_BTE_BLIT : RA8876_COMMAND_BTE_BLIT_COLOR;
+         c.reg  = RA8876_REG_BTE_MEM_CPY_OPACITY;
+         c.cmd  = ((uint16_t)op.alpha * RA8876_REG_APB_ALPHA_MAX + 127) / 255;
+         break;
+  }
+
+  return submit(c);
+}
+
+RA8876Error
+RA8876::bteSolidFill(uint16_t x, uint16_t y, uint16_t w, uint16_t h, Color color)
+{
+  RA8876Command c;
+
+  if (!clipRect(&x, &y, &w, &h)) return RA8876_OK;
+
+  c.type  = RA8876_COMMAND_BTE_SOLID_FILL;
+  c.p[0]  = x; c.p[1] = y;
+  c.p[2]  = w; c.p[3] = h;
+  c.color = color;
+  return submit(c);
+}
+
+// a pattern is size x size pixels, row by row; it is written once into its
+// slot and every btePatternFill() after that only costs the register setup
+RA8876Error
+RA8876::setPattern(uint8_t slot, RA8876PatternSize size, const Color *pixels)
+{
+  RA8876Error err;
+  uint8_t     buf[16 * RA8876PixelFormat::bytes];
+  uint32_t    addr;
+  int         y;
+
+  if ((slot >= RA8876_PATTERN_SLOTS) || (pixels == NULL) ||
+      ((size != RA8876_PATTERN_8X8) && (size != RA8876_PATTERN_16X16))) return RA8876_ERROR_PARAMETER;
+  if (m_patterns == NULL) return RA8876_ERROR_MEMORY;
+
+  // the canvas moves; nothing may still be drawing into it
+  err = flush();
+  if (err != RA8876_OK) return err;
+
+  _spiBegin();
+
+  err = waitUntilStatusIdle();
+  if (err != RA8876_OK) goto ra8876_setPattern_done;
+
+  // point the canvas at the slot as a size pixel wide image
+  addr = m_patterns->addr + (uint32_t)slot * 16 * 16 * m_bpp;
+  regWrite32(RA8876_REG_CVSSA0,     addr);
+  regWrite16(RA8876_REG_CVS_IMWTH0, size);
+
+  err = beginRect(0, 0, size, size);
+  if (err == RA8876_OK)
+  {
+    for (y=0; y<size; y++)
+    {
+      RA8876PixelFormat::pack(pixels, buf, size);
+      _spiStreamWrite(buf, size * RA8876PixelFormat::bytes);
+      pixels += size;
+    }
+    err = endRect();
+  }
+
+  // and back to the canvas
+  applyCanvas();
+
+  m_patternSize[slot] = (err == RA8876_OK) ? size : 0;
+
+ra8876_setPattern_done:;
+
+  _spiEnd();
+
+  return err;
+}
+
+RA8876Error
+RA8876::btePatternFill(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t slot)
+{
+  RA8876Command c;
+
+  if ((slot >= RA8876_PATTERN_SLOTS) || (m_patternSize[slot] == 0)) return RA8876_ERROR_PARAMETER;
+
+  // the tile repeats from the clipped corner
+  if (!clipRect(&x, &y, &w, &h)) return RA8876_OK;
+
+  c.type  = RA8876_COMMAND_BTE_PATTERN_FILL;
+  c.addr  = m_patterns->addr + (uint32_t)slot * 16 * 16 * m_bpp;
+  c.reg   = m_patternSize[slot];
+  c.p[0]  = x; c.p[1] = y;
+  c.p[2]  = w; c.p[3] = h;
+  return submit(c);
+}
+
+//--------------------------------------------------------------------------
+// colour expansion
+//
+// the bte turns every bit streamed through the memory port into a
+// foreground or background pixel (or leaves it alone in the chroma mode),
+// so a monochrome image costs one bit per pixel on the bus instead of
+// 8, 16 or 24
+
+RA8876Error
+RA8876::expandBitmap(int32_t x, int32_t y, uint16_t w, uint16_t h, const uint8_t *bits, Color fg, Color bg, bool transparent)
+{
+  RA8876Error err;
+  uint8_t     reg;
+  uint16_t    cx, cy, cw, ch, j;
+  int32_t     dx, dy;
+  size_t      stride, row;
+
+  // default return value
+  err = RA8876_OK;
+
+  if (bits == NULL) return RA8876_ERROR_PARAMETER;
+
+  // a glyph may start left of or above the canvas (a negative offset at
+  // the edge): those columns and rows are dropped before clipping
+  dx = (x < 0) ? -x : 0;
+  dy = (y < 0) ? -y : 0;
+  if ((dx >= w) || (dy >= h) || (x > 0xffff) || (y > 0xffff)) return err;
+
+  // clipped on the left, rows start part way into a byte: the start bit
+  // skips the leading pixels of the first byte of every row
+  cx = x + dx; cy = y + dy; cw = w - dx; ch = h - dy;
+  if (!clipRect(&cx, &cy, &cw, &ch)) return err;
+  dx     = cx - x;
+  dy     = cy - y;
+  stride = (w + 7) >> 3;
+  row    = ((dx & 7) + cw + 7) >> 3;
+  bits  += dy * stride + (dx >> 3);
+
+  // the memory port must not be shared with a queued or running operation
+  err = flush();
+  if (err != RA8876_OK) return err;
+
+  _spiBegin();
+
+  err = waitUntilStatusIdle();
+  if (err != RA8876_OK) goto ra8876_expandBitmap_done;
+
+  // set DEST co-ordinates
+  regWrite16(RA8876_REG_BTE_DEST_X0, cx);
+  regWrite16(RA8876_REG_BTE_DEST_Y0, cy);
+
+  // set the bitmap width and height
+  regWrite16(RA8876_REG_BTE_WTH0,    cw);
+  regWrite16(RA8876_REG_BTE_HIG0,    ch);
+
+  // 1 bits use the foreground colour, 0 bits the background colour
+  regWrite(RA8876_REG_FGCR, fg.r);
+  regWrite(RA8876_REG_FGCG, fg.g);
+  regWrite(RA8876_REG_FGCB, fg.b);
+  if (!transparent)
+  {
+    regWrite(RA8876_REG_BGCR, bg.r);
+    regWrite(RA8876_REG_BGCG, bg.g);
+    regWrite(RA8876_REG_BGCB, bg.b);
+  }
+
+  // the rop field holds the start bit: 8 bit data, msb first
+  reg  = (7 - (dx & 7)) << 4;
+  reg |= transparent ? RA8876_REG_BTE_MPU_WR_CEXP_CHROMA : RA8876_REG_BTE_MPU_WR_CEXP;
+  regWrite(RA8876_REG_BTE_CTRL1, reg);
+
+  // start the operation, it completes once the last row has been written
+  reg = regRead(RA8876_REG_BTE_CTRL0);
+  reg |= RA8876_REG_BTE_ENABLE;
+  triggerCore(RA8876_REG_BTE_CTRL0, reg);
+
+  _spiCmdWrite(RA8876_REG_MRWDP);
+  _spiStreamBegin();
+  if (row == stride) _spiStreamWrite(bits, stride * ch);
+  else
+  {
+    for (j=0; j<ch; j++)
+    {
+      _spiStreamWrite(bits, row);
+      bits += stride;
+    }
+  }
+  _spiStreamEnd();
+
+  err = waitUntilEmptyFifoWrite();
+  if (err != RA8876_OK) goto ra8876_expandBitmap_done;
+  err = waitUntilEngineIdle();
+
+ra8876_expandBitmap_done:;
+
+  _spiEnd();
+
+  return err;
+}
+
+RA8876Error
+RA8876::drawBitmap1bpp(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *bits, Color fg, Color bg)
+{
+  return expandBitmap(x, y, w, h, bits, fg, bg, false);
+}
+
+RA8876Error
+RA8876::drawBitmap1bpp(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *bits, Color fg)
+{
+  return expandBitmap(x, y, w, h, bits, fg, fg, true);
+}
+
+// glyphs are drawn transparently, erase the area first when redrawing
+RA8876Error
+RA8876::drawGlyphs(uint16_t x, uint16_t y, const RA8876BitmapFont *font, const char *str, Color color)
+{
+  RA8876Error        err;
+  const RA8876Glyph *g;
+  uint8_t            c;
+
+  // default return value
+  err = RA8876_OK;
+
+  if ((font == NULL) || (str == NULL)) return RA8876_ERROR_PARAMETER;
+
+  _spiBegin();
+
+  while ((c = (uint8_t)*str++) != 0)
+  {
+    if ((c < font->first) || (c > font->last)) continue;
+
+    g = &font->glyph[c - font->first];
+    if ((g->width != 0) && (g->height != 0))
+    {
+      // a negative offset at the left or top edge is clipped, not wrapped
+      err = expandBitmap((int32_t)x + g->xOffset, (int32_t)y + g->yOffset, g->width, g->height,
+                         &font->bitmap[g->offset], color, color, true);
+      if (err != RA8876_OK) break;
+    }
+    x += g->advance;
+  }
+
+  _spiEnd();
+
+  return err;
+}
+
+uint16_t
+RA8876::getGlyphsWidth(const RA8876BitmapFont *font, const char *str)
+{
+  uint16_t w;
+  uint8_t  c;
+
+  // default return value
+  w = 0;
+
+  if ((font == NULL) || (str == NULL)) return w;
+
+  while ((c = (uint8_t)*str++) != 0)
+  {
+    if ((c < font->first) || (c > font->last)) continue;
+    w += font->glyph[c - font->first].advance;
+  }
+
+  return w;
+}
+
+//--------------------------------------------------------------------------
+// indexed colour
+//
+// indices past the end of the palette draw with the first entry
+
+RA8876Error
+RA8876::setPalette(const Color *colors, uint16_t count)
+{
+  uint16_t i;
+
+  if ((colors == NULL) || (count > RA8876_PALETTE_SIZE)) return RA8876_ERROR_PARAMETER;
+
+  for (i=0; i<count; i++)
+    m_palette[i] = RA8876PixelFormat::nearest(colors[i]);
+  RA8876PixelFormat::pack(m_palette, m_paletteLut, count);
+  m_paletteSize = count;
+
+  return RA8876_OK;
+}
+
+Color
+RA8876::paletteColor(uint8_t index)
+{
+  return m_palette[(index < m_paletteSize) ? index : 0];
+}
+
+void
+RA8876::paletteLookup(const uint8_t *index, uint8_t *dst, size_t cnt)
+{
+  const uint8_t *p;
+  uint8_t        k;
+
+  while (cnt--)
+  {
+    p = &m_paletteLut[((*index < m_paletteSize) ? *index : 0) * RA8876PixelFormat::bytes];
+    for (k=0; k<RA8876PixelFormat::bytes; k++)
+      *dst++ = p[k];
+    index++;
+  }
+}
+
+RA8876Error
+RA8876::writeRectIndexed(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *index)
+{
+  RA8876Error err;
+  uint8_t     buf[32 * RA8876PixelFormat::bytes];
+  uint16_t    cx, cy, cw, ch, i, j, n;
+
+  if (index == NULL) return RA8876_ERROR_PARAMETER;
+
+  // only the part inside the clip region is sent
+  cx = x; cy = y; cw = w; ch = h;
+  if (!clipRect(&cx, &cy, &cw, &ch)) return RA8876_OK;
+  index += (uint32_t)(cy - y) * w + (cx - x);
+
+  _spiBegin();
+
+  err = beginRect(cx, cy, cw, ch);
+  if (err == RA8876_OK)
+  {
+    // looked up in chunks and streamed in one frame
+    for (j=0; j<ch; j++)
+    {
+      for (i=0; i<cw; i+=n)
+      {
+        n = ((cw - i) > 32) ? 32 : (cw - i);
+        paletteLookup(&index[i], buf, n);
+        _spiStreamWrite(buf, n * RA8876PixelFormat::bytes);
+      }
+      index += w;
+    }
+    err = endRect();
+  }
+
+  _spiEnd();
+
+  return err;
+}
+
+//--------------------------------------------------------------------------
+// sprites
+//
+// the visible part of the sprite is the active window while it is drawn.
+// the memory port stays open as long as the decoded pixels follow each
+// other, the window wraps them onto the next row; after a transparent or
+// clipped pixel or a bte fill only the cursor is moved to where the next
+// one belongs.
+
+// stops streaming, the active window stays
+RA8876Error
+RA8876::spriteBreak(RA8876SpriteStream *s)
+{
+  uint8_t buf[RA8876_SPRITE_CHUNK * RA8876PixelFormat::bytes];
+
+  if (!s->open) return RA8876_OK;
+
+  RA8876PixelFormat::pack(s->buf, buf, s->len);
+  _spiStreamWrite(buf, s->len * RA8876PixelFormat::bytes);
+  _spiStreamEnd();
+  s->len  = 0;
+  s->open = false;
+
+  // the cursor may not move before the FIFO has drained
+  return waitUntilEmptyFifoWrite();
+}
+
+RA8876Error
+RA8876::spriteClose(RA8876SpriteStream *s)
+{
+  RA8876Error err;
+
+  err = spriteBreak(s);
+
+  // restore the clip region as active window
+  if (s->window) applyClip();
+  s->window = false;
+
+  return err;
+}
+
+RA8876Error
+RA8876::spriteWrite(RA8876SpriteStream *s, Color color)
+{
+  RA8876Error err;
+  uint8_t     buf[RA8876_SPRITE_CHUNK * RA8876PixelFormat::bytes];
+  uint32_t    px, py;
+
+  // default return value
+  err = RA8876_OK;
+
+  px = (uint32_t)s->x + s->col;
+  py = (uint32_t)s->y + s->row;
+  if (++s->col == s->sprite->width)
+  {
+    s->col = 0;
+    s->row++;
+  }
+
+  // clipped away
+  if ((px < s->cx) || (px >= (uint32_t)s->cx + s->cw) ||
+      (py < s->cy) || (py >= (uint32_t)s->cy + s->ch)) return err;
+
+  // pixels were skipped since the last one
+  if (s->open && ((px != s->nx) || (py != s->ny)))
+  {
+    err = spriteBreak(s);
+    if (err != RA8876_OK) return err;
+  }
+
+  if (!s->open)
+  {
+    if (!s->window)
+    {
+      err = beginRect(s->cx, s->cy, s->cw, s->ch, px, py);
+      if (err != RA8876_OK) return err;
+      s->window = true;
+    }
+    else
+    {
+      // memory writes must not overtake a fill
+      if (s->filled)
+      {
+        err = flush();
+        if (err != RA8876_OK) return err;
+        err = waitUntilStatusIdle();
+        if (err != RA8876_OK) return err;
+      }
+
+      regWrite16(RA8876_REG_CURH0, px);
+      regWrite16(RA8876_REG_CURV0, py);
+      _spiCmdWrite(RA8876_REG_MRWDP);
+      _spiStreamBegin();
+    }
+    s->open   = true;
+    s->filled = false;
+  }
+
+  s->buf[s->len++] = color;
+  if (s->len == RA8876_SPRITE_CHUNK)
+  {
+    RA8876PixelFormat::pack(s->buf, buf, s->len);
+    _spiStreamWrite(buf, s->len * RA8876PixelFormat::bytes);
+    s->len = 0;
+  }
+
+  // where the chip puts the next pixel
+  s->nx = px + 1;
+  s->ny = py;
+  if (s->nx == (uint32_t)s->cx + s->cw)
+  {
+    s->nx = s->cx;
+    s->ny++;
+  }
+
+  return err;
+}
+
+// n literal indices, or a run of n times the first one
+RA8876Error
+RA8876::spritePixels(RA8876SpriteStream *s, const uint8_t *index, uint32_t n, bool run)
+{
+  RA8876Error         err;
+  const RA8876Sprite *sp;
+  const uint8_t      *rgb;
+  Color               color;
+  uint32_t            k, rows;
+
+  // default return value
+  err = RA8876_OK;
+
+  sp = s->sprite;
+  while ((n > 0) && (s->row < sp->height) && (err == RA8876_OK))
+  {
+    if (*index >= sp->colors) return RA8876_ERROR_PARAMETER;
+    rgb   = &sp->palette[*index * 3];
+    color = Color(rgb[0], rgb[1], rgb[2]);
+
+    if (!run)
+    {
+      if (*index != sp->transparent) err = spriteWrite(s, color);
+      else if (++s->col == sp->width)
+      {
+        s->col = 0;
+        s->row++;
+      }
+      index++;
+      n--;
+      continue;
+    }
+
+    // a transparent run only moves the position
+    if (*index == sp->transparent)
+    {
+      k       = s->col + n;
+      s->row += k / sp->width;
+      s->col  = k % sp->width;
+      break;
+    }
+
+    // whole rows of the run make a rectangle, otherwise the rest of the row
+    rows = 1;
+    k    = sp->width - s->col;
+    if ((s->col == 0) && (n >= sp->width))
+    {
+      rows = n / sp->width;
+      if (rows > (uint32_t)(sp->height - s->row)) rows = sp->height - s->row;
+      k    = rows * sp->width;
+    }
+    if (k > n) k = n;
+
+    // long runs are cheaper as a fill than as pixel data
+    if (k * RA8876PixelFormat::bytes >= RA8876_SPRITE_FILL)
+    {
+      err = spriteBreak(s);
+      if (err != RA8876_OK) break;
+      s->filled = true;
+      err = bteSolidFill(s->x + s->col, s->y + s->row, (rows == 1) ? k : sp->width, rows, color);
+      s->row += (s->col + k) / sp->width;
+      s->col  = (s->col + k) % sp->width;
+      n      -= k;
+      continue;
+    }
+
+    n -= k;
+    while ((k-- > 0) && (err == RA8876_OK))
+      err = spriteWrite(s, color);
+  }
+
+  return err;
+}
+
+// the sprite is decoded as it is sent, no image buffer is needed
+RA8876Error
+RA8876::drawSprite(uint16_t x, uint16_t y, const RA8876Sprite *sprite)
+{
+  RA8876Error        err, close;
+  RA8876SpriteStream s;
+  const uint8_t     *p, *end;
+  uint32_t           n;
+  uint8_t            op;
+
+  // default return value
+  err = RA8876_OK;
+
+  if ((sprite == NULL) || (sprite->palette == NULL) || (sprite->data == NULL) ||
+      (sprite->colors == 0)) return RA8876_ERROR_PARAMETER;
+
+  // only the part inside the clip region is drawn
+  s.cx = x; s.cy = y; s.cw = sprite->width; s.ch = sprite->height;
+  if (!clipRect(&s.cx, &s.cy, &s.cw, &s.ch)) return err;
+
+  s.sprite = sprite;
+  s.x      = x;
+  s.y      = y;
+  s.col    = 0;
+  s.row    = 0;
+  s.window = false;
+  s.open   = false;
+  s.filled = false;
+  s.len    = 0;
+
+  _spiBegin();
+
+  p   = sprite->data;
+  end = p + sprite->size;
+  while ((p < end) && (s.row < sprite->height))
+  {
+    op = *p++;
+    if (op < 0x80)
+    {
+      // literal pixels
+      n = op + 1;
+      if ((uint32_t)(end - p) < n) goto ra8876_drawSprite_corrupt;
+      err = spritePixels(&s, p, n, false);
+      p  += n;
+    }
+    else
+    {
+      // a run, short or with a 16 bit count
+      n = (op & 0x7f) + 2;
+      if (op == 0xff)
+      {
+        if ((end - p) < 2) goto ra8876_drawSprite_corrupt;
+        n  = p[0] | ((uint16_t)p[1] << 8);
+        p += 2;
+      }
+      if (p == end) goto ra8876_drawSprite_corrupt;
+      err = spritePixels(&s, p, n, true);
+      p++;
+    }
+    if (err != RA8876_OK) goto ra8876_drawSprite_done;
+  }
+
+  // the stream ran out before the last row
+  if (s.row < sprite->height) goto ra8876_drawSprite_corrupt;
+  goto ra8876_drawSprite_done;
+
+ra8876_drawSprite_corrupt:;
+
+  err = RA8876_ERROR_PARAMETER;
+
+ra8876_drawSprite_done:;
+
+  // the last pixels are still buffered
+  close = spriteClose(&s);
+  if (err == RA8876_OK) err = close;
+
+  _spiEnd();
+
+  return err;
+}
+
+//--------------------------------------------------------------------------
+// font utils
+//
+// the internal character ROM covers ISO 8859-1, 2, 4 and 5. text that goes
+// through write() (print, println) is UTF-8: every code point is looked up
+// in the upper half of the selected encoding and replaced when the font
+// does not have it. putChar(s) take font bytes as they are.
+
+// ISO 8859-2 (Latin 2), bytes 0xA0 .. 0xFF
+static const uint16_t ra8876Iso8859_2[96] =
+{
+  0x00A0, 0x0104, 0x02D8, 0x0141, 0x00A4, 0x013D, 0x015A, 0x00A7,
+  0x00A8, 0x0160, 0x015E, 0x0164, 0x0179, 0x00AD, 0x017D, 0x017B,
+  0x00B0, 0x0105, 0x02DB, 0x0142, 0x00B4, 0x013E, 0x015B, 0x02C7,
+  0x00B8, 0x0161, 0x015F, 0x0165, 0x017A, 0x02DD, 0x017E, 0x017C,
+  0x0154, 0x00C1, 0x00C2, 0x0102, 0x00C4, 0x0139, 0x0106, 0x00C7,
+  0x010C, 0x00C9, 0x0118, 0x00CB, 0x011A, 0x00CD, 0x00CE, 0x010E,
+  0x0110, 0x0143, 0x0147, 0x00D3, 0x00D4, 0x0150, 0x00D6, 0x00D7,
+  0x0158, 0x016E, 0x00DA, 0x0170, 0x00DC, 0x00DD, 0x0162, 0x00DF,
+  0x0155, 0x00E1, 0x00E2, 0x0103, 0x00E4, 0x013A, 0x0107, 0x00E7,
+  0x010D, 0x00E9, 0x0119, 0x00EB, 0x011B, 0x00ED, 0x00EE, 0x010F,
+  0x0111, 0x0144, 0x0148, 0x00F3, 0x00F4, 0x0151, 0x00F6, 0x00F7,
+  0x0159, 0x016F, 0x00FA, 0x0171, 0x00FC, 0x00FD, 0x0163, 0x02D9
+};
+
+// ISO 8859-4 (Latin 4), bytes 0xA0 .. 0xFF
+static const uint16_t ra8876Iso8859_4[96] =
+{
+  0x00A0, 0x0104, 0x0138, 0x0156, 0x00A4, 0x0128, 0x013B, 0x00A7,
+  0x00A8, 0x0160, 0x0112, 0x0122, 0x0166, 0x00AD, 0x017D, 0x00AF,
+  0x00B0, 0x0105, 0x02DB, 0x0157, 0x00B4, 0x0129, 0x013C, 0x02C7,
+  0x00B8, 0x0161, 0x0113, 0x0123, 0x0167, 0x014A, 0x017E, 0x014B,
+  0x0100, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x012E,
+  0x010C, 0x00C9, 0x0118, 0x00CB, 0x0116, 0x00CD, 0x00CE, 0x012A,
+  0x0110, 0x0145, 0x014C, 0x0136, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+  0x00D8, 0x0172, 0x00DA, 0x00DB, 0x00DC, 0x0168, 0x016A, 0x00DF,
+  0x0101, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x012F,
+  0x010D, 0x00E9, 0x0119, 0x00EB, 0x0117, 0x00ED, 0x00EE, 0x012B,
+  0x0111, 0x0146, 0x014D, 0x0137, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+  0x00F8, 0x0173, 0x00FA, 0x00FB, 0x00FC, 0x0169, 0x016B, 0x02D9
+};
+
+// ISO 8859-5 (Cyrillic), bytes 0xA0 .. 0xFF
+static const uint16_t ra8876Iso8859_5[96] =
+{
+  0x00A0, 0x0401, 0x0402, 0x0403, 0x0404, 0x0405, 0x0406, 0x0407,
+  0x0408, 0x0409, 0x040A, 0x040B, 0x040C, 0x00AD, 0x040E, 0x040F,
+  0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+  0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+  0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427,
+  0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+  0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+  0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+  0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+  0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+  0x2116, 0x0451, 0x0452, 0x0453, 0x0454, 0x0455, 0x0456, 0x0457,
+  0x0458, 0x0459, 0x045A, 0x045B, 0x045C, 0x00A7, 0x045E, 0x045F
+};
+
+
+uint8_t
+RA8876::getFontEncoding(RA8876FontEncoding enc)
+{
+  uint8_t e;
+  switch (enc)
+  {
+    case RA8876_FONT_ENCODING_8859_2: e = 0x01; break;
+    case RA8876_FONT_ENCODING_8859_4: e = 0x02; break;
+    case RA8876_FONT_ENCODING_8859_5: e = 0x03; break;
+    default:                          e = 0x00; break; // ISO-8859-1
+  }
+
+  return e;
+}
+
+void 
+RA8876::setFont(RA8876FontSize sz, RA8876FontEncoding enc)
+{
+  m_fontSize   = sz;
+  m_fontFlags  = 0;
+
+  // Latin 1 is the identity, the other encodings are looked up
+  switch (getFontEncoding(enc))
+  {
+    case 0x01: m_fontTable = ra8876Iso8859_2; break;
+    case 0x02: m_fontTable = ra8876Iso8859_4; break;
+    case 0x03: m_fontTable = ra8876Iso8859_5; break;
+    default:   m_fontTable = NULL;            break;
+  }
+
+  _spiBegin();
+
+  regWrite(RA8876_REG_CCR0, 0x00 | ((sz & 0x03) << 4) | getFontEncoding(enc));
+
+  uint8_t ccr1 = regRead(RA8876_REG_CCR1);
+  ccr1 |= 0x40;  // transparent background
+  regWrite(RA8876_REG_CCR1, ccr1);
+
+  _spiEnd();
+}
+
+void
+RA8876::setReplacementChar(char c)
+{
+  m_replacement = c;
+}
+
+// feed one byte of UTF-8; returns the font byte once a character is
+// complete, -1 while a sequence is still open. a sequence cut short by a
+// byte that does not continue it is ended by the caller
+int
+RA8876::utf8Decode(uint8_t b, uint32_t *cp, uint8_t *need)
+{
+  int i;
+
+  if (b < 0x80)
+  {
+    *need = 0;
+    return b;
+  }
+
+  if ((b & 0xC0) == 0x80)
+  {
+    // continuation without a lead byte
+    if (*need == 0) return (uint8_t)m_replacement;
+
+    *cp = (*cp << 6) | (b & 0x3F);
+    if (--(*need) != 0) return -1;
+
+    // complete: the upper half of the encoding
+    if ((m_fontTable == NULL) && (*cp >= 0xA0) && (*cp <= 0xFF)) return *cp;
+    if  (m_fontTable != NULL)
+    {
+      for (i=0; i<96; i++)
+        if (m_fontTable[i] == *cp) return 0xA0 + i;
+    }
+    return (uint8_t)m_replacement;
+  }
+
+  // lead byte
+  if      ((b & 0xE0) == 0xC0) { *cp = b & 0x1F; *need = 1; }
+  else if ((b & 0xF0) == 0xE0) { *cp = b & 0x0F; *need = 2; }
+  else if ((b & 0xF8) == 0xF0) { *cp = b & 0x07; *need = 3; }
+  else
+  {
+    *need = 0;
+    return (uint8_t)m_replacement;
+  }
+
+  return -1;
+}
+
+// converts a whole string; dst is always terminated
+size_t
+RA8876::transcodeUtf8(const char *src, char *dst, size_t sz)
+{
+  uint32_t cp;
+  uint8_t  need;
+  size_t   n;
+  int      c;
+
+  // default return value
+  n = 0;
+
+  if ((dst == NULL) || (sz == 0)) return n;
+
+  cp   = 0;
+  need = 0;
+  while ((src != NULL) && (*src != 0) && ((n + 1) < sz))
+  {
+    // a byte that does not continue an open sequence ends it with the
+    // replacement character and is then decoded on its own
+    if ((need != 0) && (((uint8_t)*src & 0xC0) != 0x80))
+    {
+      need     = 0;
+      dst[n++] = m_replacement;
+      continue;
+    }
+
+    c = utf8Decode((uint8_t)*src++, &cp, &need);
+    if (c >= 0) dst[n++] = (char)c;
+  }
+
+  // a sequence cut short by the end of the string
+  if ((need != 0) && ((n + 1) < sz)) dst[n++] = m_replacement;
+  dst[n] = 0;
+
+  return n;
+}
+
+// the text cursor is kept in software: every character written advances
+// it the way the chip does (wrapping at the right edge of the active
+// window), so reading it back never needs a bus turnaround
+
+void 
+RA8876::setTextCursor(uint16_t x, uint16_t y)
+{
+  m_textCursorX = x;
+  m_textCursorY = y;
+
+  _spiBegin();
+
+  regWrite16(RA8876_REG_F_CURX0, x);
+  regWrite16(RA8876_REG_F_CURY0, y);
+
+  _spiEnd();
+}
+
+uint16_t 
+RA8876::getTextCursorX()
+{
+  return m_textCursorX;
+}
+
+uint16_t 
+RA8876::getTextCursorY()
+{
+  return m_textCursorY;
+}
+
+void
+RA8876::textAdvance(uint16_t w)
+{
+  uint16_t awx, aww;
+
+  // the active window is driver owned, these come from the shadow cache
+  awx = regRead(RA8876_REG_AWUL_X0) | ((uint16_t)regRead(RA8876_REG_AWUL_X1) << 8);
+  aww = regRead(RA8876_REG_AW_WTH0) | ((uint16_t)regRead(RA8876_REG_AW_WTH1) << 8);
+
+  // a character that does not fit starts the next line
+  if (((uint32_t)m_textCursorX + w) > ((uint32_t)awx + aww))
+  {
+    m_textCursorX  = awx;
+    m_textCursorY += getTextHeight();
+  }
+  m_textCursorX += w;
+}
+
+uint16_t 
+RA8876::getTextHeight()
+{
+  return ((m_fontSize + 2) * 8) * m_textScaleY;
+}
+
+uint16_t 
+RA8876::getTextWidth()
+{
+  return ((m_fontSize + 2) * 4) * m_textScaleX;
+}
+
+// width of a single line of 8 bit characters
+uint16_t
+RA8876::getTextWidth(const char *str)
+{
+  return (str != NULL) ? (strlen(str) * getTextWidth()) : 0;
+}
+
+void
+RA8876::setTextColor(Color color) 
+{ 
+  m_textColor = color;
+}
+
+void
+RA8876::setTextScale(int scale) 
+{
+  setTextScale(scale, scale);
+}
+
+void
+RA8876::setTextScale(int xScale, int yScale)
+{
+  uint8_t reg;
+
+  xScale = constrain(xScale, 1, 4); // keep within values 1, 2, 3 and 4
+  yScale = constrain(yScale, 1, 4); // keep within values 1, 2, 3 and 4
+
+  m_textScaleX = xScale;
+  m_textScaleY = yScale;
+
+  _spiBegin();
+
+  reg = regRead(RA8876_REG_CCR1);
+  reg = (reg & ~RA8876_REG_CCR1_XSCALE_MASK) | RA8876_REG_CCR1_XSCALE(xScale - 1);
+  reg = (reg & ~RA8876_REG_CCR1_YSCALE_MASK) | RA8876_REG_CCR1_YSCALE(yScale - 1);
+  regWrite(RA8876_REG_CCR1, reg);
+
+  _spiEnd();
+}
+
+RA8876Error
+RA8876::putChar(char c) 
+{
+  return putChars(&c, 1);
+}
+
+RA8876Error
+RA8876::putChars(const char *buf, size_t sz)
+{
+  RA8876Error err;
+  bool        run;
+
+  // a text run of its own, unless one is already open
+  run = m_textRun;
+  if (!run)
+  {
+    err = beginText();
+    if (err != RA8876_OK) return err;
+  }
+
+  err = textWrite(buf, sz);
+
+  if (!run)
+  {
+    if (err == RA8876_OK) err = endText();
+    else                  endText();
+  }
+
+  return err;
+}
+
+RA8876Error
+RA8876::putChar16(uint16_t c)
+{
+  return putChars16(&c, 1);
+}
+
+RA8876Error
+RA8876::putChars16(const uint16_t *buf, size_t sz)
+{
+  RA8876Error err;
+  bool        run;
+
+  // a text run of its own, unless one is already open
+  run = m_textRun;
+  if (!run)
+  {
+    err = beginText();
+    if (err != RA8876_OK) return err;
+  }
+
+  err = textWrite16(buf, sz);
+
+  if (!run)
+  {
+    if (err == RA8876_OK) err = endText();
+    else                  endText();
+  }
+
+  return err;
+}
+
+size_t
+RA8876::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t 
+RA8876::write(const uint8_t *buf, size_t sz)
+{
+  RA8876Error err;
+  size_t      i;
+  bool        run;
+
+  // this is a text mode operation
+  run = m_textRun;
+  if (!run)
+  {
+    err = beginText();
+    if (err != RA8876_OK)
+    {
+      setWriteError(err);
+      return 0;
+    }
+  }
+
+  i = 0;
+  while (i < sz)
+  {
+    int c;
+
+    // a byte that does not continue an open sequence ends it with the
+    // replacement character and is then decoded on its own
+    if ((m_utf8Need != 0) && ((buf[i] & 0xC0) != 0x80))
+    {
+      m_utf8Need = 0;
+      c          = (uint8_t)m_replacement;
+    }
+    else
+      c = utf8Decode(buf[i++], &m_utf8Char, &m_utf8Need);
+
+    if (c < 0)     err = RA8876_OK; // sequence continues
+    else
+    if (c == '\r') err = RA8876_OK; // ignored
+    else
+    if (c == '\n')
+    {
+      // the line height is known, no need to ask the chip where we are;
+      // the next line starts at the left edge of the clip region (the
+      // active window), like a line the chip wraps itself
+      setTextCursor(getClip().x, m_textCursorY + getTextHeight());
+      err = RA8876_OK;
+    }
+    else
+    if ((m_fontFlags & RA8876_FONT_FLAG_XLAT_FULLWIDTH) && (c >= 0x21) && (c <= 0x7E))
+    {
+      // translate ASCII to Unicode fullwidth form (for Chinese fonts that lack ASCII)
+      uint16_t fwc = c - 0x21 + 0xFF01;
+      err = textWrite16(&fwc, 1);
+    }
+    else
+    {
+      char ch = (char)c;
+      err = textWrite(&ch, 1);
+    }
+
+    if (err != RA8876_OK) break;
+  }
+
+  // revert back to graphics mode
+  if (!run)
+  {
+    if (err == RA8876_OK) err = endText();
+    else                  endText();
+  }
+
+  // report the failure through the Print write error
+  if (err != RA8876_OK) setWriteError(err);
+
+  return i;
+}
+
+//--------------------------------------------------------------------------
+// text runs
+//
+// beginText() switches to text mode once and keeps the SPI transaction
+// open; drawTextAt() then only writes the cursor, the colour (when it
+// changed) and the characters, waiting for room in the write FIFO rather
+// than for it to drain. endText() lets the FIFO drain and switches back
+// to graphics mode. the canvas belongs to the text run in between: no
+// other drawing may be started until endText().
+
+RA8876Error
+RA8876::beginText()
+{
+  RA8876Error err;
+
+  // default return value
+  err = RA8876_OK;
+
+  if (m_textRun) return err;
+
+  _spiBegin();
+
+  err = setTextMode();
+  if (err != RA8876_OK)
+  {
+    _spiEnd();
+    return err;
+  }
+
+  m_textRun = true;
+
+  return err;
+}
+
+RA8876Error
+RA8876::drawTextAt(uint16_t x, uint16_t y, Color color, const char *str)
+{
+  RA8876Error err;
+  bool        run;
+
+  if (str == NULL) return RA8876_ERROR_PARAMETER;
+
+  run = m_textRun;
+  if (!run)
+  {
+    err = beginText();
+    if (err != RA8876_OK) return err;
+  }
+
+  setTextCursor(x, y);
+
+  // the shadow cache skips the colour when it is unchanged
+  regWrite(RA8876_REG_FGCR, color.r);
+  regWrite(RA8876_REG_FGCG, color.g);
+  regWrite(RA8876_REG_FGCB, color.b);
+
+  err = textWrite(str, strlen(str));
+
+  if (!run)
+  {
+    if (err == RA8876_OK) err = endText();
+    else                  endText();
+  }
+
+  return err;
+}
+
+RA8876Error
+RA8876::endText()
+{
+  RA8876Error err;
+
+  // default return value
+  err = RA8876_OK;
+
+  if (!m_textRun) return err;
+  m_textRun = false;
+
+  // let the last characters render before leaving text mode
+  err = waitUntilEmptyFifoWrite();
+  if (err == RA8876_OK) err = setGraphicsMode();
+  else                  setGraphicsMode();
+
+  _spiEnd();
+
+  return err;
+}
+
+RA8876Error
+RA8876::textWrite(const char *buf, size_t sz)
+{
+  RA8876Error err;
+
+  // default return value
+  err = RA8876_OK;
+
+  // the chip has no empty active window
+  if (clipEmpty()) return err;
+
+  for (size_t i = 0; i < sz; i++)
+  {
+    err = waitUntilNotFullFifoWrite();
+    if (err != RA8876_OK) break;
+
+    // the memory port usually is still selected from the last character
+    if (m_spiCmd != RA8876_REG_MRWDP) _spiCmdWrite(RA8876_REG_MRWDP);
+    _spiDatWrite(buf[i]);
+    textAdvance(getTextWidth());
+  }
+
+  return err;
+}
+
+// 16 bit character codes, high byte first; codes from 0x80 up are drawn
+// full width
+RA8876Error
+RA8876::textWrite16(const uint16_t *buf, size_t sz)
+{
+  RA8876Error err;
+
+  // default return value
+  err = RA8876_OK;
+
+  // the chip has no empty active window
+  if (clipEmpty()) return err;
+
+  for (size_t i = 0; i < sz; i++)
+  {
+    err = waitUntilNotFullFifoWrite();
+    if (err != RA8876_OK) break;
+    if (m_spiCmd != RA8876_REG_MRWDP) _spiCmdWrite(RA8876_REG_MRWDP);
+    _spiDatWrite((buf[i] >> 8) & 0xff);
+    err = waitUntilNotFullFifoWrite();
+    if (err != RA8876_OK) break;
+    _spiDatWrite( buf[i]       & 0xff);
+    textAdvance((buf[i] < 0x80) ? getTextWidth() : (getTextWidth() * 2));
+  }
+
+  return err;
+}
+
+// lines break at '\n' and between words where the next one would not fit
+// the box; every line is aligned within the box on its own
+RA8876Error
+RA8876::drawTextBox(uint16_t x, uint16_t y, uint16_t w, Color color, const char *str, RA8876TextAlign align)
+{
+  RA8876Error err;
+  uint16_t    cw, lw, lx;
+  size_t      max, n, len;
+  long        brk;
+  bool        run;
+
+  // default return value
+  err = RA8876_OK;
+
+  if (str == NULL) return RA8876_ERROR_PARAMETER;
+
+  // characters per line, at least one so every line makes progress
+  cw  = getTextWidth();
+  max = w / cw;
+  if (max == 0) max = 1;
+
+  run = m_textRun;
+  if (!run)
+  {
+    err = beginText();
+    if (err != RA8876_OK) return err;
+  }
+
+  regWrite(RA8876_REG_FGCR, color.r);
+  regWrite(RA8876_REG_FGCG, color.g);
+  regWrite(RA8876_REG_FGCB, color.b);
+
+  while ((*str != 0) && (err == RA8876_OK))
+  {
+    // as many characters as fit, then back to the last space
+    brk = -1;
+    for (n = 0; (str[n] != 0) && (str[n] != '\n') && (n < max); n++)
+      if (str[n] == ' ') brk = n;
+    len = n;
+    if ((n == max) && (str[n] != 0) && (str[n] != '\n') && (str[n] != ' ') && (brk > 0)) len = brk;
+
+    // trailing spaces do not count for the alignment
+    n = len;
+    while ((n > 0) && (str[n - 1] == ' ')) n--;
+    lw = n * cw;
+
+    lx = x;
+    if (lw < w)
+    {
+      if (align == RA8876_TEXT_ALIGN_RIGHT)  lx += w - lw;
+      if (align == RA8876_TEXT_ALIGN_CENTER) lx += (w - lw) / 2;
+    }
+
+    setTextCursor(lx, y);
+    err = textWrite(str, n);
+    y  += getTextHeight();
+
+    // skip the break
+    str += len;
+    while (*str == ' ') str++;
+    if (*str == '\n') str++;
+  }
+
+  if (!run)
+  {
+    if (err == RA8876_OK) err = endText();
+    else                  endText();
+  }
+
+  return err;
+}
+
+//--------------------------------------------------------------------------
+// text cache
+//
+// a slot is a RA8876_TEXT_CACHE_WIDTH x RA8876_TEXT_CACHE_HEIGHT strip of
+// the cache image. the string is drawn on a background of the inverse of
+// the text colour, which is then the chroma key of the copy; text drawn
+// from the cache is transparent, just like putChars()
+
+uint32_t
+RA8876::cacheHash(const char *str, size_t len)
+{
+  uint32_t h;
+
+  // FNV-1a over the string and everything that changes its pixels
+  h = 2166136261UL;
+  while (len--) h = (h ^ (uint8_t)*str++) * 16777619UL;
+  h = (h ^ regRead(RA8876_REG_CCR0))  * 16777619UL;  // size and encoding
+  h = (h ^ m_textScaleX)               * 16777619UL;
+  h = (h ^ m_textScaleY)               * 16777619UL;
+  h = (h ^ m_textColor.r)              * 16777619UL;
+  h = (h ^ m_textColor.g)              * 16777619UL;
+  h = (h ^ m_textColor.b)              * 16777619UL;
+
+  // 0 marks an empty slot
+  return (h != 0) ? h : 1;
+}
+
+RA8876Error
+RA8876::cacheRender(int slot, const char *str, size_t len)
+{
+  RA8876Error err;
+  Color       key;
+  uint16_t    y, cx, cy;
+
+  // the canvas moves; nothing may still be drawing into it
+  err = flush();
+  if (err != RA8876_OK) return err;
+
+  _spiBegin();
+
+  err = waitUntilStatusIdle();
+  if (err != RA8876_OK) goto ra8876_cacheRender_done;
+
+  // point the canvas at the cache image, confined to the slot
+  cx = m_textCursorX;
+  cy = m_textCursorY;
+  y  = slot * RA8876_TEXT_CACHE_HEIGHT;
+  regWrite32(RA8876_REG_CVSSA0,     m_textCache->addr);
+  regWrite16(RA8876_REG_CVS_IMWTH0, m_textCache->stride);
+  setActiveWindow(0, y, RA8876_TEXT_CACHE_WIDTH, RA8876_TEXT_CACHE_HEIGHT);
+
+  // key colour background (as large as the string), then the text on top
+  key = Color((uint8_t)~m_textColor.r, (uint8_t)~m_textColor.g, (uint8_t)~m_textColor.b);
+  err = fillRectangle(0, y, (len * ((m_fontSize + 2) * 4) * m_textScaleX) - 1, y + getTextHeight() - 1, key);
+  if (err == RA8876_OK)
+  {
+    setTextCursor(0, y);
+    err = putChars(str, len);
+  }
+  if (err == RA8876_OK)
+  {
+    m_cache[slot].width  = getTextCursorX();
+    m_cache[slot].height = getTextHeight();
+  }
+
+  // and back to the canvas and text cursor
+  applyCanvas();
+  setTextCursor(cx, cy);
+
+ra8876_cacheRender_done:;
+
+  _spiEnd();
+
+  return err;
+}
+
+// draws with the current font, scale and text colour; the text cursor is
+// only moved when the string has to be drawn directly
+RA8876Error
+RA8876::drawCachedText(uint16_t x, uint16_t y, const char *str)
+{
+  RA8876Error          err;
+  RA8876Command        c;
+  RA8876TextCacheSlot *s;
+  size_t               len;
+  uint32_t             hash;
+  uint16_t             cx, cy, cw, ch;
+  int                  i, slot;
+
+  // default return value
+  err = RA8876_OK;
+
+  if (str == NULL) return RA8876_ERROR_PARAMETER;
+  len = strlen(str);
+  if ((len == 0) || clipEmpty()) return err;
+
+  // too large for a slot (or no cache): draw it directly
+  if ((m_textCache == NULL) || (len >= RA8876_TEXT_CACHE_TEXT) ||
+      ((len * ((m_fontSize + 2) * 4) * m_textScaleX) > RA8876_TEXT_CACHE_WIDTH) ||
+      (getTextHeight() > RA8876_TEXT_CACHE_HEIGHT))
+  {
+    m_cacheStats.bypassed++;
+    setTextCursor(x, y);
+    return putChars(str, len);
+  }
+
+  // look it up, remembering the least recently used slot on the way
+  hash = cacheHash(str, len);
+  slot = 0;
+  for (i=0; i<RA8876_TEXT_CACHE_SLOTS; i++)
+  {
+    s = &m_cache[i];
+    if ((s->hash == hash) && (strcmp(s->text, str) == 0)) break;
+    if (s->used < m_cache[slot].used) slot = i;
+  }
+
+  if (i < RA8876_TEXT_CACHE_SLOTS)
+  {
+    slot = i;
+    m_cacheStats.hits++;
+  }
+  else
+  {
+    s = &m_cache[slot];
+    if (s->hash != 0) m_cacheStats.evictions++;
+    m_cacheStats.misses++;
+
+    s->hash = 0;
+    s->used = 0;
+    err = cacheRender(slot, str, len);
+    if (err != RA8876_OK) return err;
+
+    s->hash = hash;
+    memcpy(s->text, str, len + 1);
+  }
+
+  s = &m_cache[slot];
+  s->used = ++m_cacheTick;
+
+  // a single colour keyed copy onto the canvas
+  c.type  = RA8876_COMMAND_BTE_COPY_CHROMA;
+  c.addr  = m_textCache->addr;
+  c.width = m_textCache->stride;
+  cx = x; cy = y; cw = s->width; ch = s->height;
+  if (!clipRect(&cx, &cy, &cw, &ch)) return err;
+
+  c.p[0]  = cx - x; c.p[1] = slot * RA8876_TEXT_CACHE_HEIGHT + (cy - y);
+  c.p[2]  = cx;     c.p[3] = cy;
+  c.p[4]  = cw;
+  c.p[5]  = ch;
+  c.color = Color((uint8_t)~m_textColor.r, (uint8_t)~m_textColor.g, (uint8_t)~m_textColor.b);
+  return submit(c);
+}
+
+void
+RA8876::invalidateTextCache()
+{
+  memset(m_cache, 0, sizeof(m_cache));
+  m_cacheTick = 0;
+}
+
+RA8876TextCacheStats
+RA8876::getTextCacheStats()
+{
+  return m_cacheStats;
+}
+
+void
+RA8876::resetTextCacheStats()
+{
+  memset(&m_cacheStats, 0, sizeof(m_cacheStats));
+}
+
+//--------------------------------------------------------------------------
+// low-level drawing operations
+
+RA8876Error
+RA8876::drawTwoPointShape(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color, uint8_t reg, uint8_t cmd)
+{
+  RA8876Command c;
+
+  c.type  = RA8876_COMMAND_TWO_POINT;
+  c.reg   = reg;
+  c.cmd   = cmd;
+  c.p[0]  = x1; c.p[1] = y1;
+  c.p[2]  = x2; c.p[3] = y2;
+  c.color = color;
+  return submit(c);
+}
+
+RA8876Error
+RA8876::drawThreePointShape(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, Color color, uint8_t reg, uint8_t cmd)
+{
+  RA8876Command c;
+
+  c.type  = RA8876_COMMAND_THREE_POINT;
+  c.reg   = reg;
+  c.cmd   = cmd;
+  c.p[0]  = x1; c.p[1] = y1;
+  c.p[2]  = x2; c.p[3] = y2;
+  c.p[4]  = x3; c.p[5] = y3;
+  c.color = color;
+  return submit(c);
+}
+
+RA8876Error
+RA8876::drawEllipseShape(uint16_t x, uint16_t y, uint16_t xrad, uint16_t yrad, Color color, uint8_t reg, uint8_t cmd)
+{
+  RA8876Command c;
+
+  c.type  = RA8876_COMMAND_ELLIPSE;
+  c.reg   = reg;
+  c.cmd   = cmd;
+  c.p[0]  = x;    c.p[1] = y;
+  c.p[2]  = xrad; c.p[3] = yrad;
+  c.color = color;
+  return submit(c);
+}
+
+//--------------------------------------------------------------------------
+// command queue
+//
+// in synchronous mode (the default) every engine command is issued and
+// waited on before returning. in asynchronous mode commands go into a
+// ring of RA8876_QUEUE_SIZE entries; the engine status is only checked
+// when a command is ready to be issued (submit, poll) or on flush(), so
+// the caller can do other work while a large fill or copy is running.
+// any operation that touches the canvas outside the queue drains it first.
+
+RA8876Error
+RA8876::setAsync(bool enabled)
+{
+  RA8876Error err;
+
+  // leaving async mode: nothing may be left behind in the queue
+  err = flush();
+  m_async = enabled;
+
+  return err;
+}
+
+uint8_t
+RA8876::getPendingCount()
+{
+  return m_queueCount;
+}
+
+RA8876Error
+RA8876::submit(const RA8876Command &c)
+{
+  RA8876Error err;
+
+  // geometry is clipped by the active window, except when there is none
+  if ((c.type <= RA8876_COMMAND_ELLIPSE) && clipEmpty()) return RA8876_OK;
+
+  if (!m_async)
+  {
+    _spiBegin();
+    execute(c);
+    err = waitUntilEngineIdle();
+    if (err == RA8876_OK) m_engineBusy = false;
+    _spiEnd();
+
+    return err;
+  }
+
+  // queue full: block until the head command can be issued and issue it,
+  // the new command takes its place
+  if (m_queueCount == RA8876_QUEUE_SIZE)
+  {
+    _spiBegin();
+    err = waitUntilEngineIdle();
+    if (err == RA8876_OK)
+    {
+      m_engineBusy = false;
+      execute(m_queue[m_queueHead]);
+      m_queueHead = (m_queueHead + 1) % RA8876_QUEUE_SIZE;
+      m_queueCount--;
+    }
+    _spiEnd();
+
+    if (err != RA8876_OK) return err;
+  }
+
+  m_queue[(m_queueHead + m_queueCount) % RA8876_QUEUE_SIZE] = c;
+  m_queueCount++;
+
+  // hand it to the engine straight away if it happens to be idle
+  return poll();
+}
+
+RA8876Error
+RA8876::poll()
+{
+  _spiBegin();
+
+  while (m_queueCount > 0)
+  {
+    // one status read (or the ISR flag); leave the rest queued while the
+    // engine is working
+    if (m_engineBusy)
+    {
+      if (m_intPin >= 0)
+      {
+        if (!m_intPending) break;
+      }
+      else
+      if ((_spiSTSRead() & RA8876_STATUS_TASK_MASK) == RA8876_STATUS_TASK_BUSY) break;
+      m_engineBusy = false;
+    }
+
+    execute(m_queue[m_queueHead]);
+    m_queueHead = (m_queueHead + 1) % RA8876_QUEUE_SIZE;
+    m_queueCount--;
+  }
+
+  _spiEnd();
+
+  return RA8876_OK;
+}
+
+RA8876Error
+RA8876::flush()
+{
+  RA8876Error err;
+
+  err = RA8876_OK;
+  _spiBegin();
+
+  while (m_engineBusy)
+  {
+    err = waitUntilEngineIdle();
+    if (err != RA8876_OK)
+    {
+      // the engine is stuck; drop whatever is still pending
+      m_queueCount = 0;
+      goto ra8876_flush_done;
+    }
+    m_engineBusy = false;
+
+    if (m_queueCount > 0)
+    {
+      execute(m_queue[m_queueHead]);
+      m_queueHead = (m_queueHead + 1) % RA8876_QUEUE_SIZE;
+      m_queueCount--;
+    }
+  }
+
+ra8876_flush_done:
+
+  _spiEnd();
+
+  return err;
+}
+
+// start a draw/BTE/DMA task; with the INT pin wired the completion flag
+// is re-armed first (the INTF clear goes out in the same frame)
+void
+RA8876::triggerCore(uint8_t reg, uint8_t x)
+{
+  if (m_intPin >= 0)
+  {
+    m_intPending = false;
+    regWrite(RA8876_REG_INTF, RA8876_REG_INT_CORE | RA8876_REG_INT_DMA);
+  }
+  regWrite(reg, x);
+}
+
+void
+RA8876::execute(const RA8876Command &c)
+{
+  uint8_t reg;
+
+  _spiBegin();
+
+  switch (c.type)
+  {
+    case RA8876_COMMAND_TWO_POINT:
+    case RA8876_COMMAND_THREE_POINT:
+         {
+           // first point
+           regWrite16(RA8876_REG_DLHSR0, c.p[0]);
+           regWrite16(RA8876_REG_DLVSR0, c.p[1]);
+
+           // second point
+           regWrite16(RA8876_REG_DLHER0, c.p[2]);
+           regWrite16(RA8876_REG_DLVER0, c.p[3]);
+
+           // third point
+           if (c.type == RA8876_COMMAND_THREE_POINT)
+           {
+             regWrite16(RA8876_REG_DTPH0, c.p[4]);
+             regWrite16(RA8876_REG_DTPV0, c.p[5]);
+           }
+         }
+         break;
+
+    case RA8876_COMMAND_ELLIPSE:
+         {
+           // centre
+           regWrite16(RA8876_REG_DEHR0,  c.p[0]);
+           regWrite16(RA8876_REG_DEVR0,  c.p[1]);
+
+           // radii
+           regWrite16(RA8876_REG_ELL_A0, c.p[2]);
+           regWrite16(RA8876_REG_ELL_B0, c.p[3]);
+         }
+         break;
+
+    case RA8876_COMMAND_BTE_COPY:
+    case RA8876_COMMAND_BTE_COPY_CHROMA:
+         {
+           // set S0 image (the canvas page or an off-screen image)
+           regWrite32(RA8876_REG_BTE_S0_STR0, c.addr);
+           regWrite16(RA8876_REG_BTE_S0_WTH0, c.width);
+
+           // set S0 co-ordinates
+           regWrite16(RA8876_REG_BTE_S0_X0,   c.p[0]);
+           regWrite16(RA8876_REG_BTE_S0_Y0,   c.p[1]);
+
+           // set DEST co-ordinates
+           regWrite16(RA8876_REG_BTE_DEST_X0, c.p[2]);
+           regWrite16(RA8876_REG_BTE_DEST_Y0, c.p[3]);
+
+           // set the copy width and height
+           regWrite16(RA8876_REG_BTE_WTH0,    c.p[4]);
+           regWrite16(RA8876_REG_BTE_HIG0,    c.p[5]);
+
+           // define the BTE mode to use - simply copy source to destination
+           if (c.type == RA8876_COMMAND_BTE_COPY_CHROMA)
+           {
+             // S0 pixels of the key colour (background colour) are skipped
+             regWrite(RA8876_REG_BGCR, c.color.r);
+             regWrite(RA8876_REG_BGCG, c.color.g);
+             regWrite(RA8876_REG_BGCB, c.color.b);
+             reg = RA8876_REG_BTE_MEM_CPY_CHROMA;
+           }
+           else
+             reg = RA8876_REG_BTE_ROP_CODE_12 | RA8876_REG_BTE_MEM_CPY_ROP; // copy with ROP where DEST = S0
+           regWrite(RA8876_REG_BTE_CTRL1, reg);
+
+           // start the operation
+           reg = regRead(RA8876_REG_BTE_CTRL0);
+           reg |= RA8876_REG_BTE_ENABLE;
+           triggerCore(RA8876_REG_BTE_CTRL0, reg);
+         }
+         break;
+
+    case RA8876_COMMAND_BTE_BLIT:
+    case RA8876_COMMAND_BTE_BLIT_COLOR:
+         {
+           // set S0 image and co-ordinates
+           regWrite32(RA8876_REG_BTE_S0_STR0, c.addr);
+           regWrite16(RA8876_REG_BTE_S0_WTH0, c.width);
+           regWrite16(RA8876_REG_BTE_S0_X0,   c.p[0]);
+           regWrite16(RA8876_REG_BTE_S0_Y0,   c.p[1]);
+
+           // S1 is the canvas under the destination, or a constant colour
+           // held where its start address goes (restored for the next blit)
+           if (c.type == RA8876_COMMAND_BTE_BLIT)
+           {
+             regWrite32(RA8876_REG_BTE_S1_STR0, m_canvasAddr);
+             regWrite16(RA8876_REG_BTE_S1_WTH0, m_canvasStride);
+             regWrite16(RA8876_REG_BTE_S1_X0,   c.p[2]);
+             regWrite16(RA8876_REG_BTE_S1_Y0,   c.p[3]);
+             regWrite(RA8876_REG_BTE_COLR, RA8876PixelFormat::bteColr);
+           }
+           else
+           {
+             regWrite(RA8876_REG_BTE_S1_RED,   c.color.r);
+             regWrite(RA8876_REG_BTE_S1_GREEN, c.color.g);
+             regWrite(RA8876_REG_BTE_S1_BLUE,  c.color.b);
+             reg = (RA8876PixelFormat::bteColr & ~RA8876_REG_BTE_S1_DEPTH_MASK) | RA8876_REG_BTE_S1_CONSTANT_COLOR;
+             regWrite(RA8876_REG_BTE_COLR, reg);
+           }
+
+           // set DEST co-ordinates
+           regWrite16(RA8876_REG_BTE_DEST_X0, c.p[2]);
+           regWrite16(RA8876_REG_BTE_DEST_Y0, c.p[3]);
+
+           // set the copy width and height
+           regWrite16(RA8876_REG_BTE_WTH0,    c.p[4]);
+           regWrite16(RA8876_REG_BTE_HIG0,    c.p[5]);
+
+           // raster operation, or opacity of S0 over S1
+           if ((c.reg & RA8876_REG_BTE_OPERATION_MASK) == RA8876_REG_BTE_MEM_CPY_OPACITY)
+             regWrite(RA8876_REG_APB_CTRL, c.cmd);
+           regWrite(RA8876_REG_BTE_CTRL1, c.reg);
+
+           // start the operation
+           reg = regRead(RA8876_REG_BTE_CTRL0);
+           reg |= RA8876_REG_BTE_ENABLE;
+           triggerCore(RA8876_REG_BTE_CTRL0, reg);
+         }
+         break;
+
+    case RA8876_COMMAND_DMA:
+         {
+           // the flash in DMA mode (shadowed, sent when it changes)
+           regWrite(RA8876_REG_SPI_DIVSOR, m_flashDivisor);
+           regWrite(RA8876_REG_SFL_CTRL,   m_flashCtrl);
+
+           // source picture
+           regWrite32(RA8876_REG_DMA_SSTR0,  c.addr);
+           regWrite16(RA8876_REG_DMA_SWTH0,  c.width);
+
+           // destination block on the canvas
+           regWrite16(RA8876_REG_DMA_DX0,    c.p[0]);
+           regWrite16(RA8876_REG_DMA_DY0,    c.p[1]);
+           regWrite16(RA8876_REG_DMA_DWTH0,  c.p[2]);
+           regWrite16(RA8876_REG_DMA_DHIGH0, c.p[3]);
+
+           // start the operation
+           triggerCore(RA8876_REG_DMA_CTRL, RA8876_REG_DMA_START);
+         }
+         break;
+
+    case RA8876_COMMAND_BTE_SOLID_FILL:
+         {
+           // set DEST co-ordinates
+           regWrite16(RA8876_REG_BTE_DEST_X0, c.p[0]);
+           regWrite16(RA8876_REG_BTE_DEST_Y0, c.p[1]);
+
+           // set the fill width and height
+           regWrite16(RA8876_REG_BTE_WTH0,    c.p[2]);
+           regWrite16(RA8876_REG_BTE_HIG0,    c.p[3]);
+
+           // the fill colour is the foreground colour
+           regWrite(RA8876_REG_FGCR, c.color.r);
+           regWrite(RA8876_REG_FGCG, c.color.g);
+           regWrite(RA8876_REG_FGCB, c.color.b);
+
+           regWrite(RA8876_REG_BTE_CTRL1, RA8876_REG_BTE_SOLID_FILL);
+
+           // start the operation
+           reg = regRead(RA8876_REG_BTE_CTRL0);
+           reg |= RA8876_REG_BTE_ENABLE;
+           triggerCore(RA8876_REG_BTE_CTRL0, reg);
+         }
+         break;
+
+    case RA8876_COMMAND_BTE_PATTERN_FILL:
+         {
+           // S0 is the tile, stored as a pattern wide image
+           regWrite32(RA8876_REG_BTE_S0_STR0, c.addr);
+           regWrite16(RA8876_REG_BTE_S0_WTH0, c.reg);
+           regWrite16(RA8876_REG_BTE_S0_X0,   0);
+           regWrite16(RA8876_REG_BTE_S0_Y0,   0);
+
+           // set DEST co-ordinates
+           regWrite16(RA8876_REG_BTE_DEST_X0, c.p[0]);
+           regWrite16(RA8876_REG_BTE_DEST_Y0, c.p[1]);
+
+           // set the fill width and height
+           regWrite16(RA8876_REG_BTE_WTH0,    c.p[2]);
+           regWrite16(RA8876_REG_BTE_HIG0,    c.p[3]);
+
+           // repeat the tile over the destination where DEST = S0
+           reg = RA8876_REG_BTE_ROP_CODE_12 | RA8876_REG_BTE_PAT_FILL_ROP;
+           regWrite(RA8876_REG_BTE_CTRL1, reg);
+
+           // start the operation with the matching tile format
+           reg = regRead(RA8876_REG_BTE_CTRL0);
+           reg &= ~RA8876_REG_BTE_PATTERN_FORMAT16X16;
+           if (c.reg == RA8876_PATTERN_16X16) reg |= RA8876_REG_BTE_PATTERN_FORMAT16X16;
+           reg |= RA8876_REG_BTE_ENABLE;
+           triggerCore(RA8876_REG_BTE_CTRL0, reg);
+         }
+         break;
+  }
+
+  // geometry engine commands: colour, then trigger
+  if (c.type <= RA8876_COMMAND_ELLIPSE)
+  {
+    regWrite(RA8876_REG_FGCR, c.color.r);
+    regWrite(RA8876_REG_FGCG, c.color.g);
+    regWrite(RA8876_REG_FGCB, c.color.b);
+
+    triggerCore(c.reg, c.cmd);
+  }
 
-  // wait for completion
-  waitUntilStatusIdle();
+  _spiEnd();
 
-  SPI.endTransaction();
+  m_engineBusy = true;
 }
 
 //-------------------------------------------------------------------------
\ No newline at end of file
@@ -23,6 +23,9 @@ class Color
     uint8_t  toRGB332() const;
     uint16_t toRGB565() const;
 
+    static void toRGB332(const Color *src, uint8_t  *dst, size_t cnt);
+    static void toRGB565(const Color *src, uint16_t *dst, size_t cnt);
+
     static const Color Black;       // black
     static const Color White;       // white
     static const Color Red;         // red
@@ -67,6 +70,35 @@ uint16_t Color::toRGB565() const
           (((uint16_t)b & 0xf8) >> 3));
 }
 
+// bulk conversion, four pixels per iteration
+void Color::toRGB332(const Color *src, uint8_t *dst, size_t cnt)
+{
+  while (cnt >= 4)
+  {
+    uint8_t p0 = (src[0].r & 0xe0) | ((src[0].g & 0xe0) >> 3) | (src[0].b >> 6);
+    uint8_t p1 = (src[1].r & 0xe0) | ((src[1].g & 0xe0) >> 3) | (src[1].b >> 6);
+    uint8_t p2 = (src[2].r & 0xe0) | ((src[2].g & 0xe0) >> 3) | (src[2].b >> 6);
+    uint8_t p3 = (src[3].r & 0xe0) | ((src[3].g & 0xe0) >> 3) | (src[3].b >> 6);
+    dst[0] = p0; dst[1] = p1; dst[2] = p2; dst[3] = p3;
+    src += 4; dst += 4; cnt -= 4;
+  }
+  while (cnt--) *dst++ = (src++)->toRGB332();
+}
+
+void Color::toRGB565(const Color *src, uint16_t *dst, size_t cnt)
+{
+  while (cnt >= 4)
+  {
+    uint16_t p0 = ((src[0].r & 0xf8) << 8) | ((src[0].g & 0xfc) << 3) | (src[0].b >> 3);
+    uint16_t p1 = ((src[1].r & 0xf8) << 8) | ((src[1].g & 0xfc) << 3) | (src[1].b >> 3);
+    uint16_t p2 = ((src[2].r & 0xf8) << 8) | ((src[2].g & 0xfc) << 3) | (src[2].b >> 3);
+    uint16_t p3 = ((src[3].r & 0xf8) << 8) | ((src[3].g & 0xfc) << 3) | (src[3].b >> 3);
+    dst[0] = p0; dst[1] = p1; dst[2] = p2; dst[3] = p3;
+    src += 4; dst += 4; cnt -= 4;
+  }
+  while (cnt--) *dst++ = (src++)->toRGB565();
+}
+
 // static color defines
 const Color Color::Black      (0x00, 0x00, 0x00);
 const Color Color::White      (0xff, 0xff, 0xff);
@@ -121,6 +153,580 @@ struct RA8876PllParams
   int      k;           // divisor power of 2 (range 0..3 for CCLK/MCLK; range 0..7 for SCLK)
 };
 
+//--------------------------------------------------------------------------
+// RA8876Clocks
+//
+// the PLL search and the clock rules are evaluated at compile time for
+// the configuration selected in ra8876-config.h; a k of 0 means no usable
+// PLL parameters were found for the requested frequency.
+
+struct RA8876Clocks
+{
+  RA8876PllParams mem;  // MCLK (memory) PLL parameters
+  RA8876PllParams core; // CCLK (core) PLL parameters
+  RA8876PllParams scan; // SCLK (LCD panel scan) PLL parameters
+};
+
+// display configurations (RA8876_CONFIG)
+#define RA8876_CONFIG_1366x768            0
+#define RA8876_CONFIG_1280x720            1
+#define RA8876_CONFIG_1024x768            2
+#define RA8876_CONFIG_1024x600            3
+#define RA8876_CONFIG_800x600             4
+
+#ifndef RA8876_OSC_CLOCK
+#define RA8876_OSC_CLOCK                  11000 // kHz; suggested OSC frequency is 11.0592MHz
+#endif
+
+constexpr int
+ra8876PllN(uint32_t osc, uint32_t target, int k)
+{
+  return (int)(target / (osc >> k)) - 1;
+}
+
+constexpr uint32_t
+ra8876PllFreq(uint32_t osc, int n, int k)
+{
+  return (osc * (n + 1)) >> k;
+}
+
+// k of 0 (i.e. 2 ** 0 = 1) is possible, but not sure if it's a good idea.
+// the step size must not be fractional, n must be in range (1..63) and
+// fvco must be within 250..500 MHz (data sheet section 6.1.2)
+constexpr bool
+ra8876PllValid(uint32_t osc, uint32_t target, int k)
+{
+  return ((osc >> k) != 0) && ((osc % (1UL << k)) == 0) &&
+         (ra8876PllN(osc, target, k) >= 1) && (ra8876PllN(osc, target, k) <= 63) &&
+         ((osc * (ra8876PllN(osc, target, k) + 1)) >= 250000) &&
+         ((osc * (ra8876PllN(osc, target, k) + 1)) <= 500000);
+}
+
+// amount lower than the requested frequency
+constexpr uint32_t
+ra8876PllError(uint32_t osc, uint32_t target, int k)
+{
+  return target - ra8876PllFreq(osc, ra8876PllN(osc, target, k), k);
+}
+
+// smallest error wins, the lowest k on a tie
+constexpr int
+ra8876PllBestK(uint32_t osc, uint32_t target, int k, int kMax, int best)
+{
+  return (k > kMax) ? best :
+         ra8876PllBestK(osc, target, k + 1, kMax,
+                        (ra8876PllValid(osc, target, k) &&
+                         ((best == 0) || (ra8876PllError(osc, target, k) < ra8876PllError(osc, target, best)))) ? k : best);
+}
+
+constexpr RA8876PllParams
+ra8876PllParams(uint32_t osc, uint32_t target, int k)
+{
+  return (k == 0) ? RA8876PllParams{ 0, 0, 0, 0 }
+                  : RA8876PllParams{ ra8876PllFreq(osc, ra8876PllN(osc, target, k), k), 0, ra8876PllN(osc, target, k), k };
+}
+
+constexpr RA8876PllParams
+ra8876Pll(uint32_t osc, uint32_t target, int kMax)
+{
+  return ra8876PllParams(osc, target, ra8876PllBestK(osc, target, 1, kMax, 0));
+}
+
+constexpr uint32_t
+ra8876ClockCap(uint32_t freq, uint32_t max)
+{
+  return (freq > max) ? max : freq;
+}
+
+// Data sheet section 2.5 gives max clocks:
+//  memClock : 166 MHz
+//  coreClock: 120 MHz (133MHz if not using internal font)
+//  scanClock: 100 MHz
+//
+// the core clock target is the mem clock (capped to 120 MHz), the scan
+// clock target is the display's dot clock (capped at 100 MHz)
+constexpr RA8876Clocks
+ra8876ClocksFor(uint32_t osc, RA8876PllParams mem, uint32_t dotClock)
+{
+  return RA8876Clocks{ mem,
+                       ra8876Pll(osc, ra8876ClockCap(mem.freq, 120000), 3),
+                       ra8876Pll(osc, ra8876ClockCap(dotClock, 100000), 7) };
+}
+
+// mem clock target is the same as buffer ram speed, but capped at 166 MHz
+constexpr RA8876Clocks
+ra8876Clocks(uint32_t osc, uint32_t ramFreq, uint32_t dotClock)
+{
+  return ra8876ClocksFor(osc, ra8876Pll(osc, ra8876ClockCap(ramFreq, 166000), 3), dotClock);
+}
+
+//--------------------------------------------------------------------------
+// RA8876DisplayTiming
+//
+// LCD display control register values (data sheet 19.5), derived from a
+// RA8876DisplayInfo at compile time
+
+struct RA8876DisplayTiming
+{
+  uint8_t  hdwr;        // display width
+  uint8_t  hdwftr;
+  uint8_t  vdhr0;       // display height
+  uint8_t  vdhr1;
+  uint8_t  hndr;        // horizontal non-display (back porch)
+  uint8_t  hndftr;
+  uint8_t  hstr;        // horizontal start position (front porch)
+  uint8_t  hpwr;        // HSYNC pulse width
+  uint8_t  vndr0;       // vertical non-display (back porch)
+  uint8_t  vndr1;
+  uint8_t  vstr;        // vertical start position (front porch)
+  uint8_t  vpwr;        // VSYNC pulse width
+};
+
+constexpr RA8876DisplayTiming
+ra8876DisplayTiming(const RA8876DisplayInfo &info)
+{
+  return RA8876DisplayTiming{
+    (uint8_t)(((info.width / 8) - 1)             & 0xff),
+    (uint8_t)( (info.width % 8)                  & 0x07),
+    (uint8_t)( (info.height - 1)                 & 0xff),
+    (uint8_t)(((info.height - 1) >> 8)           & 0x07),
+    (uint8_t)(((info.hBackPorch / 8) - 1)        & 0x1f),
+    (uint8_t)( (info.hBackPorch % 8)             & 0x0f),
+    (uint8_t)((((info.hFrontPorch + 4) / 8) - 1) & 0x1f),
+    (uint8_t)((((info.hPulseWidth + 4) / 8) - 1) & 0x1f),
+    (uint8_t)( (info.vBackPorch - 1)             & 0xff),
+    (uint8_t)(((info.vBackPorch - 1) >> 8)       & 0x03),
+    (uint8_t)( (info.vFrontPorch - 1)            & 0xff),
+    (uint8_t)( (info.vPulseWidth - 1)            & 0x3f) };
+}
+
+// every field must fit its register without being truncated
+constexpr bool
+ra8876DisplayTimingValid(const RA8876DisplayInfo &info)
+{
+  return (info.width       >= 8) && (info.width       <= 2048) &&
+         (info.height      >= 1) && (info.height      <= 2048) &&
+         (info.hBackPorch  >= 8) && (info.hBackPorch  <= 263)  &&
+         (info.hFrontPorch >= 4) && (info.hFrontPorch <= 259)  &&
+         (info.hPulseWidth >= 4) && (info.hPulseWidth <= 259)  &&
+         (info.vBackPorch  >= 1) && (info.vBackPorch  <= 1024) &&
+         (info.vFrontPorch >= 1) && (info.vFrontPorch <= 256)  &&
+         (info.vPulseWidth >= 1) && (info.vPulseWidth <= 64);
+}
+
+//--------------------------------------------------------------------------
+// RA8876SpiStats
+
+struct RA8876SpiStats
+{
+  uint32_t bytes;       // bytes clocked over the SPI bus
+  uint32_t frames;      // chip-select assertions (CS toggles)
+  uint32_t transfers;   // SPI.transfer() calls
+
+  uint32_t readsAvoided;   // register reads served from the shadow cache
+  uint32_t writesAvoided;  // register writes skipped (value unchanged)
+  uint32_t mismatches;     // shadow values that disagreed with the chip
+};
+
+//--------------------------------------------------------------------------
+// RA8876Error
+
+enum RA8876Error
+{
+  RA8876_OK                             = 0x00,  // success
+  RA8876_ERROR_TIMEOUT                  = 0x01,  // status condition not reached in time
+  RA8876_ERROR_DEPTH                    = 0x02,  // pixel format does not match the colour depth
+  RA8876_ERROR_MEMORY                   = 0x03,  // not enough display memory
+  RA8876_ERROR_PARAMETER                = 0x04,  // invalid argument (e.g. an unloaded pattern slot)
+  RA8876_ERROR_CLIP                     = 0x05   // clip stack over- or underflow
+};
+
+//--------------------------------------------------------------------------
+// RA8876WaitCondition
+
+enum RA8876WaitCondition
+{
+  RA8876_WAIT_MODE_NORMAL               = 0x00,  // normal operation state
+  RA8876_WAIT_MEMORY_READY              = 0x01,  // buffer RAM ready for access
+  RA8876_WAIT_STATUS_IDLE               = 0x02,  // core task (draw/BTE) idle
+  RA8876_WAIT_EMPTY_FIFO_READ           = 0x03,  // host memory read FIFO empty
+  RA8876_WAIT_EMPTY_FIFO_WRITE          = 0x04,  // host memory write FIFO empty
+  RA8876_WAIT_FULL_FIFO_READ            = 0x05,  // host memory read FIFO full
+  RA8876_WAIT_FULL_FIFO_WRITE           = 0x06,  // host memory write FIFO full
+  RA8876_WAIT_VSYNC                     = 0x07,  // vertical sync (INTF vsync flag)
+  RA8876_WAIT_COUNT
+};
+
+// wait time histogram buckets (per condition)
+//  0: satisfied on the first poll   4: < 1 ms
+//  1: < 16 us                       5: < 4 ms
+//  2: < 64 us                       6: >= 4 ms
+//  3: < 256 us                      7: timed out
+#define RA8876_WAIT_BUCKETS               8
+
+#ifndef RA8876_WAIT_BACKOFF_MAX
+#define RA8876_WAIT_BACKOFF_MAX           256   // us, upper bound of poll back-off
+#endif
+
+//--------------------------------------------------------------------------
+// RA8876FrameStats
+//
+// the vertical sync flag marks the start of vertical blanking; the frame
+// and blank periods follow from the display timing registers and the scan
+// clock, so once one sync has been seen the next can be slept towards and
+// only the last RA8876_VBLANK_MARGIN is polled
+
+#ifndef RA8876_VBLANK_MARGIN
+#define RA8876_VBLANK_MARGIN              500   // us polled before a predicted sync
+#endif
+
+#ifndef RA8876_VBLANK_POLL
+#define RA8876_VBLANK_POLL                10    // us between polls near a sync
+#endif
+
+struct RA8876FrameStats
+{
+  uint32_t frames;      // beginFrame() calls
+  uint32_t missed;      // vertical syncs that passed without a frame starting
+  uint32_t overBudget;  // frames that sent more than the byte budget
+  uint32_t lastUs;      // time between the last two frames
+  uint32_t maxErrorUs;  // worst distance from a whole number of frame periods
+};
+
+//--------------------------------------------------------------------------
+// RA8876Command
+
+enum RA8876CommandType
+{
+  RA8876_COMMAND_TWO_POINT              = 0x00,  // line, rectangle
+  RA8876_COMMAND_THREE_POINT            = 0x01,  // triangle
+  RA8876_COMMAND_ELLIPSE                = 0x02,  // circle, ellipse
+  RA8876_COMMAND_BTE_COPY               = 0x03,  // bte memory copy
+  RA8876_COMMAND_BTE_SOLID_FILL         = 0x04,  // bte solid fill
+  RA8876_COMMAND_BTE_PATTERN_FILL       = 0x05,  // bte pattern fill
+  RA8876_COMMAND_BTE_COPY_CHROMA        = 0x06,  // bte memory copy, colour keyed
+  RA8876_COMMAND_BTE_BLIT               = 0x07,  // bte memory copy with rop or opacity, S1 = canvas
+  RA8876_COMMAND_BTE_BLIT_COLOR         = 0x08,  // bte memory copy with opacity, S1 = constant colour
+  RA8876_COMMAND_DMA                    = 0x09   // serial flash block copy
+};
+
+// an engine command, as held in the asynchronous command queue
+struct RA8876Command
+{
+  uint8_t  type;        // RA8876CommandType
+  uint8_t  reg;         // trigger register (draw commands), bte operation (blit)
+  uint8_t  cmd;         // trigger value    (draw commands), opacity        (blit)
+  uint16_t p[6];        // co-ordinates, radii or bte source/dest/size
+  uint32_t addr;        // bte source start address (copy, pattern fill), flash offset (dma)
+  uint16_t width;       // bte source image width  (copy), flash picture width (dma)
+  Color    color;       // draw colour, fill colour or chroma key
+};
+
+// engine completion callback (runs in interrupt context)
+typedef void (*RA8876Callback)();
+
+#ifndef RA8876_QUEUE_SIZE
+#define RA8876_QUEUE_SIZE                 16    // pending engine commands (async mode)
+#endif
+
+//--------------------------------------------------------------------------
+// RA8876BitmapFont
+//
+// a proportional 1bpp font drawn through bte colour expansion. glyph
+// bitmaps are msb first with every row padded to a whole byte, the layout
+// the bte expects, so they are streamed to the chip as they are.
+
+struct RA8876Glyph
+{
+  uint16_t offset;      // first byte of the bitmap
+  uint8_t  width;       // bitmap size in pixels
+  uint8_t  height;
+  uint8_t  advance;     // cursor advance
+  int8_t   xOffset;     // bitmap position relative to the cursor (top of the line)
+  int8_t   yOffset;
+};
+
+struct RA8876BitmapFont
+{
+  const uint8_t     *bitmap;
+  const RA8876Glyph *glyph;     // one per character, first .. last
+  uint8_t            first;
+  uint8_t            last;
+  uint8_t            height;    // line height
+};
+
+//--------------------------------------------------------------------------
+// RA8876TextCache
+//
+// strings drawn with drawCachedText() are rendered once into a slot of an
+// off-screen image and copied to the canvas with a colour keyed bte copy
+// after that. slots are recycled least recently used first; strings that
+// do not fit a slot are drawn directly.
+
+#ifndef RA8876_TEXT_CACHE_SLOTS
+#define RA8876_TEXT_CACHE_SLOTS           48    // cached strings
+#endif
+
+#ifndef RA8876_TEXT_CACHE_WIDTH
+#define RA8876_TEXT_CACHE_WIDTH           320   // slot size in pixels
+#endif
+
+#ifndef RA8876_TEXT_CACHE_HEIGHT
+#define RA8876_TEXT_CACHE_HEIGHT          32
+#endif
+
+#ifndef RA8876_TEXT_CACHE_TEXT
+#define RA8876_TEXT_CACHE_TEXT            32    // longest cached string (including the terminator)
+#endif
+
+struct RA8876TextCacheSlot
+{
+  uint32_t hash;        // of the string and its attributes, 0 = empty
+  uint32_t used;        // lru stamp
+  uint16_t width;       // rendered size
+  uint16_t height;
+  char     text[RA8876_TEXT_CACHE_TEXT];
+};
+
+struct RA8876TextCacheStats
+{
+  uint32_t hits;
+  uint32_t misses;      // rendered into a slot
+  uint32_t evictions;   // misses that recycled a used slot
+  uint32_t bypassed;    // too large for a slot, drawn directly
+};
+
+//--------------------------------------------------------------------------
+// RA8876PatternSize
+//
+// bte pattern fill tiles; they are uploaded once into slots at the top of
+// display memory, each slot is large enough for a 16x16 tile
+
+#ifndef RA8876_PATTERN_SLOTS
+#define RA8876_PATTERN_SLOTS              4     // pattern tiles kept in display memory
+#endif
+
+enum RA8876PatternSize
+{
+  RA8876_PATTERN_8X8                    = 8,
+  RA8876_PATTERN_16X16                  = 16
+};
+
+//--------------------------------------------------------------------------
+// RA8876BlitOp
+//
+// bteBlit() combines a source image (S) with what the canvas holds under
+// the destination (D) and writes the result back: a raster operation on
+// the two, a copy that skips the key colour of S, or a blend of S over D
+// (or over a constant colour) at a given opacity
+
+enum RA8876Rop
+{
+  RA8876_ROP_BLACK                      = 0x00,  // 0
+  RA8876_ROP_NOR                        = 0x01,  // ~(S | D)
+  RA8876_ROP_NOT_SRC_AND_DST            = 0x02,  // ~S & D
+  RA8876_ROP_NOT_SRC                    = 0x03,  // ~S
+  RA8876_ROP_SRC_AND_NOT_DST            = 0x04,  // S & ~D
+  RA8876_ROP_NOT_DST                    = 0x05,  // ~D
+  RA8876_ROP_XOR                        = 0x06,  // S ^ D
+  RA8876_ROP_NAND                       = 0x07,  // ~(S & D)
+  RA8876_ROP_AND                        = 0x08,  // S & D
+  RA8876_ROP_XNOR                       = 0x09,  // ~(S ^ D)
+  RA8876_ROP_DST                        = 0x0A,  // D
+  RA8876_ROP_NOT_SRC_OR_DST             = 0x0B,  // ~S | D
+  RA8876_ROP_SRC                        = 0x0C,  // S (plain copy)
+  RA8876_ROP_SRC_OR_NOT_DST             = 0x0D,  // S | ~D
+  RA8876_ROP_OR                         = 0x0E,  // S | D
+  RA8876_ROP_WHITE                      = 0x0F   // 1
+};
+
+enum RA8876BlitMode
+{
+  RA8876_BLIT_ROP                       = 0x00,  // rop(S, D)
+  RA8876_BLIT_CHROMA                    = 0x01,  // S, except where S is the key colour
+  RA8876_BLIT_BLEND                     = 0x02,  // S * alpha + D     * (1 - alpha)
+  RA8876_BLIT_BLEND_COLOR               = 0x03   // S * alpha + color * (1 - alpha)
+};
+
+struct RA8876BlitOp
+{
+  uint8_t  mode;        // RA8876BlitMode
+  uint8_t  rop;         // RA8876Rop                           (RA8876_BLIT_ROP)
+  uint8_t  alpha;       // 0 (all D) .. 255 (all S)            (RA8876_BLIT_BLEND, _BLEND_COLOR)
+  Color    color;       // key colour or the colour blended with (RA8876_BLIT_CHROMA, _BLEND_COLOR)
+};
+
+//--------------------------------------------------------------------------
+// RA8876Rect
+//
+// clip regions form a stack, each one the intersection with the one below.
+// the top region is the active window, so the chip clips geometry and
+// text itself (text wraps at its right edge, like it does at the edge of
+// the canvas); bte operations and memory writes ignore the active window
+// and are clipped by the driver before they are issued
+
+#ifndef RA8876_CLIP_DEPTH
+#define RA8876_CLIP_DEPTH                 8     // nested clip regions
+#endif
+
+struct RA8876Rect
+{
+  uint16_t x, y;
+  uint16_t w, h;
+};
+
+//--------------------------------------------------------------------------
+// RA8876Surface
+//
+// an off-screen image in display memory. surfaces are handed out from the
+// memory above the display pages; the canvas can be pointed at one to draw
+// into it and the bte can copy out of one onto the canvas
+
+#ifndef RA8876_SURFACES
+#define RA8876_SURFACES                   16    // surfaces (pattern tiles and text cache use two)
+#endif
+
+#ifndef RA8876_SURFACE_ALIGN
+#define RA8876_SURFACE_ALIGN              4     // bytes, start address alignment (power of 2)
+#endif
+
+struct RA8876Surface
+{
+  uint32_t addr;        // start address in display memory
+  uint32_t size;        // bytes
+  uint16_t width;       // pixels
+  uint16_t height;
+  uint16_t stride;      // pixels per row (width rounded up to a multiple of 4)
+  uint8_t  depth;       // bits per pixel
+  bool     used;
+};
+
+struct RA8876SurfaceStats
+{
+  uint32_t total;       // bytes above the display pages
+  uint32_t used;        // bytes in surfaces
+  uint32_t largest;     // largest free block
+  uint16_t surfaces;    // surfaces allocated
+  uint16_t freeBlocks;  // free blocks (1 = not fragmented)
+  uint8_t  fragmentation;   // % of free memory outside the largest block
+};
+
+//--------------------------------------------------------------------------
+// RA8876Pip
+//
+// the two picture-in-picture windows are composited over the main window
+// at scan-out (PIP1 above PIP2). each shows part of a surface at a screen
+// position; moving, scrolling or toggling one is a few register writes and
+// never touches the display page underneath
+
+enum RA8876PipWindow
+{
+  RA8876_PIP_1                          = 0x00,
+  RA8876_PIP_2                          = 0x01
+};
+
+struct RA8876Pip
+{
+  const RA8876Surface *surface;   // image shown (NULL = not set up)
+  uint16_t x, y;        // screen position
+  uint16_t w, h;        // window size
+  uint16_t sx, sy;      // window position within the surface
+  bool     visible;
+};
+
+//--------------------------------------------------------------------------
+// RA8876Asset
+//
+// images kept in the serial flash attached to the controller are copied
+// into display memory by its DMA engine, never crossing the host SPI bus.
+// the manifest is a table of the images in the flash: each one is stored
+// row by row in the pixel format of the driver colour depth
+
+#ifndef RA8876_FLASH_SELECT
+#define RA8876_FLASH_SELECT               0     // serial flash chip select (0 or 1)
+#endif
+
+#ifndef RA8876_FLASH_DIVISOR
+#define RA8876_FLASH_DIVISOR              1     // flash clock = CCLK / ((divisor + 1) * 2)
+#endif
+
+struct RA8876Asset
+{
+  const char *name;
+  uint32_t    offset;   // first byte in the flash
+  uint16_t    width;    // pixels
+  uint16_t    height;
+  uint8_t     depth;    // bits per pixel, as stored
+};
+
+//--------------------------------------------------------------------------
+// RA8876Palette
+//
+// the application draws with small colour indices. setPalette() maps each
+// of them to the nearest colour the display shows at the driver colour
+// depth and keeps it packed in the pixel format, so an indexed bulk write
+// is a table lookup per pixel; at 8bpp every index is a single byte on the
+// wire and in display memory. content the engines draw (text, shapes,
+// fills) costs the same at every depth: for it the palette only names the
+// colours.
+
+#ifndef RA8876_PALETTE_SIZE
+#define RA8876_PALETTE_SIZE               16    // colour indices
+#endif
+
+//--------------------------------------------------------------------------
+// RA8876Sprite
+//
+// a palette image compressed with run-length encoding, as generated from a
+// png by tools/ra8876-sprite.py. the stream holds palette indices in raster
+// order, runs carry on across the end of a row:
+//
+//   0x00 .. 0x7f  n + 1 literal pixels, an index each
+//   0x80 .. 0xfe  (n & 0x7f) + 2 pixels of the index that follows
+//   0xff          a 16 bit pixel count (lsb first), then the index
+//
+// drawSprite() decodes it straight into the memory port; runs that would
+// cost more than a bte solid fill on the wire are filled instead. a stream
+// that ends before the last pixel or uses an index past the palette is
+// RA8876_ERROR_PARAMETER (the pixels before the fault are drawn).
+
+#ifndef RA8876_SPRITE_FILL
+#define RA8876_SPRITE_FILL                32    // pixel bytes a run must cover to become a bte fill
+#endif
+
+#ifndef RA8876_SPRITE_CHUNK
+#define RA8876_SPRITE_CHUNK               32    // pixels converted at a time
+#endif
+
+#define RA8876_SPRITE_OPAQUE              0xffff
+
+struct RA8876Sprite
+{
+  const uint8_t *palette;       // (r, g, b) per colour
+  const uint8_t *data;          // rle stream
+  uint32_t       size;          // bytes in the stream
+  uint16_t       width;
+  uint16_t       height;
+  uint16_t       colors;        // palette entries (1 .. 256)
+  uint16_t       transparent;   // index that is not drawn (RA8876_SPRITE_OPAQUE = none)
+};
+
+// decoder state of drawSprite()
+struct RA8876SpriteStream
+{
+  const RA8876Sprite *sprite;
+  uint16_t       x, y;          // sprite position
+  uint16_t       cx, cy;        // visible part
+  uint16_t       cw, ch;
+  uint16_t       col, row;      // next pixel of the sprite
+  bool           window;        // active window set to the visible part
+  bool           open;          // memory port open, next pixel at (nx, ny)
+  bool           filled;        // a bte fill may still be running
+  uint16_t       nx, ny;
+  Color          buf[RA8876_SPRITE_CHUNK];
+  uint8_t        len;
+};
+
 enum RA8876FontSize
 {
   RA8876_FONT_SIZE_16                   = 0x00,
@@ -158,6 +764,32 @@ typedef uint8_t RA8876FontFlags;
 
 #define RA8876_FONT_FLAG_XLAT_FULLWIDTH   0x01  // translate ASCII to Unicode fullwidth forms
 
+enum RA8876TextAlign
+{
+  RA8876_TEXT_ALIGN_LEFT                = 0x00,
+  RA8876_TEXT_ALIGN_CENTER              = 0x01,
+  RA8876_TEXT_ALIGN_RIGHT               = 0x02
+};
+
+// SPI bus the controller is attached to (a host build points this at the
+// RA8876 emulator, see ra8876-host.h)
+#ifndef RA8876_SPI_BUS
+#define RA8876_SPI_BUS                    SPI
+#endif
+
+// SPI transport: register/data cycles are sent straight away, one chip-
+// select frame each; memory port writes are streamed in a single frame
+// through this buffer
+#ifndef RA8876_SPI_BUFFER_SIZE
+#define RA8876_SPI_BUFFER_SIZE            64    // bytes
+#endif
+
+// shadow register cache: define RA8876_SHADOW_VERIFY as 1 to cross-check
+// every cached register read against the chip (debug only; costs a read)
+#ifndef RA8876_SHADOW_VERIFY
+#define RA8876_SHADOW_VERIFY              0
+#endif
+
 #define RA8876_DATA_WRITE                 0x80
 #define RA8876_DATA_READ                  0xC0
 #define RA8876_CMD_WRITE                  0x00
@@ -254,8 +886,19 @@ typedef uint8_t RA8876FontFlags;
 #define RA8876_REG_SPLLC1                 0x09  // CCLK PLL control register 1
 #define RA8876_REG_SPLLC2                 0x0A  // CCLK PLL control register 2
 
-                                       // 0x0B
-                                       // ..
+// Data sheet 19.4: interrupt control registers
+#define RA8876_REG_INTEN                  0x0B  // interrupt enable register
+#define RA8876_REG_INTF                   0x0C  // interrupt event flag register (write 1 to clear)
+#define RA8876_REG_MINTFR                 0x0D  // mask interrupt flag register
+
+  #define RA8876_REG_INT_WAKEUP           (1 << 7) // wakeup/resume
+  #define RA8876_REG_INT_VSYNC            (1 << 4) // vsync time base
+  #define RA8876_REG_INT_CORE             (1 << 3) // draw/BTE task finished
+  #define RA8876_REG_INT_DMA              (1 << 2) // serial flash DMA finished
+  #define RA8876_REG_INT_PWM1             (1 << 1) // PWM1 timer
+  #define RA8876_REG_INT_PWM0             (1 << 0) // PWM0 timer
+
+                                       // 0x0E
                                        // 0x0F  // undefined/reserved
 
 // Data sheet 19.5: LCD display control registers
@@ -283,6 +926,17 @@ typedef uint8_t RA8876FontFlags;
   #define RA8876_REG_MPWCTR_SYNC_ENABLE     (0 << 0) // enable
 
 #define RA8876_REG_PIPCDEP                0x11  // PIP window color depth register
+
+  #define RA8876_REG_PIPCDEP_PIP1_MASK    (3 << 2) // PIP1 image depth
+  #define RA8876_REG_PIPCDEP_PIP1_24BPP     (2 << 2) // 24bpp
+  #define RA8876_REG_PIPCDEP_PIP1_16BPP     (1 << 2) // 16bpp
+  #define RA8876_REG_PIPCDEP_PIP1_8BPP      (0 << 2) // 8bpp
+
+  #define RA8876_REG_PIPCDEP_PIP2_MASK    (3 << 0) // PIP2 image depth
+  #define RA8876_REG_PIPCDEP_PIP2_24BPP     (2 << 0) // 24bpp
+  #define RA8876_REG_PIPCDEP_PIP2_16BPP     (1 << 0) // 16bpp
+  #define RA8876_REG_PIPCDEP_PIP2_8BPP      (0 << 0) // 8bpp
+
 #define RA8876_REG_DPCR                   0x12  // display configuration register
 
   #define RA8876_REG_DPCR_PCLK_MASK       (1 << 7) // PCLK inversion
@@ -368,7 +1022,28 @@ typedef uint8_t RA8876FontFlags;
 #define RA8876_REG_MWULY0                 0x28  // main window upper-left Y coordinate 0
 #define RA8876_REG_MWULY1                 0x29  // main window upper-left Y coordinate 1
 
-                                       // 0x2A 
+
+// PIP window registers, PIP1 or PIP2 as selected by MPWCTR (PIPC)
+#define RA8876_REG_PWDULX0                0x2A  // PIP window display upper-left X coordinate 0
+#define RA8876_REG_PWDULX1                0x2B  // PIP window display upper-left X coordinate 1
+#define RA8876_REG_PWDULY0                0x2C  // PIP window display upper-left Y coordinate 0
+#define RA8876_REG_PWDULY1                0x2D  // PIP window display upper-left Y coordinate 1
+#define RA8876_REG_PISA0                  0x2E  // PIP image start address 0
+#define RA8876_REG_PISA1                  0x2F  // PIP image start address 1
+#define RA8876_REG_PISA2                  0x30  // PIP image start address 2
+#define RA8876_REG_PISA3                  0x31  // PIP image start address 3
+#define RA8876_REG_PIW0                   0x32  // PIP image width 0
+#define RA8876_REG_PIW1                   0x33  // PIP image width 1
+#define RA8876_REG_PWIULX0                0x34  // PIP window image upper-left X coordinate 0
+#define RA8876_REG_PWIULX1                0x35  // PIP window image upper-left X coordinate 1
+#define RA8876_REG_PWIULY0                0x36  // PIP window image upper-left Y coordinate 0
+#define RA8876_REG_PWIULY1                0x37  // PIP window image upper-left Y coordinate 1
+#define RA8876_REG_PWW0                   0x38  // PIP window width 0
+#define RA8876_REG_PWW1                   0x39  // PIP window width 1
+#define RA8876_REG_PWH0                   0x3A  // PIP window height 0
+#define RA8876_REG_PWH1                   0x3B  // PIP window height 1
+
+                                       // 0x3C 
                                        // .. 
                                        // 0x4F  // undefined/reserved
 
@@ -573,17 +1248,58 @@ typedef uint8_t RA8876FontFlags;
 #define RA8876_REG_BTE_HIG1               0xB4
 #define RA8876_REG_APB_CTRL               0xB5
 
+#define RA8876_REG_APB_ALPHA_MASK           (63 << 0)  // opacity of S0, 0 .. 32 (/ 32)
+#define RA8876_REG_APB_ALPHA_MAX            32
+
 // Data sheet 19.9: Serial flash & SPI master control registers
 #define RA8876_REG_DMA_CTRL               0xB6
 
 #define RA8876_REG_DMA_START                (1 << 0)
 
 #define RA8876_REG_SFL_CTRL               0xB7  // serial flash/ROM control register
-#define RA8876_REG_SPI_DIVSOR             0xBB  // SPI clock period
 
-                                       // 0xBC
-                                       // ..
-                                       // 0xCB  // undefined/reserved
+  #define RA8876_REG_SFL_CTRL_SELECT_MASK (1 << 7) // serial flash/ROM select
+  #define RA8876_REG_SFL_CTRL_SELECT_1      (1 << 7) // serial flash/ROM 1
+  #define RA8876_REG_SFL_CTRL_SELECT_0      (0 << 7) // serial flash/ROM 0
+
+  #define RA8876_REG_SFL_CTRL_MODE_MASK   (1 << 6) // access mode
+  #define RA8876_REG_SFL_CTRL_MODE_DMA      (1 << 6) // DMA
+  #define RA8876_REG_SFL_CTRL_MODE_FONT     (0 << 6) // font
+
+  #define RA8876_REG_SFL_CTRL_ADDR_MASK   (1 << 5) // address width
+  #define RA8876_REG_SFL_CTRL_ADDR_32BIT    (1 << 5) // 32 bit
+  #define RA8876_REG_SFL_CTRL_ADDR_24BIT    (0 << 5) // 24 bit
+
+  #define RA8876_REG_SFL_CTRL_WAVE_MASK   (1 << 4) // SPI waveform
+  #define RA8876_REG_SFL_CTRL_WAVE_MODE3    (1 << 4) // mode 3
+  #define RA8876_REG_SFL_CTRL_WAVE_MODE0    (0 << 4) // mode 0
+
+  #define RA8876_REG_SFL_CTRL_READ_MASK   (15 << 0) // read command
+  #define RA8876_REG_SFL_CTRL_READ_FAST     (4 << 0) // 0Bh, 8 dummy cycles
+  #define RA8876_REG_SFL_CTRL_READ_NORMAL   (0 << 0) // 03h
+
+#define RA8876_REG_SPIDR                  0xB8  // SPI master transmit/receive data register
+#define RA8876_REG_SPIMCR2                0xB9  // SPI master control register
+#define RA8876_REG_SPIMSR                 0xBA  // SPI master status register
+#define RA8876_REG_SPI_DIVSOR             0xBB  // SPI clock period (CCLK / ((divisor + 1) * 2))
+#define RA8876_REG_DMA_SSTR0              0xBC  // DMA source start address 0
+#define RA8876_REG_DMA_SSTR1              0xBD  // DMA source start address 1
+#define RA8876_REG_DMA_SSTR2              0xBE  // DMA source start address 2
+#define RA8876_REG_DMA_SSTR3              0xBF  // DMA source start address 3
+#define RA8876_REG_DMA_DX0                0xC0  // DMA destination upper-left X coordinate 0
+#define RA8876_REG_DMA_DX1                0xC1  // DMA destination upper-left X coordinate 1
+#define RA8876_REG_DMA_DY0                0xC2  // DMA destination upper-left Y coordinate 0
+#define RA8876_REG_DMA_DY1                0xC3  // DMA destination upper-left Y coordinate 1
+
+                                       // 0xC4
+                                       // 0xC5  // undefined/reserved
+
+#define RA8876_REG_DMA_DWTH0              0xC6  // DMA block width 0
+#define RA8876_REG_DMA_DWTH1              0xC7  // DMA block width 1
+#define RA8876_REG_DMA_DHIGH0             0xC8  // DMA block height 0
+#define RA8876_REG_DMA_DHIGH1             0xC9  // DMA block height 1
+#define RA8876_REG_DMA_SWTH0              0xCA  // DMA source picture width 0
+#define RA8876_REG_DMA_SWTH1              0xCB  // DMA source picture width 1
 
 // Data sheet 19.10: Text engine
 #define RA8876_REG_CCR0                   0xCC  // character control register 0
@@ -602,8 +1318,11 @@ typedef uint8_t RA8876FontFlags;
 #define RA8876_REG_FGCR                   0xD2  // foreground colour register - red
 #define RA8876_REG_FGCG                   0xD3  // foreground colour register - green
 #define RA8876_REG_FGCB                   0xD4  // foreground colour register - blue
+#define RA8876_REG_BGCR                   0xD5  // background colour register - red
+#define RA8876_REG_BGCG                   0xD6  // background colour register - green
+#define RA8876_REG_BGCB                   0xD7  // background colour register - blue
 
-                                       // 0xD4
+                                       // 0xD8
                                        // ..
                                        // 0xDF  // undefined/reserved
 
@@ -621,35 +1340,231 @@ typedef uint8_t RA8876FontFlags;
                                        // ..
                                        // 0xFF  // undefined/reserved
 
+//--------------------------------------------------------------------------
+// RA8876Pixel
+//
+// the colour depth is fixed at compile time (RA8876_COLOR_DEPTH); each
+// depth has its own pixel format so the pixel loops carry no depth branch
+
+#ifndef RA8876_COLOR_DEPTH
+#define RA8876_COLOR_DEPTH                16
+#endif
+
+// nearest level of a channel that has 'bits' bits on the display; the low
+// bits repeat the high ones, as the display expands them
+inline uint8_t
+ra8876Channel(uint8_t v, uint8_t bits)
+{
+  uint16_t x;
+
+  if (bits >= 8) return v;
+
+  x = (((uint16_t)v * ((1 << bits) - 1) + 127) / 255) << (8 - bits);
+  for (uint8_t n = bits; n < 8; n *= 2) x |= x >> n;
+  return x;
+}
+
+template <int DEPTH>
+struct RA8876Pixel
+{
+  static_assert((DEPTH == 8) || (DEPTH == 16) || (DEPTH == 24), "RA8876_COLOR_DEPTH must be 8, 16 or 24");
+};
+
+template <>
+struct RA8876Pixel<8>
+{
+  static const uint8_t depth   = 8;
+  static const uint8_t bytes   = 1;
+  static const uint8_t mpwctr  = RA8876_REG_MPWCTR_DEPTH_8BPP;
+  static const uint8_t awColor = RA8876_REG_AW_COLOR_DEPTH_8BPP;
+  static const uint8_t bteColr = RA8876_REG_BTE_S0_DEPTH_8BPP  | RA8876_REG_BTE_S1_DEPTH_8BPP  | RA8876_REG_BTE_DEST_DEPTH_8BPP;
+
+  // RGB332
+  static void pack(const Color *src, uint8_t *dst, size_t cnt)
+  {
+    Color::toRGB332(src, dst, cnt);
+  }
+
+  // the colour the display shows for c
+  static Color nearest(Color c)
+  {
+    return Color(ra8876Channel(c.r, 3), ra8876Channel(c.g, 3), ra8876Channel(c.b, 2));
+  }
+};
+
+template <>
+struct RA8876Pixel<16>
+{
+  static const uint8_t depth   = 16;
+  static const uint8_t bytes   = 2;
+  static const uint8_t mpwctr  = RA8876_REG_MPWCTR_DEPTH_16BPP;
+  static const uint8_t awColor = RA8876_REG_AW_COLOR_DEPTH_16BPP;
+  static const uint8_t bteColr = RA8876_REG_BTE_S0_DEPTH_16BPP | RA8876_REG_BTE_S1_DEPTH_16BPP | RA8876_REG_BTE_DEST_DEPTH_16BPP;
+
+  // RGB565, low byte first; converted in chunks by the bulk converter
+  static void pack(const Color *src, uint8_t *dst, size_t cnt)
+  {
+    uint16_t p[16];
+
+    while (cnt)
+    {
+      size_t n = (cnt > 16) ? 16 : cnt;
+      Color::toRGB565(src, p, n);
+      for (size_t i = 0; i < n; i++)
+      {
+        *dst++ =  p[i]       & 0xff;
+        *dst++ = (p[i] >> 8) & 0xff;
+      }
+      src += n;
+      cnt -= n;
+    }
+  }
+
+  // the colour the display shows for c
+  static Color nearest(Color c)
+  {
+    return Color(ra8876Channel(c.r, 5), ra8876Channel(c.g, 6), ra8876Channel(c.b, 5));
+  }
+};
+
+template <>
+struct RA8876Pixel<24>
+{
+  static const uint8_t depth   = 24;
+  static const uint8_t bytes   = 3;
+  static const uint8_t mpwctr  = RA8876_REG_MPWCTR_DEPTH_24BPP;
+  static const uint8_t awColor = RA8876_REG_AW_COLOR_DEPTH_24BPP;
+  static const uint8_t bteColr = RA8876_REG_BTE_S0_DEPTH_24BPP | RA8876_REG_BTE_S1_DEPTH_24BPP | RA8876_REG_BTE_DEST_DEPTH_24BPP;
+
+  // BGR888
+  static void pack(const Color *src, uint8_t *dst, size_t cnt)
+  {
+    while (cnt--)
+    {
+      *dst++ = src->b;
+      *dst++ = src->g;
+      *dst++ = src->r;
+      src++;
+    }
+  }
+
+  static Color nearest(Color c)
+  {
+    return c;
+  }
+};
+
+typedef RA8876Pixel<RA8876_COLOR_DEPTH> RA8876PixelFormat;
+
 class RA8876 : public Print
 {
 private:
   int                m_csPin;
   int                m_resetPin;
+  int                m_intPin;         // INT output of the controller (-1 = polled)
 
   int                m_width;
   int                m_height;
+  int                m_canvasHeight;   // logical canvas height (based on RAM)
+  int                m_canvasWidth;
+  uint32_t           m_canvasAddr;
+  uint16_t           m_canvasStride;   // pixels per row
+  const RA8876Surface *m_canvas;       // NULL = the draw page
+  uint32_t           m_pageSize;       // bytes per display page
+  uint16_t           m_virtualWidth;   // display page image (at least the screen), main window stride
+  uint16_t           m_virtualHeight;
+  uint16_t           m_scrollX;        // main window position within the page
+  uint16_t           m_scrollY;
+  uint8_t            m_pages;          // display pages in use (1, or 2 when double buffered)
+  uint8_t            m_drawPage;       // page the canvas points at
+  uint8_t            m_showPage;       // page the main window shows
   uint8_t            m_depth;
   uint8_t            m_bpp;
 
-  uint32_t           m_oscClock;       // OSC clock (external crystal) frequency in kHz
+  RA8876Rect         m_clip[RA8876_CLIP_DEPTH];   // m_clip[m_clipDepth - 1] is in effect
+  uint8_t            m_clipDepth;
+
+  uint32_t           m_ramTop;         // display pages end here, surfaces follow
+  RA8876Surface      m_surfaces[RA8876_SURFACES];
+  RA8876Surface     *m_patterns;       // pattern slots, each a tile wide image
+  uint8_t            m_patternSize[RA8876_PATTERN_SLOTS];   // 0 = slot not loaded
+
+  RA8876Surface     *m_textCache;      // text cache image, a slot per row of strings
+  RA8876TextCacheSlot  m_cache[RA8876_TEXT_CACHE_SLOTS];
+  uint32_t           m_cacheTick;
+  RA8876TextCacheStats m_cacheStats;
 
-  RA8876PllParams    m_memPll;        // MCLK (memory) PLL parameters
-  RA8876PllParams    m_corePll;       // CCLK (core) PLL parameters
-  RA8876PllParams    m_scanPll;       // SCLK (LCD panel scan) PLL parameters
+  RA8876Pip          m_pip[2];         // picture-in-picture windows (RA8876PipWindow)
+
+  const RA8876Asset *m_assets;         // manifest of the serial flash
+  uint16_t           m_assetCount;
+  uint8_t            m_flashCtrl;      // SFL_CTRL for DMA
+  uint8_t            m_flashDivisor;
+
+  Color              m_palette[RA8876_PALETTE_SIZE];    // nearest device colours
+  uint8_t            m_paletteLut[RA8876_PALETTE_SIZE * RA8876PixelFormat::bytes];   // packed pixels
+  uint16_t           m_paletteSize;
+
+  const RA8876Clocks        *m_clocks;        // PLL parameters (solved at compile time)
+  const RA8876DisplayTiming *m_timing;        // display timing register values
 
   SPISettings        m_spiSettings;
-  RA8876RamInfo     *m_ramInfo;
-  RA8876DisplayInfo *m_displayInfo;
+  uint8_t            m_spiDepth;       // nested transaction depth
+  uint8_t            m_spiCmd;         // last register selected by a command write
+  uint8_t            m_txBuf[RA8876_SPI_BUFFER_SIZE];
+  size_t             m_txLen;
+  RA8876SpiStats     m_spiStats;
+
+  uint8_t            m_shadow[256];    // shadow copy of driver owned registers
+  uint8_t            m_shadowValid[32];
+  const RA8876RamInfo       *m_ramInfo;
+  const RA8876DisplayInfo   *m_displayInfo;
 
   Color              m_textColor;
   int                m_textScaleX;
   int                m_textScaleY;
+  uint16_t           m_textCursorX;    // tracked in software, never read back
+  uint16_t           m_textCursorY;
+
+  uint32_t           m_waitTimeout[RA8876_WAIT_COUNT];               // us
+  uint32_t           m_vblankAt;       // micros() at the last vertical sync seen
+  bool               m_vblankValid;    //   (false until the first one)
+  uint32_t           m_frameAt;        // m_vblankAt of the current frame
+  uint32_t           m_frameBytes;     // SPI byte count when the current frame started
+  uint32_t           m_frameBudget;    // SPI bytes per frame (0 = unlimited)
+  RA8876FrameStats   m_frameStats;
+  uint32_t           m_waitHistogram[RA8876_WAIT_COUNT][RA8876_WAIT_BUCKETS];
 
   RA8876FontSize     m_fontSize;
   RA8876FontFlags    m_fontFlags;
+  const uint16_t    *m_fontTable;      // code points of font bytes 0xA0 .. 0xFF (NULL = Latin 1)
+  char               m_replacement;    // drawn for code points the font lacks
+  uint32_t           m_utf8Char;       // write(): UTF-8 sequence being decoded
+  uint8_t            m_utf8Need;       //          continuation bytes still to come
+  bool               m_textRun;        // inside beginText() .. endText()
+
+  bool               m_async;          // engine commands are queued, not waited on
+  bool               m_engineBusy;     // a command was issued and may still be running
+  RA8876Command      m_queue[RA8876_QUEUE_SIZE];
+  uint8_t            m_queueHead;
+  uint8_t            m_queueCount;
+
+  volatile bool      m_intPending;     // set by the ISR on engine completion
+  RA8876Callback     m_intCallback;
+  static RA8876     *m_intInstance;
+
+  // interrupt
+  static void        _isr();
 
   // SPI
+  void               _spiBegin();
+  void               _spiEnd();
+  void               _spiWrite(uint8_t type, uint8_t x);
+  void               _spiStreamBegin();
+  void               _spiStreamWrite(uint8_t x);
+  void               _spiStreamWrite(const uint8_t *buf, size_t sz);
+  void               _spiStreamSend();
+  void               _spiStreamEnd();
   void               _spiCmdWrite(uint8_t x);
   void               _spiDatWrite(uint8_t x);
   uint8_t            _spiDatRead();
@@ -660,81 +1575,245 @@ private:
   void               regWrite16(uint8_t reg, uint16_t x);
   void               regWrite32(uint8_t reg, uint32_t x);
   uint8_t            regRead(uint8_t reg);
+  uint8_t            regReadRaw(uint8_t reg);
+
+  // shadow register cache
+  bool               shadowed(uint8_t reg);
+  void               shadowInvalidate();
 
   // reset functionality
   void               hardReset();
-  void               softReset();
+  RA8876Error        softReset();
 
   // status waitUntilxxxx
-  bool               waitUntilEmptyFifoWrite();
-  bool               waitUntilEmptyFifoRead();
-  bool               waitUntilFullFifoWrite();
-  bool               waitUntilFullFifoRead();
-  bool               waitUntilModeNormal();
-  bool               waitUntilMemoryReady();
-  bool               waitUntilStatusIdle();
+  RA8876Error        waitUntil(RA8876WaitCondition cond, uint8_t mask, uint8_t value);
+  RA8876Error        waitUntilEmptyFifoWrite();
+  RA8876Error        waitUntilEmptyFifoRead();
+  RA8876Error        waitUntilFullFifoWrite();
+  RA8876Error        waitUntilNotFullFifoWrite();
+  RA8876Error        waitUntilFullFifoRead();
+  RA8876Error        waitUntilModeNormal();
+  RA8876Error        waitUntilMemoryReady();
+  RA8876Error        waitUntilStatusIdle();
+  RA8876Error        waitUntilEngineIdle();
+  uint8_t            waitRead(RA8876WaitCondition cond);
+  void               waitRecord(RA8876WaitCondition cond, RA8876Error err, uint32_t elapsed);
 
   // initialization
-  bool               calcPllParams(uint32_t targetFreq, int kMax, RA8876PllParams *pll);
-  bool               calcClocks();
   bool               initPLL();
-  bool               initMemory(RA8876RamInfo *info);
+  bool               initMemory(const RA8876RamInfo *info);
   bool               initDisplay();
+  void               scanTiming(uint32_t *hTotal, uint32_t *vTotal, uint32_t *hBlank, uint32_t *vBlank);
 
   // chip mode
-  void               setTextMode();
-  void               setGraphicsMode();
+  RA8876Error        setTextMode();
+  RA8876Error        setGraphicsMode();
 
   // font
   uint8_t            getFontEncoding(RA8876FontEncoding enc);
+  int                utf8Decode(uint8_t b, uint32_t *cp, uint8_t *need);
+  RA8876Error        textWrite(const char *buf, size_t sz);
+  RA8876Error        textWrite16(const uint16_t *buf, size_t sz);
+  void               textAdvance(uint16_t w);
+
+  // display pages
+  void               setCanvasPage(uint8_t page);
+  void               applyCanvas();
+
+  // surfaces
+  RA8876Surface     *surfaceFit(uint16_t w, uint16_t h, uint8_t depth);
+  RA8876Error        surfaceChanged();
+
+  // picture-in-picture windows
+  void               pipSelect(RA8876PipWindow pip);
+
+  // active window
+  void               setActiveWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+  RA8876Error        beginRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+  RA8876Error        beginRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t cx, uint16_t cy);   // cursor inside the rect
+  RA8876Error        endRect();
+
+  // clipping
+  void               applyClip();
+  bool               clipRect(uint16_t *x, uint16_t *y, uint16_t *w, uint16_t *h);
+  bool               clipEmpty();
 
   // low-level drawing operations
-  void               drawTwoPointShape(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color, uint8_t reg, uint8_t cmd);                             // drawLine, drawRect, fillRect
-  void               drawThreePointShape(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, Color color, uint8_t reg, uint8_t cmd); // drawTriangle, fillTriangle
-  void               drawEllipseShape(uint16_t x, uint16_t y, uint16_t xrad, uint16_t yrad, Color color, uint8_t reg, uint8_t cmd);                            // drawCircle, fillCircle
+  RA8876Error        drawTwoPointShape(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color, uint8_t reg, uint8_t cmd);                             // drawLine, drawRect, fillRect
+  RA8876Error        drawThreePointShape(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, Color color, uint8_t reg, uint8_t cmd); // drawTriangle, fillTriangle
+  RA8876Error        drawEllipseShape(uint16_t x, uint16_t y, uint16_t xrad, uint16_t yrad, Color color, uint8_t reg, uint8_t cmd);                            // drawCircle, fillCircle
+
+  // text cache
+  uint32_t           cacheHash(const char *str, size_t len);
+  RA8876Error        cacheRender(int slot, const char *str, size_t len);
+
+  // colour expansion
+  RA8876Error        expandBitmap(int32_t x, int32_t y, uint16_t w, uint16_t h, const uint8_t *bits, Color fg, Color bg, bool transparent);
+
+  // indexed colour
+  void               paletteLookup(const uint8_t *index, uint8_t *dst, size_t cnt);
+
+  // sprite decoding
+  RA8876Error        spritePixels(RA8876SpriteStream *s, const uint8_t *index, uint32_t n, bool run);
+  RA8876Error        spriteWrite(RA8876SpriteStream *s, Color color);
+  RA8876Error        spriteBreak(RA8876SpriteStream *s);
+  RA8876Error        spriteClose(RA8876SpriteStream *s);
+
+  // command queue
+  RA8876Error        submit(const RA8876Command &c);
+  void               execute(const RA8876Command &c);
+  void               triggerCore(uint8_t reg, uint8_t x);
 
 public:
-  RA8876(int csPin, int resetPin = 0);
+  RA8876(int csPin, int resetPin = 0, int intPin = -1);
 
   // initialization
   bool               init();
   void               colorBarTest(bool enabled);
 
+  // SPI bus statistics
+  RA8876SpiStats     getSpiStats();
+  void               resetSpiStats();
+
+  // shadow register cache
+  int                verifyShadow();
+
+  // status wait tuning and statistics
+  void               setWaitTimeout(RA8876WaitCondition cond, uint32_t us);
+  const uint32_t    *getWaitHistogram(RA8876WaitCondition cond);
+  void               resetWaitHistogram();
+
+  // asynchronous command queue
+  RA8876Error        setAsync(bool enabled);
+  RA8876Error        poll();
+  RA8876Error        flush();
+  uint8_t            getPendingCount();
+  void               setCompletionCallback(RA8876Callback cb);
+
   // display information
   uint16_t           getDisplayWidth();
   uint16_t           getDisplayHeight();
-  
+
+  // vertical blank and frame pacing
+  uint32_t           getFrameTime();        // us per refresh
+  uint32_t           getBlankTime();        // us from the last visible pixel to the first one of the next frame
+  RA8876Error        waitForVBlank();
+  uint32_t           getBlankTimeLeft();
+  void               setFrameBudget(uint32_t bytes);   // 0 = unlimited
+  RA8876Error        beginFrame();
+  uint32_t           getFrameBytesLeft();
+  RA8876FrameStats   getFrameStats();
+  void               resetFrameStats();
+
+  // virtual canvas and hardware scrolling
+  RA8876Error        setVirtualSize(uint16_t w, uint16_t h);
+  uint16_t           getVirtualWidth();
+  uint16_t           getVirtualHeight();
+  void               scrollTo(uint16_t x, uint16_t y);
+  uint16_t           getScrollX();
+  uint16_t           getScrollY();
+
+  // double buffering
+  RA8876Error        setDoubleBuffer(bool enabled);
+  RA8876Error        present(bool copy = false);
+
+  // off-screen surfaces
+  const RA8876Surface *allocSurface(uint16_t w, uint16_t h, uint8_t depth = RA8876_COLOR_DEPTH);
+  RA8876Error        freeSurface(const RA8876Surface *surface);
+  RA8876SurfaceStats getSurfaceStats();
+  RA8876Error        setCanvas(const RA8876Surface *surface);   // NULL = the display
+
+  // serial flash assets
+  void               setAssetManifest(const RA8876Asset *assets, uint16_t count);
+  RA8876Error        setAssetFlash(uint8_t flash, uint8_t divisor = RA8876_FLASH_DIVISOR, bool addr32 = false);
+  const RA8876Asset *findAsset(const char *name);
+  RA8876Error        loadAsset(const char *name, uint16_t x, uint16_t y);
+  RA8876Error        loadAsset(const RA8876Asset *asset, uint16_t x, uint16_t y);
+  RA8876Error        loadAsset(const RA8876Asset *asset, uint16_t sx, uint16_t sy, uint16_t x, uint16_t y, uint16_t w, uint16_t h);   // part of a sheet
+  const RA8876Surface *loadAssetSurface(const char *name);
+
+  // picture-in-picture windows
+  RA8876Error        setPip(RA8876PipWindow pip, const RA8876Surface *surface, uint16_t x, uint16_t y, uint16_t w = 0, uint16_t h = 0);
+  RA8876Error        movePip(RA8876PipWindow pip, uint16_t x, uint16_t y);
+  RA8876Error        scrollPip(RA8876PipWindow pip, uint16_t sx, uint16_t sy);
+  RA8876Error        showPip(RA8876PipWindow pip, bool visible);
+  RA8876Pip          getPip(RA8876PipWindow pip);
+
+  // clip regions
+  RA8876Error        pushClip(RA8876Rect r);
+  RA8876Error        popClip();
+  RA8876Rect         getClip();
+
+  // indexed colour
+  RA8876Error        setPalette(const Color *colors, uint16_t count);
+  Color              paletteColor(uint8_t index);
+  RA8876Error        writeRectIndexed(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *index);
+
   // drawing
-  void               clearScreen(Color color);
+  RA8876Error        clearScreen(Color color);
   void               putPixel(uint16_t x, uint16_t y, Color color);
   void               putPixels(uint16_t x, uint16_t y, Color *color, size_t cnt);
-  void               drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color);
-  void               drawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color);
-  void               fillRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color);
-  void               drawTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, Color color);
-  void               fillTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, Color color);
-  void               drawCircle(uint16_t x, uint16_t y, uint16_t radius, Color color);
-  void               fillCircle(uint16_t x, uint16_t y, uint16_t radius, Color color);
-  void               drawEllipse(uint16_t x, uint16_t y, uint16_t x_radius, uint16_t y_radius, Color color);
-  void               fillEllipse(uint16_t x, uint16_t y, uint16_t x_radius, uint16_t y_radius, Color color);
+  RA8876Error        writeRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *rgb565);
+  RA8876Error        writeRect8(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *rgb332);
+  RA8876Error        writeRect24(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *bgr888);
+  RA8876Error        drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color);
+  RA8876Error        drawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color);
+  RA8876Error        fillRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, Color color);
+  RA8876Error        drawTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, Color color);
+  RA8876Error        fillTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, Color color);
+  RA8876Error        drawCircle(uint16_t x, uint16_t y, uint16_t radius, Color color);
+  RA8876Error        fillCircle(uint16_t x, uint16_t y, uint16_t radius, Color color);
+  RA8876Error        drawEllipse(uint16_t x, uint16_t y, uint16_t x_radius, uint16_t y_radius, Color color);
+  RA8876Error        fillEllipse(uint16_t x, uint16_t y, uint16_t x_radius, uint16_t y_radius, Color color);
 
   // bte engine
-  void               bteMemoryCopy(uint16_t sx, uint16_t sy, uint16_t dx, uint16_t dy, uint16_t w, uint16_t h);
+  RA8876Error        bteMemoryCopy(uint16_t sx, uint16_t sy, uint16_t dx, uint16_t dy, uint16_t w, uint16_t h);
+  RA8876Error        bteMemoryCopy(const RA8876Surface *src, uint16_t sx, uint16_t sy, uint16_t dx, uint16_t dy, uint16_t w, uint16_t h);
+  RA8876Error        bteBlit(const RA8876Surface *src, uint16_t sx, uint16_t sy, uint16_t dx, uint16_t dy, uint16_t w, uint16_t h, const RA8876BlitOp &op);
+  RA8876Error        bteSolidFill(uint16_t x, uint16_t y, uint16_t w, uint16_t h, Color color);
+  RA8876Error        setPattern(uint8_t slot, RA8876PatternSize size, const Color *pixels);
+  RA8876Error        btePatternFill(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t slot);
+
+  // 1bpp bitmaps (msb first, rows padded to a byte) expanded on the chip
+  RA8876Error        drawBitmap1bpp(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *bits, Color fg, Color bg);
+  RA8876Error        drawBitmap1bpp(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *bits, Color fg);   // 0 bits transparent
+
+  // proportional bitmap fonts
+  RA8876Error        drawGlyphs(uint16_t x, uint16_t y, const RA8876BitmapFont *font, const char *str, Color color);
+  uint16_t           getGlyphsWidth(const RA8876BitmapFont *font, const char *str);
+
+  // compressed palette images
+  RA8876Error        drawSprite(uint16_t x, uint16_t y, const RA8876Sprite *sprite);
 
   // font
   void               setFont(RA8876FontSize sz, RA8876FontEncoding enc = RA8876_FONT_ENCODING_8859_1);
+  void               setReplacementChar(char c);
+  size_t             transcodeUtf8(const char *src, char *dst, size_t sz);   // UTF-8 to the font encoding
   void               setTextCursor(uint16_t x, uint16_t y);
   uint16_t           getTextCursorX();
   uint16_t           getTextCursorY();
   uint16_t           getTextWidth();
+  uint16_t           getTextWidth(const char *str);
   uint16_t           getTextHeight();
   void               setTextColor(Color color);
   void               setTextScale(int scale);
   void               setTextScale(int xScale, int yScale);
-  void               putChar(char c);
-  void               putChars(const char *buf, size_t sz);
-  void               putChar16(uint16_t c);
-  void               putChars16(const uint16_t *buf, size_t sz);
+  RA8876Error        putChar(char c);
+  RA8876Error        putChars(const char *buf, size_t sz);
+  RA8876Error        putChar16(uint16_t c);
+  RA8876Error        putChars16(const uint16_t *buf, size_t sz);
+
+  // text runs: stay in text mode across many strings (no other drawing in between)
+  RA8876Error        beginText();
+  RA8876Error        drawTextAt(uint16_t x, uint16_t y, Color color, const char *str);
+  RA8876Error        drawTextBox(uint16_t x, uint16_t y, uint16_t w, Color color, const char *str, RA8876TextAlign align = RA8876_TEXT_ALIGN_LEFT);
+  RA8876Error        endText();
+
+  // text cache
+  RA8876Error        drawCachedText(uint16_t x, uint16_t y, const char *str);
+  void               invalidateTextCache();
+  RA8876TextCacheStats getTextCacheStats();
+  void               resetTextCacheStats();
 
   // internal for print class
   virtual size_t     write(uint8_t c);
@@ -0,0 +1,115 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+// RA8876 :: HOST TESTS
+//--------------------------------------------------------------------------
+
+// the driver built against the RA8876 emulator (ra8876-host.h): every test
+// program includes this file first, draws through the public api and
+// checks the emulated screen, bus traffic and virtual time.
+//
+//   make -C test check
+
+#ifndef RA8876_CONFIG
+#define RA8876_CONFIG       RA8876_CONFIG_1280x720
+#endif
+#ifndef RA8876_COLOR_DEPTH
+#define RA8876_COLOR_DEPTH  16
+#endif
+#define RA8876_SPI_SPEED    1000000
+#define RA8876_CS           10
+#define RA8876_RESET        2
+
+#include "ra8876-host.h"
+#include "ra8876-config.h"
+#include "ra8876-implementation.h"
+
+//--------------------------------------------------------------------------
+// checks
+
+static int testChecks   = 0;
+static int testFailures = 0;
+
+#define CHECK(cond)       testCheck((cond), #cond, __FILE__, __LINE__)
+
+static inline bool
+testCheck(bool ok, const char *expr, const char *file, int line)
+{
+  testChecks++;
+  if (!ok)
+  {
+    testFailures++;
+    printf("%s:%d: check failed: %s\n", file, line, expr);
+  }
+  return ok;
+}
+
+// exit status of the test program
+static inline int
+testDone(const char *name)
+{
+  printf("%s: %d checks, %d failed\n", name, testChecks, testFailures);
+  return (testFailures == 0) ? 0 : 1;
+}
+
+//--------------------------------------------------------------------------
+// screen helpers
+
+#define PIXEL(x, y)       ra8876Emulator.screenPixel(x, y)
+
+static inline uint32_t
+testRGB(Color c)
+{
+  return ((uint32_t)c.r << 16) | ((uint32_t)c.g << 8) | c.b;
+}
+
+// pixels that differ between two areas of the screen
+static inline int
+testCompare(int ax, int ay, int bx, int by, int w, int h)
+{
+  int bad = 0;
+  for (int y = 0; y < h; y++)
+    for (int x = 0; x < w; x++)
+      if (PIXEL(ax + x, ay + y) != PIXEL(bx + x, by + y)) bad++;
+  return bad;
+}
+
+//--------------------------------------------------------------------------
+// measurements
+
+struct TestCost
+{
+  uint32_t bytes;       // SPI bytes
+  uint32_t frames;      // chip-select frames
+  uint64_t us;          // virtual time
+};
+
+static uint64_t testStart;
+
+static inline void
+testBegin(RA8876 &tft)
+{
+  tft.resetSpiStats();
+  testStart = ra8876Emulator.now;
+}
+
+// ends a measurement once the chip is idle again
+static inline TestCost
+testEnd(RA8876 &tft, const char *label)
+{
+  TestCost c;
+
+  tft.flush();
+  c.bytes  = tft.getSpiStats().bytes;
+  c.frames = tft.getSpiStats().frames;
+  c.us     = (ra8876Emulator.now - testStart) / 1000;
+  if (label != NULL)
+    printf("  %-32s %8u bytes %6u frames %8llu us\n", label, c.bytes, c.frames, (unsigned long long)c.us);
+  return c;
+}
+
+//--------------------------------------------------------------------------
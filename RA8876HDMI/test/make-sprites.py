@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+#--------------------------------------------------------------------------
+# Copyright 2024, RIoT Secure AB
+#
+# @author Aaron Ardiri
+#--------------------------------------------------------------------------
+
+# fixtures for test-sprite: writes the test images as png files for
+# tools/ra8876-sprite.py and their pixels as a header the test draws the
+# reference from
+#
+#   make-sprites.py sprites sprites-ref.h
+
+import os
+import struct
+import sys
+import zlib
+
+CLEAR = (0, 0, 0, 0)
+
+#--------------------------------------------------------------------------
+# png encoding (8 bit rgba, no filtering)
+
+def chunk(ctype, data):
+  crc = zlib.crc32(ctype + data) & 0xffffffff
+  return struct.pack('>I', len(data)) + ctype + data + struct.pack('>I', crc)
+
+def write_png(path, width, height, pixels):
+  raw = bytearray()
+  for y in range(height):
+    raw.append(0)
+    for r, g, b, a in pixels[y * width:(y + 1) * width]: raw.extend((r, g, b, a))
+  with open(path, 'wb') as f:
+    f.write(b'\x89PNG\r\n\x1a\n')
+    f.write(chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 6, 0, 0, 0)))
+    f.write(chunk(b'IDAT', zlib.compress(bytes(raw))))
+    f.write(chunk(b'IEND', b''))
+
+#--------------------------------------------------------------------------
+# images
+
+# literal pixels around a transparent run and a colour run that both carry
+# on across the end of a row
+def span():
+  w, h = 40, 10
+  px   = [((x * 23) & 0xff, (y * 41) & 0xff, ((x + y) * 11) & 0xff, 255) for y in range(h) for x in range(w)]
+  for i in range(2 * w + 30, 6 * w + 10): px[i] = CLEAR
+  for i in range(7 * w + 35, 8 * w + 5):  px[i] = (250, 20, 20, 255)
+  return w, h, px
+
+# runs longer than 128 pixels: the 16 bit count form, opaque and
+# transparent, and one that ends part way into a row
+def runs():
+  w, h = 300, 4
+  px   = [(20, 40, 250, 255)] * (2 * w)
+  px  += [(30, 200, 90, 255)] * 150 + [CLEAR] * 150
+  px  += [CLEAR] * 100 + [(255, 255, 255, 255)] * 200
+  return w, h, px
+
+# short runs, literals, alpha on both sides of the threshold and colours
+# the display can not tell apart
+def mixed():
+  w, h = 64, 32
+  px   = []
+  for y in range(h):
+    for x in range(w):
+      if   (x // 4 + y // 4) % 5 == 0:  c = CLEAR
+      elif (x // 4 + y // 4) % 5 == 1:  c = (200, 100, 50, 100)          # alpha below 128
+      elif y < 8:                       c = ((x * 37) & 0xff, (x * 53) & 0xff, (x * 97) & 0xff, 255)
+      elif y < 16:                      c = (x & 0xf8, 128, 0, 200)         # runs of 8
+      else:                             c = (255, 255 - (x & 1), 0, 255)    # one colour at 16 bpp
+      px.append(c)
+  return w, h, px
+
+IMAGES = [ ('span', span), ('runs', runs), ('mixed', mixed) ]
+
+#--------------------------------------------------------------------------
+# main
+
+def main():
+  if len(sys.argv) != 3:
+    sys.stderr.write('usage: make-sprites.py <png directory> <reference header>\n')
+    return 1
+
+  outdir, header = sys.argv[1:]
+  os.makedirs(outdir, exist_ok = True)
+
+  text  = '//--------------------------------------------------------------------------\n'
+  text += '// generated by make-sprites.py, do not edit\n'
+  text += '//--------------------------------------------------------------------------\n\n'
+  for name, image in IMAGES:
+    w, h, px = image()
+    write_png(os.path.join(outdir, name + '.png'), w, h, px)
+
+    # (r, g, b, a) per pixel
+    text += 'const uint8_t %s_rgba[%d] =\n{\n' % (name, w * h * 4)
+    for i in range(0, len(px), 4):
+      text += '  ' + ', '.join('%d, %d, %d, %d' % p for p in px[i:i + 4]) + ',\n'
+    text += '};\n\n'
+  text += '//--------------------------------------------------------------------------\n'
+
+  with open(header, 'w') as f:
+    f.write(text)
+  return 0
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,239 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// serial flash assets: images in the emulated flash, copied by the DMA
+// onto the canvas (whole, part of a sheet, clipped) and into a surface of
+// their own, land like their pixels written through the memory port; an
+// unknown name or an image of another depth is refused and a surface is
+// not left behind when the copy fails
+
+#include "host-test.h"
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+#define SHEET_W             64
+#define SHEET_H             32
+#define ICON_W              20
+#define ICON_H              10
+
+static const RA8876Asset manifest[] =
+{
+  { "sheet", 0x001000, SHEET_W, SHEET_H, RA8876_COLOR_DEPTH },
+  { "icon",  0x010000, ICON_W,  ICON_H,  RA8876_COLOR_DEPTH },
+  { "deep",  0x020000, ICON_W,  ICON_H,  (RA8876_COLOR_DEPTH == 24) ? 16 : 24 },
+};
+
+static Color
+sheetPixel(int x, int y)
+{
+  return Color((x * 4) & 0xff, (y * 8) & 0xff, ((x + y) * 3) & 0xff);
+}
+
+static Color
+iconPixel(int x, int y)
+{
+  return ((x / 5 + y / 5) & 1) ? Color::Yellow : Color(0, 0, 128);
+}
+
+// an image into the flash, in the pixel format of the driver
+static void
+flashImage(const RA8876Asset *a, Color (*pixel)(int, int))
+{
+  Color    c;
+  uint32_t addr;
+
+  if (ra8876Emulator.flash[0].size() < (a->offset + (uint32_t)a->width * a->height * RA8876PixelFormat::bytes))
+    ra8876Emulator.flash[0].resize(a->offset + (uint32_t)a->width * a->height * RA8876PixelFormat::bytes, 0xff);
+
+  addr = a->offset;
+  for (int y = 0; y < a->height; y++)
+    for (int x = 0; x < a->width; x++)
+    {
+      c = pixel(x, y);
+      RA8876PixelFormat::pack(&c, &ra8876Emulator.flash[0][addr], 1);
+      addr += RA8876PixelFormat::bytes;
+    }
+}
+
+// w x h of the image from sx, sy through the memory port
+static void
+reference(uint16_t x, uint16_t y, Color (*pixel)(int, int), uint16_t sx, uint16_t sy, uint16_t w, uint16_t h)
+{
+  Color row[SHEET_W];
+
+  for (int j = 0; j < h; j++)
+  {
+    for (int i = 0; i < w; i++) row[i] = pixel(sx + i, sy + j);
+    tft.putPixels(x, y + j, row, w);
+  }
+}
+
+//--------------------------------------------------------------------------
+// onto the canvas
+
+static void
+testCanvas()
+{
+  const RA8876Asset *sheet;
+  RA8876Rect         box = { 420, 110, 30, 12 };
+  TestCost           c;
+
+  tft.clearScreen(Color::Black);
+
+  sheet = tft.findAsset("sheet");
+  CHECK(sheet == &manifest[0]);
+
+  // the whole image: the DMA moves it, the host bus carries registers only
+  testBegin(tft);
+  CHECK(tft.loadAsset("sheet", 100, 100) == RA8876_OK);
+  c = testEnd(tft, "loadAsset 64x32");
+  reference(100, 300, sheetPixel, 0, 0, SHEET_W, SHEET_H);
+  tft.flush();
+  CHECK(testCompare(100, 100, 100, 300, SHEET_W, SHEET_H) == 0);
+  CHECK(c.bytes < (uint32_t)SHEET_W * SHEET_H * RA8876PixelFormat::bytes / 10);
+
+  // an icon out of the sheet
+  CHECK(tft.loadAsset(sheet, 16, 8, 200, 100, 24, 12) == RA8876_OK);
+  reference(200, 300, sheetPixel, 16, 8, 24, 12);
+  tft.flush();
+  CHECK(testCompare(200, 100, 200, 300, 24, 12) == 0);
+  CHECK(PIXEL(200 + 24, 100) == 0);
+  CHECK(PIXEL(200, 100 + 12) == 0);
+
+  // clipped by a clip region: the source start moves along
+  CHECK(tft.pushClip(box) == RA8876_OK);
+  CHECK(tft.loadAsset("sheet", 400, 100) == RA8876_OK);
+  CHECK(tft.popClip() == RA8876_OK);
+  reference(box.x, 300, sheetPixel, box.x - 400, box.y - 100, box.w, box.h);
+  tft.flush();
+  CHECK(testCompare(box.x, box.y, box.x, 300, box.w, box.h) == 0);
+  CHECK(PIXEL(box.x - 1, box.y) == 0);
+  CHECK(PIXEL(box.x + box.w, box.y) == 0);
+  CHECK(PIXEL(box.x, box.y - 1) == 0);
+  CHECK(PIXEL(box.x, box.y + box.h) == 0);
+
+  // and by the screen edge, nothing wraps onto the next row
+  CHECK(tft.loadAsset("sheet", 1260, 100) == RA8876_OK);
+  reference(1000, 300, sheetPixel, 0, 0, 20, SHEET_H);
+  tft.flush();
+  CHECK(testCompare(1260, 100, 1000, 300, 20, SHEET_H) == 0);
+  CHECK(PIXEL(0, 101) == 0);
+
+  // async: queued like the bte
+  CHECK(tft.setAsync(true) == RA8876_OK);
+  CHECK(tft.loadAsset("icon", 100, 200) == RA8876_OK);
+  CHECK(tft.loadAsset("icon", 130, 200) == RA8876_OK);
+  CHECK(tft.setAsync(false) == RA8876_OK);
+  reference(100, 400, iconPixel, 0, 0, ICON_W, ICON_H);
+  reference(130, 400, iconPixel, 0, 0, ICON_W, ICON_H);
+  tft.flush();
+  CHECK(testCompare(100, 200, 100, 400, 50, ICON_H) == 0);
+}
+
+//--------------------------------------------------------------------------
+// into a surface
+
+static void
+testSurface()
+{
+  const RA8876Surface *s;
+  RA8876SurfaceStats   before, after;
+
+  tft.clearScreen(Color::Black);
+  before = tft.getSurfaceStats();
+
+  s = tft.loadAssetSurface("icon");
+  CHECK(s != NULL);
+  if (s == NULL) return;
+  CHECK((s->width == ICON_W) && (s->height == ICON_H) && (s->depth == RA8876_COLOR_DEPTH));
+  CHECK(tft.getSurfaceStats().surfaces == before.surfaces + 1);
+
+  // the copy went to the surface only, the canvas is back on the page
+  CHECK(testCompare(0, 0, 0, 600, 200, 100) == 0);
+  CHECK(tft.verifyShadow() == 0);
+  tft.fillRectangle(10, 10, 19, 19, Color::White);
+  tft.flush();
+  CHECK(PIXEL(10, 10) == testRGB(Color::White));
+
+  // the surface holds the image
+  CHECK(tft.bteMemoryCopy(s, 0, 0, 300, 100, ICON_W, ICON_H) == RA8876_OK);
+  reference(300, 300, iconPixel, 0, 0, ICON_W, ICON_H);
+  tft.flush();
+  CHECK(testCompare(300, 100, 300, 300, ICON_W, ICON_H) == 0);
+
+  CHECK(tft.freeSurface(s) == RA8876_OK);
+  after = tft.getSurfaceStats();
+  CHECK((after.surfaces == before.surfaces) && (after.used == before.used));
+}
+
+//--------------------------------------------------------------------------
+// refused
+
+static void
+testErrors()
+{
+  RA8876SurfaceStats before, after;
+
+  before = tft.getSurfaceStats();
+
+  // not in the manifest
+  CHECK(tft.findAsset("nope") == NULL);
+  CHECK(tft.findAsset(NULL) == NULL);
+  CHECK(tft.loadAsset("nope", 0, 0) == RA8876_ERROR_PARAMETER);
+  CHECK(tft.loadAssetSurface("nope") == NULL);
+
+  // stored at another depth: a byte for byte copy would be garbage
+  CHECK(tft.findAsset("deep") == &manifest[2]);
+  CHECK(tft.loadAsset("deep", 0, 0) == RA8876_ERROR_PARAMETER);
+  CHECK(tft.loadAssetSurface("deep") == NULL);
+
+  // a block outside the image
+  CHECK(tft.loadAsset(&manifest[0], 60, 0, 0, 0, 8, 8) == RA8876_ERROR_PARAMETER);
+  CHECK(tft.loadAsset(&manifest[0], 0, 30, 0, 0, 8, 8) == RA8876_ERROR_PARAMETER);
+
+  after = tft.getSurfaceStats();
+  CHECK((after.surfaces == before.surfaces) && (after.used == before.used));
+
+  // a copy that does not finish in time: the surface is handed back
+  CHECK(tft.setAssetFlash(0, 255) == RA8876_OK);
+  tft.setWaitTimeout(RA8876_WAIT_STATUS_IDLE, 1000);
+  CHECK(tft.loadAssetSurface("sheet") == NULL);
+  tft.setWaitTimeout(RA8876_WAIT_STATUS_IDLE, 250000);
+  CHECK(tft.setAssetFlash(0) == RA8876_OK);
+
+  after = tft.getSurfaceStats();
+  CHECK((after.surfaces == before.surfaces) && (after.used == before.used));
+
+  // and the driver carries on
+  tft.clearScreen(Color::Black);
+  CHECK(tft.loadAsset("icon", 100, 100) == RA8876_OK);
+  reference(100, 300, iconPixel, 0, 0, ICON_W, ICON_H);
+  tft.flush();
+  CHECK(testCompare(100, 100, 100, 300, ICON_W, ICON_H) == 0);
+  CHECK(tft.verifyShadow() == 0);
+}
+
+int
+main()
+{
+  flashImage(&manifest[0], sheetPixel);
+  flashImage(&manifest[1], iconPixel);
+
+  CHECK(tft.init());
+  tft.setAssetManifest(manifest, sizeof(manifest) / sizeof(manifest[0]));
+
+  printf("asset\n");
+
+  testCanvas();
+  testSurface();
+  testErrors();
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  return testDone("asset");
+}
+
+//--------------------------------------------------------------------------
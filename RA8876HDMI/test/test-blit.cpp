@@ -0,0 +1,275 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// bteBlit(): raster operations against the canvas, chroma key, opacity
+// over the canvas and over a constant colour land on the pixels worked
+// out on the host, in sync and async mode; the S1 and BTE_COLR state a
+// blit leaves behind does not change the copies and fills after it
+
+#include "host-test.h"
+
+#if RA8876_COLOR_DEPTH != 16
+#error "the expected pixels are worked out at 16bpp"
+#endif
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+#define SRC_W               32
+#define SRC_H               16
+
+// expected pixels are drawn this far below the blits
+#define REF_DY              360
+
+static const RA8876Surface *src;
+static const Color          key = Color(255, 0, 255);
+
+//--------------------------------------------------------------------------
+// pixels
+
+static uint16_t
+to565(Color c)
+{
+  return ((uint16_t)(c.r & 0xf8) << 8) | ((c.g & 0xfc) << 3) | (c.b >> 3);
+}
+
+// as the chip reads a pixel back: the high bits repeated into the low ones
+static Color
+from565(uint16_t v)
+{
+  uint8_t r = (v >> 8) & 0xf8, g = (v >> 3) & 0xfc, b = (v << 3) & 0xf8;
+  return Color(r | (r >> 5), g | (g >> 6), b | (b >> 5));
+}
+
+static Color
+srcPixel(int x, int y)
+{
+  if (((x / 4) + (y / 4)) % 3 == 0) return key;
+  return Color((x * 8) & 0xff, 255 - y * 16, (x * y) & 0xff);
+}
+
+static Color
+dstPixel(int x, int y)
+{
+  return Color(255 - x * 8, (y * 13) & 0xff, ((x ^ y) * 9) & 0xff);
+}
+
+static uint16_t
+rop(uint8_t code, uint16_t s, uint16_t d)
+{
+  switch (code)
+  {
+    case RA8876_ROP_BLACK:            return 0;
+    case RA8876_ROP_NOR:              return ~(s | d);
+    case RA8876_ROP_NOT_SRC_AND_DST:  return ~s & d;
+    case RA8876_ROP_NOT_SRC:          return ~s;
+    case RA8876_ROP_SRC_AND_NOT_DST:  return s & ~d;
+    case RA8876_ROP_NOT_DST:          return ~d;
+    case RA8876_ROP_XOR:              return s ^ d;
+    case RA8876_ROP_NAND:             return ~(s & d);
+    case RA8876_ROP_AND:              return s & d;
+    case RA8876_ROP_XNOR:             return ~(s ^ d);
+    case RA8876_ROP_DST:              return d;
+    case RA8876_ROP_NOT_SRC_OR_DST:   return ~s | d;
+    case RA8876_ROP_SRC:              return s;
+    case RA8876_ROP_SRC_OR_NOT_DST:   return s | ~d;
+    case RA8876_ROP_OR:               return s | d;
+    default:                          return 0xffff;
+  }
+}
+
+// S over D at the opacity the chip is given, in 32nds
+static uint16_t
+blend(uint8_t alpha, uint16_t s, uint16_t d)
+{
+  int   a  = ((uint16_t)alpha * RA8876_REG_APB_ALPHA_MAX + 127) / 255;
+  Color cs = from565(s), cd = from565(d);
+
+  return to565(Color((cs.r * a + cd.r * (32 - a)) / 32,
+                     (cs.g * a + cd.g * (32 - a)) / 32,
+                     (cs.b * a + cd.b * (32 - a)) / 32));
+}
+
+// what the blit of the whole source at (x, y) leaves on the screen
+static uint16_t
+expected(const RA8876BlitOp &op, int i, int j)
+{
+  uint16_t s = to565(srcPixel(i, j)), d = to565(dstPixel(i, j));
+
+  switch (op.mode)
+  {
+    case RA8876_BLIT_ROP:         return rop(op.rop, s, d);
+    case RA8876_BLIT_CHROMA:      return (s == to565(op.color)) ? d : s;
+    case RA8876_BLIT_BLEND:       return blend(op.alpha, s, d);
+    default:                      return blend(op.alpha, s, to565(op.color));
+  }
+}
+
+// the destination background, through the memory port
+static void
+background(uint16_t x, uint16_t y)
+{
+  Color row[SRC_W];
+
+  for (int j = 0; j < SRC_H; j++)
+  {
+    for (int i = 0; i < SRC_W; i++) row[i] = dstPixel(i, j);
+    tft.putPixels(x, y + j, row, SRC_W);
+  }
+}
+
+static void
+reference(uint16_t x, uint16_t y, const RA8876BlitOp &op)
+{
+  Color row[SRC_W];
+
+  for (int j = 0; j < SRC_H; j++)
+  {
+    for (int i = 0; i < SRC_W; i++) row[i] = from565(expected(op, i, j));
+    tft.putPixels(x, y + j, row, SRC_W);
+  }
+}
+
+// the source over the background at (x, y), the expected pixels under it
+static bool
+blit(uint16_t x, uint16_t y, const RA8876BlitOp &op)
+{
+  background(x, y);
+  if (tft.bteBlit(src, 0, 0, x, y, SRC_W, SRC_H, op) != RA8876_OK) return false;
+  reference(x, y + REF_DY, op);
+  tft.flush();
+
+  return testCompare(x, y, x, y + REF_DY, SRC_W, SRC_H) == 0;
+}
+
+static RA8876BlitOp
+blitOp(uint8_t mode, uint8_t rop, uint8_t alpha, Color color)
+{
+  RA8876BlitOp op;
+
+  op.mode  = mode;
+  op.rop   = rop;
+  op.alpha = alpha;
+  op.color = color;
+  return op;
+}
+
+//--------------------------------------------------------------------------
+// every mode
+
+static void
+testModes(uint16_t y)
+{
+  int x;
+
+  // all sixteen raster operations against the canvas
+  for (x = 0; x < 16; x++)
+    CHECK(blit(x * 40, y, blitOp(RA8876_BLIT_ROP, x, 0, Color::Black)));
+
+  // chroma key, opacity over the canvas and over a constant colour
+  CHECK(blit(  0, y + 40, blitOp(RA8876_BLIT_CHROMA,      0,   0, key)));
+  CHECK(blit( 40, y + 40, blitOp(RA8876_BLIT_BLEND,       0,   0, Color::Black)));
+  CHECK(blit( 80, y + 40, blitOp(RA8876_BLIT_BLEND,       0, 128, Color::Black)));
+  CHECK(blit(120, y + 40, blitOp(RA8876_BLIT_BLEND,       0, 255, Color::Black)));
+  CHECK(blit(160, y + 40, blitOp(RA8876_BLIT_BLEND_COLOR, 0,  64, Color(0, 128, 255))));
+  CHECK(blit(200, y + 40, blitOp(RA8876_BLIT_BLEND_COLOR, 0, 200, Color::White)));
+
+  // the canvas as the source: the background XOR'ed with itself
+  background(240, y + 40);
+  CHECK(tft.bteBlit(NULL, 240, y + 40, 240, y + 40, SRC_W, SRC_H, blitOp(RA8876_BLIT_ROP, RA8876_ROP_XOR, 0, Color::Black)) == RA8876_OK);
+  tft.flush();
+  CHECK((PIXEL(240, y + 40) == 0) && (PIXEL(240 + SRC_W - 1, y + 40 + SRC_H - 1) == 0));
+
+  // clipped at the screen edge: the source start moves along
+  background(1264, y + 40);
+  background(1264 - SRC_W, y + 40);
+  CHECK(tft.bteBlit(src, 0, 0, 1264, y + 40, SRC_W, SRC_H, blitOp(RA8876_BLIT_ROP, RA8876_ROP_XOR, 0, Color::Black)) == RA8876_OK);
+  reference(1264 - SRC_W, y + 40 + REF_DY, blitOp(RA8876_BLIT_ROP, RA8876_ROP_XOR, 0, Color::Black));
+  tft.flush();
+  CHECK(testCompare(1264, y + 40, 1264 - SRC_W, y + 40 + REF_DY, 16, SRC_H) == 0);
+}
+
+//--------------------------------------------------------------------------
+// what a blit leaves behind
+
+static void
+testLeftBehind(uint16_t y)
+{
+  RA8876BlitOp xorOp = blitOp(RA8876_BLIT_ROP, RA8876_ROP_XOR, 0, Color::Black);
+
+  // after a constant colour (S1 start address holds the colour, S1 depth
+  // set to constant): a copy, a fill and a raster operation on the canvas
+  CHECK(blit(0, y, blitOp(RA8876_BLIT_BLEND_COLOR, 0, 100, Color(200, 30, 90))));
+  CHECK(tft.bteMemoryCopy(src, 0, 0, 40, y, SRC_W, SRC_H) == RA8876_OK);
+  CHECK(tft.bteSolidFill(80, y, SRC_W, SRC_H, Color::Cyan) == RA8876_OK);
+  CHECK(blit(120, y, xorOp));
+  CHECK(blit(160, y, blitOp(RA8876_BLIT_BLEND, 0, 100, Color::Black)));
+
+  // after opacity: a raster operation does not blend
+  CHECK(blit(200, y, xorOp));
+
+  // after a chroma key: a plain copy copies the key colour too
+  CHECK(blit(240, y, blitOp(RA8876_BLIT_CHROMA, 0, 0, key)));
+  CHECK(tft.bteMemoryCopy(src, 0, 0, 280, y, SRC_W, SRC_H) == RA8876_OK);
+  tft.flush();
+
+  CHECK(PIXEL(40, y) == testRGB(key));
+  CHECK(PIXEL(280, y) == testRGB(key));
+  CHECK(PIXEL(40 + 4, y) == testRGB(from565(to565(srcPixel(4, 0)))));
+  CHECK(PIXEL(80, y) == testRGB(Color::Cyan));
+  CHECK(PIXEL(80 + SRC_W - 1, y + SRC_H - 1) == testRGB(Color::Cyan));
+  CHECK(testCompare(40, y, 280, y, SRC_W, SRC_H) == 0);
+
+  CHECK(tft.verifyShadow() == 0);
+}
+
+//--------------------------------------------------------------------------
+// refused
+
+static void
+testErrors()
+{
+  CHECK(tft.bteBlit(src, 0, 0, 0, 0, 8, 8, blitOp(RA8876_BLIT_BLEND_COLOR + 1, 0, 0, Color::Black)) == RA8876_ERROR_PARAMETER);
+  CHECK(tft.bteBlit(src, 0, 0, 0, 0, 8, 8, blitOp(RA8876_BLIT_ROP, RA8876_ROP_WHITE + 1, 0, Color::Black)) == RA8876_ERROR_PARAMETER);
+}
+
+int
+main()
+{
+  Color    row[SRC_W];
+
+  CHECK(tft.init());
+  tft.clearScreen(Color::Black);
+
+  printf("blit\n");
+
+  // the source image, drawn into its surface
+  src = tft.allocSurface(SRC_W, SRC_H);
+  CHECK(src != NULL);
+  if (src == NULL) return testDone("blit");
+  CHECK(tft.setCanvas(src) == RA8876_OK);
+  for (int j = 0; j < SRC_H; j++)
+  {
+    for (int i = 0; i < SRC_W; i++) row[i] = srcPixel(i, j);
+    tft.putPixels(0, j, row, SRC_W);
+  }
+  CHECK(tft.setCanvas(NULL) == RA8876_OK);
+
+  testModes(20);
+
+  CHECK(tft.setAsync(true) == RA8876_OK);
+  testModes(120);
+  testLeftBehind(220);
+  CHECK(tft.setAsync(false) == RA8876_OK);
+
+  testLeftBehind(260);
+  testErrors();
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  return testDone("blit");
+}
+
+//--------------------------------------------------------------------------
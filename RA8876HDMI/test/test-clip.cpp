@@ -0,0 +1,225 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// clip regions: nested regions are the intersection of the stack and are
+// the active window of the chip, popping the last one gives the whole
+// canvas back; an empty region sends no geometry at all, the stack is
+// refused past either end and a new line under a region starts at its
+// left edge
+
+#include "host-test.h"
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+// the whole canvas: the screen wide, as high as the memory above it
+static RA8876Rect canvas;
+
+static uint16_t reg16(uint8_t r) { return ra8876Emulator.reg[r] | ((uint16_t)ra8876Emulator.reg[r + 1] << 8); }
+
+static bool
+sameRect(RA8876Rect a, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+  return (a.x == x) && (a.y == y) && (a.w == w) && (a.h == h);
+}
+
+// the active window of the chip
+static bool
+window(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+  return (reg16(RA8876_REG_AWUL_X0) == x) && (reg16(RA8876_REG_AWUL_Y0) == y) &&
+         (reg16(RA8876_REG_AW_WTH0) == w) && (reg16(RA8876_REG_AW_HT0)  == h);
+}
+
+//--------------------------------------------------------------------------
+// nested regions
+
+static void
+testNested()
+{
+  RA8876Rect outer = { 100, 100, 400, 300 };
+  RA8876Rect inner = { 300, 200, 400, 300 };
+
+  tft.clearScreen(Color::Black);
+
+  CHECK(tft.pushClip(outer) == RA8876_OK);
+  CHECK(sameRect(tft.getClip(), 100, 100, 400, 300));
+  CHECK(window(100, 100, 400, 300));
+
+  // the inner region is cut down to what lies inside the outer one
+  CHECK(tft.pushClip(inner) == RA8876_OK);
+  CHECK(sameRect(tft.getClip(), 300, 200, 200, 200));
+  CHECK(window(300, 200, 200, 200));
+
+  tft.fillRectangle(0, 0, 1279, 719, Color::Red);
+  tft.flush();
+  CHECK(PIXEL(300, 200) == testRGB(Color::Red));
+  CHECK(PIXEL(499, 399) == testRGB(Color::Red));
+  CHECK(PIXEL(299, 200) == 0);
+  CHECK(PIXEL(300, 199) == 0);
+  CHECK(PIXEL(500, 300) == 0);
+  CHECK(PIXEL(300, 400) == 0);
+
+  // back to the outer region
+  CHECK(tft.popClip() == RA8876_OK);
+  CHECK(sameRect(tft.getClip(), 100, 100, 400, 300));
+  CHECK(window(100, 100, 400, 300));
+  tft.fillRectangle(0, 0, 1279, 719, Color::Green);
+  tft.flush();
+  CHECK(PIXEL(100, 100) == testRGB(Color::Green));
+  CHECK(PIXEL(499, 399) == testRGB(Color::Green));
+  CHECK(PIXEL(99, 100) == 0);
+  CHECK(PIXEL(500, 100) == 0);
+
+  // and to the whole canvas
+  CHECK(tft.popClip() == RA8876_OK);
+  CHECK(sameRect(tft.getClip(), 0, 0, canvas.w, canvas.h));
+  CHECK(window(0, 0, canvas.w, canvas.h));
+  tft.fillRectangle(0, 0, 1279, 719, Color::Blue);
+  tft.flush();
+  CHECK(PIXEL(0, 0) == testRGB(Color::Blue));
+  CHECK(PIXEL(1279, 719) == testRGB(Color::Blue));
+
+  CHECK(tft.verifyShadow() == 0);
+}
+
+//--------------------------------------------------------------------------
+// empty regions
+
+static void
+testEmpty(bool async)
+{
+  RA8876Rect a = { 100, 100, 10, 10 };
+  RA8876Rect b = { 500, 500, 10, 10 };
+  TestCost   cost;
+  Color      row[4] = { Color::Red, Color::Red, Color::Red, Color::Red };
+
+  CHECK(tft.setAsync(async) == RA8876_OK);
+  tft.clearScreen(Color::Black);
+
+  // two regions that do not meet leave nothing to draw on
+  CHECK(tft.pushClip(a) == RA8876_OK);
+  CHECK(tft.pushClip(b) == RA8876_OK);
+  CHECK((tft.getClip().w == 0) || (tft.getClip().h == 0));
+
+  // geometry and pixels are not sent at all
+  testBegin(tft);
+  CHECK(tft.fillRectangle(0, 0, 1279, 719, Color::Red) == RA8876_OK);
+  CHECK(tft.drawLine(0, 0, 1279, 719, Color::Red) == RA8876_OK);
+  CHECK(tft.fillCircle(505, 505, 50, Color::Red) == RA8876_OK);
+  CHECK(tft.getPendingCount() == 0);
+  tft.putPixel(505, 505, Color::Red);
+  tft.putPixels(500, 505, row, 4);
+  cost = testEnd(tft, NULL);
+  CHECK(cost.bytes == 0);
+
+  CHECK(tft.popClip() == RA8876_OK);
+  CHECK(tft.popClip() == RA8876_OK);
+  tft.flush();
+  CHECK(PIXEL(500, 500) == 0);
+  CHECK(PIXEL(505, 505) == 0);
+  CHECK(PIXEL(105, 105) == 0);
+  CHECK(PIXEL(0, 0) == 0);
+
+  CHECK(tft.setAsync(false) == RA8876_OK);
+}
+
+//--------------------------------------------------------------------------
+// the ends of the stack
+
+static void
+testDepth()
+{
+  RA8876Rect r;
+  int        i;
+
+  CHECK(tft.popClip() == RA8876_ERROR_CLIP);
+  CHECK(sameRect(tft.getClip(), 0, 0, canvas.w, canvas.h));
+
+  // each region one pixel inside the one before
+  for (i = 0; i < RA8876_CLIP_DEPTH; i++)
+  {
+    r.x = i;
+    r.y = i;
+    r.w = 1280 - 2 * i;
+    r.h = 720 - 2 * i;
+    CHECK(tft.pushClip(r) == RA8876_OK);
+  }
+  i = RA8876_CLIP_DEPTH - 1;
+
+  // one too many is refused and changes nothing
+  r.x = 600;
+  r.y = 300;
+  r.w = 10;
+  r.h = 10;
+  CHECK(tft.pushClip(r) == RA8876_ERROR_CLIP);
+  CHECK(sameRect(tft.getClip(), i, i, 1280 - 2 * i, 720 - 2 * i));
+  CHECK(window(i, i, 1280 - 2 * i, 720 - 2 * i));
+
+  for (i = 0; i < RA8876_CLIP_DEPTH; i++)
+    CHECK(tft.popClip() == RA8876_OK);
+  CHECK(tft.popClip() == RA8876_ERROR_CLIP);
+  CHECK(sameRect(tft.getClip(), 0, 0, canvas.w, canvas.h));
+  CHECK(window(0, 0, canvas.w, canvas.h));
+  CHECK(tft.verifyShadow() == 0);
+}
+
+//--------------------------------------------------------------------------
+// text under a region
+
+static void
+testNewline()
+{
+  RA8876Rect box = { 200, 300, 400, 200 };
+  uint16_t   cw, ch;
+
+  tft.setFont(RA8876_FONT_SIZE_32);
+  tft.setTextColor(Color::White);
+  tft.clearScreen(Color::Black);
+  cw = tft.getTextWidth();
+  ch = tft.getTextHeight();
+
+  // the second line starts at the left edge of the region
+  CHECK(tft.pushClip(box) == RA8876_OK);
+  tft.setTextCursor(200, 300);
+  tft.print("AB\nCD");
+  CHECK(tft.getTextCursorX() == 200 + 2 * cw);
+  CHECK(tft.getTextCursorY() == 300 + ch);
+  CHECK(tft.popClip() == RA8876_OK);
+  CHECK(tft.getWriteError() == 0);
+
+  // the same lines, without a region
+  tft.setTextCursor(700, 300);
+  tft.putChars("AB", 2);
+  tft.setTextCursor(700, 300 + ch);
+  tft.putChars("CD", 2);
+  tft.flush();
+
+  CHECK(testCompare(200, 300, 700, 300, 2 * cw, 2 * ch) == 0);
+  CHECK(testCompare(200, 300 + ch, 200, 600, 2 * cw, ch) != 0);
+}
+
+int
+main()
+{
+  CHECK(tft.init());
+
+  printf("clip\n");
+
+  canvas = tft.getClip();
+  CHECK((canvas.w == 1280) && (canvas.h >= 720));
+
+  testNested();
+  testEmpty(false);
+  testEmpty(true);
+  testDepth();
+  testNewline();
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  return testDone("clip");
+}
+
+//--------------------------------------------------------------------------
@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// emulator regression: SPI framing, a pixel exact reference scene and the
+// bus/time cost of drawing it
+
+#include "host-test.h"
+
+#if RA8876_COLOR_DEPTH != 16
+#error "the reference scene is rendered at 16bpp"
+#endif
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+// the frame hash of drawScene(); update it only for an intended change of
+// the rendering
+#define SCENE_HASH          0x6fbcb717
+
+// budgets the scene has to stay within (measured cost plus some headroom)
+#define SCENE_BYTES         6000
+#define SCENE_US            60000
+
+static Color
+gradient(int x, int y)
+{
+  return Color((x * 7) & 0xff, (y * 5) & 0xff, (x ^ y) & 0xff);
+}
+
+static void
+drawScene()
+{
+  Color    row[64];
+  uint16_t rgb565[64 * 16];
+
+  tft.clearScreen(Color::Black);
+
+  // geometry engine
+  tft.drawLine(10, 10, 300, 200, Color::White);
+  tft.drawRectangle(20, 220, 220, 320, Color::Red);
+  tft.fillRectangle(240, 220, 440, 320, Color::Blue);
+  tft.drawTriangle(460, 320, 560, 220, 660, 320, Color::Green);
+  tft.fillTriangle(680, 320, 780, 220, 880, 320, Color::Yellow);
+  tft.drawCircle(1000, 100, 60, Color::Cyan);
+  tft.fillCircle(1150, 100, 60, Color::Magenta);
+  tft.drawEllipse(1000, 300, 80, 40, Color::Orange);
+  tft.fillEllipse(1150, 300, 80, 40, Color::Pink);
+
+  // memory port
+  for (int y = 0; y < 16; y++)
+  {
+    for (int x = 0; x < 64; x++)
+    {
+      row[x]               = gradient(x, y);
+      rgb565[y * 64 + x]   = gradient(x, y).toRGB565();
+    }
+    tft.putPixels(20, 400 + y, row, 64);
+  }
+  tft.writeRect(120, 400, 64, 16, rgb565);
+
+  // bte and text
+  tft.bteMemoryCopy(20, 400, 220, 400, 64, 16);
+  tft.setTextColor(Color::White);
+  tft.setTextCursor(20, 500);
+  tft.print("RA8876 emulator");
+}
+
+//--------------------------------------------------------------------------
+// a packed frame, as the removed burst mode sent it: the chip takes the
+// bytes after the command cycle type as further register selects
+
+static void
+testFraming()
+{
+  uint8_t before, frame[4] = { RA8876_CMD_WRITE, RA8876_REG_CURH0, RA8876_DATA_WRITE, 0x5a };
+
+  before = ra8876Emulator.reg[RA8876_REG_CURH0];
+  ra8876Emulator.resetStats();
+
+  SPI.beginTransaction(SPISettings(RA8876_SPI_SPEED, MSBFIRST, SPI_MODE3));
+  digitalWrite(RA8876_CS, LOW);
+  SPI.transfer(frame, sizeof(frame));
+  digitalWrite(RA8876_CS, HIGH);
+  SPI.endTransaction();
+
+  CHECK(ra8876Emulator.protocolErrors == 1);
+  CHECK(ra8876Emulator.reg[RA8876_REG_CURH0] == before);
+
+  // the driver's own traffic is clean
+  ra8876Emulator.resetStats();
+  tft.fillRectangle(0, 0, 10, 10, Color::Black);
+  tft.putPixel(5, 5, Color::White);
+  CHECK(tft.verifyShadow() == 0);
+  CHECK(ra8876Emulator.protocolErrors == 0);
+}
+
+int
+main()
+{
+  TestCost c;
+  Color    row[64];
+
+  CHECK(tft.init());
+  tft.setFont(RA8876_FONT_SIZE_32);
+
+  printf("emulator\n");
+  testFraming();
+
+  ra8876Emulator.resetStats();
+  testBegin(tft);
+  drawScene();
+  c = testEnd(tft, "scene");
+  CHECK(ra8876Emulator.protocolErrors == 0);
+  CHECK(ra8876Emulator.frameHash() == SCENE_HASH);
+  CHECK(c.bytes <= SCENE_BYTES);
+  CHECK(c.us    <= SCENE_US);
+  CHECK(tft.verifyShadow() == 0);
+
+  // the upload paths agree pixel for pixel
+  CHECK(testCompare(20, 400, 120, 400, 64, 16) == 0);
+  CHECK(testCompare(20, 400, 220, 400, 64, 16) == 0);
+
+  // a memory port stream costs its pixels plus the setup
+  for (int x = 0; x < 64; x++) row[x] = gradient(x, 0);
+  testBegin(tft);
+  tft.putPixels(0, 600, row, 64);
+  c = testEnd(tft, "putPixels 64");
+  CHECK(c.bytes <= (64 * RA8876PixelFormat::bytes) + 32);
+
+  return testDone("emulator");
+}
+
+//--------------------------------------------------------------------------
@@ -0,0 +1,206 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// bte fills: solid and pattern fills produce the same pixels as the
+// geometry engine and the memory port, in sync and async mode, and the
+// damage board draws the same screen incrementally as on a full redraw
+
+#include "host-test.h"
+#include "ra8876-damage.h"
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+static Color  tile8[8 * 8];
+static Color  tile16[16 * 16];
+
+static const Color stripes[] = { Color::Red, Color::Green, Color::Blue, Color::Yellow, Color::Cyan, Color::Magenta };
+
+// the fill as the memory port draws it: the tile repeats from (x, y)
+static void
+patternReference(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const Color *tile, int size)
+{
+  Color row[1280];
+
+  for (int j = 0; j < h; j++)
+  {
+    for (int i = 0; i < w; i++) row[i] = tile[(j % size) * size + (i % size)];
+    tft.putPixels(x, y + j, row, w);
+  }
+}
+
+//--------------------------------------------------------------------------
+// solid fill against fillRectangle()
+
+static void
+testSolid()
+{
+  TestCost geometry, bte;
+
+  tft.clearScreen(Color::Black);
+
+  testBegin(tft);
+  for (int i = 0; i < 18; i++)
+    tft.fillRectangle(0, i * 10, 639, i * 10 + 9, stripes[i % 6]);
+  geometry = testEnd(tft, "18 stripes, geometry");
+
+  testBegin(tft);
+  for (int i = 0; i < 18; i++)
+    CHECK(tft.bteSolidFill(640, i * 10, 640, 10, stripes[i % 6]) == RA8876_OK);
+  bte = testEnd(tft, "18 stripes, bte solid fill");
+
+  CHECK(testCompare(0, 0, 640, 0, 640, 180) == 0);
+  CHECK(PIXEL(700, 15) == testRGB(Color::Green));
+  CHECK(bte.bytes < geometry.bytes);
+
+  // clipped at the screen edge like the geometry engine
+  CHECK(tft.bteSolidFill(1270, 200, 100, 10, Color::White) == RA8876_OK);
+  tft.fillRectangle(1270, 220, 1279, 229, Color::White);
+  tft.flush();
+  CHECK(testCompare(1270, 200, 1270, 220, 10, 10) == 0);
+}
+
+//--------------------------------------------------------------------------
+// pattern fill against the tile drawn through the memory port
+
+static void
+testPattern()
+{
+  TestCost geometry, pattern;
+  RA8876Rect box = { 700, 560, 300, 50 };
+
+  tft.clearScreen(Color::Black);
+
+  for (int i = 0; i < 8 * 8; i++)   tile8[i]  = ((i / 8) < 4) ? Color::Red : Color::Black;
+  for (int i = 0; i < 16 * 16; i++) tile16[i] = Color((i * 13) & 0xff, (i * 7) & 0xff, i & 0xff);
+
+  CHECK(tft.setPattern(0, RA8876_PATTERN_8X8,   tile8)  == RA8876_OK);
+  CHECK(tft.setPattern(1, RA8876_PATTERN_16X16, tile16) == RA8876_OK);
+  CHECK(tft.btePatternFill(0, 0, 10, 10, 2) == RA8876_ERROR_PARAMETER);
+  CHECK(tft.btePatternFill(0, 0, 10, 10, RA8876_PATTERN_SLOTS) == RA8876_ERROR_PARAMETER);
+
+  // 90 stripes, 4 pixels of red every 8 rows
+  testBegin(tft);
+  for (int i = 0; i < 90; i++)
+    tft.fillRectangle(0, i * 8, 199, i * 8 + 3, Color::Red);
+  geometry = testEnd(tft, "90 stripes, geometry");
+
+  testBegin(tft);
+  CHECK(tft.btePatternFill(200, 0, 200, 720, 0) == RA8876_OK);
+  pattern = testEnd(tft, "90 stripes, bte pattern fill");
+
+  CHECK(testCompare(0, 0, 200, 0, 200, 720) == 0);
+  CHECK(pattern.bytes < geometry.bytes);
+
+  // a 16x16 tile at an origin that is not a multiple of the tile
+  CHECK(tft.btePatternFill(403, 5, 77, 45, 1) == RA8876_OK);
+  patternReference(503, 5, 77, 45, tile16, 16);
+  tft.flush();
+  CHECK(testCompare(403, 5, 503, 5, 77, 45) == 0);
+
+  // clipped: the tile repeats from the clipped corner
+  CHECK(tft.pushClip(box) == RA8876_OK);
+  CHECK(tft.btePatternFill(650, 530, 200, 100, 1) == RA8876_OK);
+  CHECK(tft.popClip() == RA8876_OK);
+  patternReference(700, 630, 150, 50, tile16, 16);
+  tft.flush();
+  CHECK(testCompare(700, 560, 700, 630, 150, 50) == 0);
+  CHECK(PIXEL(699, 560) == 0);
+  CHECK(PIXEL(700, 559) == 0);
+  CHECK(PIXEL(850, 560) == 0);
+}
+
+//--------------------------------------------------------------------------
+// the same fills through the command queue
+
+static void
+drawFills()
+{
+  tft.clearScreen(Color(0, 0, 128));
+  for (int i = 0; i < 18; i++)
+    tft.bteSolidFill(i * 70, i * 10, 300, 200, stripes[i % 6]);
+  tft.btePatternFill(100, 400, 500, 200, 0);
+  tft.btePatternFill(640, 400, 500, 200, 1);
+  tft.bteMemoryCopy(100, 400, 300, 250, 200, 100);
+  tft.flush();
+}
+
+static void
+testAsync()
+{
+  uint32_t sync;
+
+  drawFills();
+  sync = ra8876Emulator.frameHash();
+
+  tft.setAsync(true);
+  drawFills();
+  tft.setAsync(false);
+
+  CHECK(ra8876Emulator.frameHash() == sync);
+  CHECK(tft.verifyShadow() == 0);
+}
+
+//--------------------------------------------------------------------------
+// damage board: an incremental update leaves the same screen as a full
+// redraw of the same content
+
+static void
+testDamage()
+{
+  RA8876Damage board(tft);
+  int          cells[12];
+  uint32_t     incremental;
+  char         text[16];
+
+  tft.clearScreen(Color::Black);
+  for (int i = 0; i < 12; i++)
+    cells[i] = board.addCell((i % 3) * 400 + 20, (i / 3) * 60 + 20, 360, 40,
+                             (i % 3 == 2) ? RA8876_TEXT_ALIGN_RIGHT : RA8876_TEXT_ALIGN_LEFT);
+  board.setBackground(Color(0, 0, 128));
+
+  for (int i = 0; i < 12; i++)
+  {
+    snprintf(text, sizeof(text), "cell %d", i);
+    board.setText(cells[i], text, Color::White);
+  }
+  CHECK(board.update() == RA8876_OK);
+
+  // a few cells change
+  board.setText(cells[1], "12:34", Color::Yellow);
+  board.setText(cells[5], "", Color::White);
+  board.setText(cells[9], "a text far too long for its cell", Color::White);
+  CHECK(board.update() == RA8876_OK);
+  CHECK(board.getStats().cellsDrawn == 3);
+  tft.flush();
+  incremental = ra8876Emulator.frameHash();
+
+  board.invalidate();
+  CHECK(board.update() == RA8876_OK);
+  CHECK(board.getStats().cellsDrawn == 12);
+  tft.flush();
+  CHECK(ra8876Emulator.frameHash() == incremental);
+}
+
+int
+main()
+{
+  CHECK(tft.init());
+  tft.setFont(RA8876_FONT_SIZE_32);
+
+  printf("fill\n");
+  ra8876Emulator.resetStats();
+
+  testSolid();
+  testPattern();
+  testAsync();
+  testDamage();
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  return testDone("fill");
+}
+
+//--------------------------------------------------------------------------
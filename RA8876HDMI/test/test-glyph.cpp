@@ -0,0 +1,107 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// bitmap fonts: drawGlyphs() places every glyph at its offset from the
+// cursor and moves on by its advance; a glyph with a negative offset at
+// the left or top edge of the canvas loses the columns and rows past the
+// edge instead of wrapping around to the far side
+
+#include "host-test.h"
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+// 10 x 8 pixels, two bytes a row: every row and column different
+static const uint8_t bitmap[] =
+{
+  0xC1, 0x80,   0xA2, 0x40,   0x94, 0xC0,   0x88, 0x00,
+  0xF0, 0xC0,   0x81, 0x40,   0xBE, 0x80,   0xD5, 0x40,
+  // a plain 8 x 8 block
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+// 'A' hangs 3 pixels left of the cursor, 'B' 2 more above the line too
+static const RA8876Glyph glyphs[] =
+{
+  {  0, 10, 8, 8, -3,  0 },   // A
+  {  0, 10, 8, 8, -5, -2 },   // B
+  { 16,  8, 8, 9,  0,  0 },   // C
+  { 16,  4, 8, 4, -6,  0 },   // D, wholly left of the cursor
+};
+
+static const RA8876BitmapFont font = { bitmap, glyphs, 'A', 'D', 8 };
+
+#define GLYPH_W             10
+#define GLYPH_H             8
+
+//--------------------------------------------------------------------------
+// inside the canvas
+
+static void
+testPlaced()
+{
+  tft.clearScreen(Color::Black);
+
+  // the reference: each glyph at its offset, the cursor moved on
+  CHECK(tft.drawGlyphs(200, 300, &font, "AC", Color::White) == RA8876_OK);
+  CHECK(PIXEL(197, 300) == testRGB(Color::White));
+  CHECK(PIXEL(196, 300) == 0);
+  CHECK(PIXEL(208, 300) == testRGB(Color::White));
+  CHECK(PIXEL(215, 307) == testRGB(Color::White));
+  CHECK(PIXEL(216, 307) == 0);
+
+  // characters the font lacks are skipped
+  CHECK(tft.drawGlyphs(0, 0, &font, "az", Color::White) == RA8876_OK);
+  CHECK(tft.drawGlyphs(0, 0, NULL, "A", Color::White) == RA8876_ERROR_PARAMETER);
+}
+
+//--------------------------------------------------------------------------
+// past the edge
+
+static void
+testEdge()
+{
+  // at x=0 the first 3 columns are past the edge
+  CHECK(tft.drawGlyphs(0, 100, &font, "A", Color::White) == RA8876_OK);
+  CHECK(testCompare(0, 100, 200, 300, GLYPH_W - 3, GLYPH_H) == 0);
+
+  // at x=1 the row starts 2 bits into the first byte
+  CHECK(tft.drawGlyphs(1, 200, &font, "A", Color::White) == RA8876_OK);
+  CHECK(testCompare(0, 200, 199, 300, GLYPH_W - 2, GLYPH_H) == 0);
+
+  // the next glyph follows the advance from the cursor, not the bitmap
+  CHECK(tft.drawGlyphs(0, 400, &font, "AC", Color::White) == RA8876_OK);
+  CHECK(testCompare(8, 400, 208, 300, 8, GLYPH_H) == 0);
+
+  // above the top edge too: the first 2 rows are gone
+  CHECK(tft.drawGlyphs(2, 0, &font, "B", Color::White) == RA8876_OK);
+  CHECK(testCompare(0, 0, 200, 302, GLYPH_W - 3, GLYPH_H - 2) == 0);
+
+  // nothing wraps to the far side of the canvas
+  CHECK(testCompare(1280 - 16, 0, 600, 0, 16, 720) == 0);
+  CHECK(PIXEL(1279, 100) == 0);
+
+  // wholly past the edge: nothing is sent
+  testBegin(tft);
+  CHECK(tft.drawGlyphs(0, 500, &font, "D", Color::White) == RA8876_OK);
+  CHECK(testEnd(tft, NULL).bytes == 0);
+}
+
+int
+main()
+{
+  CHECK(tft.init());
+
+  printf("glyph\n");
+
+  testPlaced();
+  testEdge();
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  return testDone("glyph");
+}
+
+//--------------------------------------------------------------------------
@@ -0,0 +1,161 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// INT pin: with the line wired, engine completion comes from the ISR, one
+// interrupt per command, in sync and async mode, and without a status
+// read on the bus; a line that never falls ends in a timeout
+
+#define RA8876_INT          3
+
+#include "host-test.h"
+
+RA8876 tft(RA8876_CS, RA8876_RESET, RA8876_INT);
+
+static const Color stripes[] = { Color::Red, Color::Green, Color::Blue, Color::Yellow, Color::Cyan, Color::Magenta };
+
+static uint32_t completions;
+
+static void
+completed()
+{
+  completions++;
+}
+
+// the stripes of fills() through the memory port
+static void
+reference(uint16_t x, uint16_t y)
+{
+  Color row[200];
+
+  for (int i = 0; i < 12; i++)
+  {
+    for (int j = 0; j < 200; j++) row[j] = stripes[i % 6];
+    for (int j = 0; j < 10; j++)  tft.putPixels(x, y + i * 10 + j, row, 200);
+  }
+}
+
+// 12 stripes: bte fills and geometry engine rectangles in turn
+static void
+fills(uint16_t x, uint16_t y)
+{
+  for (int i = 0; i < 12; i++)
+  {
+    if (i & 1) CHECK(tft.bteSolidFill(x, y + i * 10, 200, 10, stripes[i % 6]) == RA8876_OK);
+    else       tft.fillRectangle(x, y + i * 10, x + 199, y + i * 10 + 9, stripes[i % 6]);
+  }
+}
+
+//--------------------------------------------------------------------------
+// sync: each command waits on the ISR flag
+
+static void
+testSync()
+{
+  uint32_t interrupts, status;
+  TestCost c;
+
+  tft.clearScreen(Color::Black);
+  reference(0, 300);
+  tft.flush();
+
+  interrupts  = ra8876Emulator.interrupts;
+  status      = ra8876Emulator.statusReads;
+  completions = 0;
+
+  testBegin(tft);
+  fills(0, 0);
+  c = testEnd(tft, "12 fills, sync");
+
+  // one falling edge per command: the flag was cleared before each one
+  CHECK(ra8876Emulator.interrupts - interrupts == 12);
+  CHECK(completions == 12);
+  CHECK(ra8876Emulator.statusReads == status);
+  CHECK(tft.getSpiStats().bytes == c.bytes);
+  CHECK(testCompare(0, 0, 0, 300, 200, 120) == 0);
+}
+
+//--------------------------------------------------------------------------
+// async: poll() issues the next command once the ISR has fired
+
+static void
+testAsync()
+{
+  uint32_t interrupts, status;
+  int      spins;
+
+  interrupts  = ra8876Emulator.interrupts;
+  status      = ra8876Emulator.statusReads;
+  completions = 0;
+
+  CHECK(tft.setAsync(true) == RA8876_OK);
+  testBegin(tft);
+  fills(300, 0);
+
+  // the host is free while the queue drains
+  for (spins = 0; (tft.getPendingCount() != 0) && (spins < 10000); spins++)
+  {
+    delayMicroseconds(50);
+    CHECK(tft.poll() == RA8876_OK);
+  }
+  CHECK(tft.getPendingCount() == 0);
+  testEnd(tft, "12 fills, async");
+  CHECK(tft.setAsync(false) == RA8876_OK);
+
+  CHECK(ra8876Emulator.interrupts - interrupts == 12);
+  CHECK(completions == 12);
+  CHECK(ra8876Emulator.statusReads == status);
+  CHECK(testCompare(300, 0, 0, 300, 200, 120) == 0);
+}
+
+//--------------------------------------------------------------------------
+// a line that never falls: the wait gives up after its timeout
+
+static void
+testTimeout()
+{
+  void   (*isr)();
+  uint64_t start;
+
+  tft.setWaitTimeout(RA8876_WAIT_STATUS_IDLE, 2000);
+
+  isr = ra8876Emulator.isr;
+  ra8876Emulator.isr = NULL;
+  start = ra8876Emulator.now;
+  CHECK(tft.bteSolidFill(600, 0, 200, 120, Color::White) == RA8876_ERROR_TIMEOUT);
+  CHECK((ra8876Emulator.now - start) / 1000 >= 2000);
+  CHECK((ra8876Emulator.now - start) / 1000 <  3000);
+  CHECK(tft.getWaitHistogram(RA8876_WAIT_STATUS_IDLE)[RA8876_WAIT_BUCKETS - 1] != 0);
+  ra8876Emulator.isr = isr;
+
+  tft.setWaitTimeout(RA8876_WAIT_STATUS_IDLE, 250000);
+
+  // the next command re-arms the flag and completes
+  fills(600, 0);
+  tft.flush();
+  CHECK(testCompare(600, 0, 0, 300, 200, 120) == 0);
+}
+
+int
+main()
+{
+  CHECK(tft.init());
+  tft.setCompletionCallback(completed);
+
+  printf("int\n");
+
+  CHECK(ra8876Emulator.isr != NULL);
+  CHECK(ra8876Emulator.intLine() == HIGH);
+
+  testSync();
+  testAsync();
+  testTimeout();
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  return testDone("int");
+}
+
+//--------------------------------------------------------------------------
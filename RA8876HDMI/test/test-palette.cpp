@@ -0,0 +1,88 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// palette benchmark, built once per colour depth (test-palette-8, -16 and
+// -24): an indexed bulk write costs one pixel of the driver depth per
+// index, so only at 8bpp is it one byte an index. engine drawn content
+// (text, fills) costs the same at every depth; there a palette only names
+// the colours.
+
+#include "host-test.h"
+#include "ra8876-damage.h"
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+#define IMAGE_W             1280
+#define IMAGE_H             40
+
+enum Ink { INK_BACKGROUND, INK_TEXT, INK_LINE, INK_STALE };
+static const Color inks[] = { Color::Black, Color::White, Color::Yellow, Color::Red };
+
+static uint8_t image[IMAGE_W * IMAGE_H];
+
+int
+main()
+{
+  RA8876Damage board(tft);
+  TestCost     indexed, direct, text;
+  Color        row[IMAGE_W];
+  uint32_t     pixels;
+  int          cell[5];
+  char         name[16];
+
+  CHECK(tft.init());
+  tft.setFont(RA8876_FONT_SIZE_32);
+  CHECK(tft.setPalette(inks, 4) == RA8876_OK);
+  tft.clearScreen(tft.paletteColor(INK_BACKGROUND));
+
+  printf("palette at %dbpp\n", RA8876_COLOR_DEPTH);
+
+  for (int i = 0; i < IMAGE_W * IMAGE_H; i++) image[i] = ((i % IMAGE_W) / 40 + (i / IMAGE_W) / 8) & 3;
+  pixels = IMAGE_W * IMAGE_H;
+
+  // a bulk image through the palette
+  testBegin(tft);
+  CHECK(tft.writeRectIndexed(0, 100, IMAGE_W, IMAGE_H, image) == RA8876_OK);
+  indexed = testEnd(tft, "writeRectIndexed 1280x40");
+
+  // the same pixels as colours
+  testBegin(tft);
+  for (int y = 0; y < IMAGE_H; y++)
+  {
+    for (int x = 0; x < IMAGE_W; x++) row[x] = tft.paletteColor(image[y * IMAGE_W + x]);
+    tft.putPixels(0, 200 + y, row, IMAGE_W);
+  }
+  direct = testEnd(tft, "putPixels 1280x40");
+
+  printf("  %.2f bytes per pixel on the wire\n", (double)indexed.bytes / pixels);
+
+  CHECK(testCompare(0, 100, 0, 200, IMAGE_W, IMAGE_H) == 0);
+  CHECK(indexed.bytes >= pixels * RA8876PixelFormat::bytes);
+  CHECK(indexed.bytes <= pixels * RA8876PixelFormat::bytes + 64);
+  CHECK(indexed.bytes <= direct.bytes);
+
+  // a row of the departure board: engine drawn, the same at every depth
+  for (int c = 0; c < 5; c++) cell[c] = board.addCell(50 + c * 240, 400, 220, 40);
+  board.setBackground(tft.paletteColor(INK_BACKGROUND));
+  board.update();
+
+  testBegin(tft);
+  board.setText(cell[0], "14",           tft.paletteColor(INK_LINE));
+  board.setText(cell[1], "METRO",        tft.paletteColor(INK_TEXT));
+  board.setText(cell[2], "Centralen",    tft.paletteColor(INK_TEXT));
+  board.setText(cell[3], "12:34",        tft.paletteColor(INK_TEXT));
+  board.setText(cell[4], "3 min",        tft.paletteColor(INK_STALE));
+  CHECK(board.update() == RA8876_OK);
+  text = testEnd(tft, "board row");
+  CHECK(text.bytes < 2000);
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  snprintf(name, sizeof(name), "palette %dbpp", RA8876_COLOR_DEPTH);
+  return testDone(name);
+}
+
+//--------------------------------------------------------------------------
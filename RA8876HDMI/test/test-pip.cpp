@@ -0,0 +1,233 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// picture-in-picture: both windows land in their own register set of the
+// chip (selected through MPWCTR) and show their surface over the main
+// window, PIP1 on top; moving, scrolling or toggling one costs a few
+// register writes and nothing when it changes nothing
+
+#include "host-test.h"
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+// a register write: a command and a data frame of two bytes each
+#define REG_BYTES           4
+
+static const RA8876Surface *badge;
+static const RA8876Surface *ticker;
+
+// the register sets of the chip
+static uint16_t
+pip16(int i, uint8_t r)
+{
+  r -= RA8876_REG_PWDULX0;
+  return ra8876Emulator.pip[i][r] | ((uint16_t)ra8876Emulator.pip[i][r + 1] << 8);
+}
+
+static uint32_t
+pip32(int i, uint8_t r)
+{
+  return pip16(i, r) | ((uint32_t)pip16(i, r + 2) << 16);
+}
+
+static uint8_t
+depthCode(int i)
+{
+  uint8_t code = (RA8876_COLOR_DEPTH == 8) ? 0 : ((RA8876_COLOR_DEPTH == 16) ? 1 : 2);
+  return (i == 0) ? (code << 2) : code;
+}
+
+// a surface of one colour, with a stripe down its left edge
+static const RA8876Surface *
+surface(uint16_t w, uint16_t h, Color c)
+{
+  const RA8876Surface *s;
+
+  s = tft.allocSurface(w, h);
+  if (s == NULL) return s;
+  tft.setCanvas(s);
+  tft.bteSolidFill(0, 0, w, h, c);
+  tft.bteSolidFill(0, 0, 4, h, Color::White);
+  tft.setCanvas(NULL);
+  return s;
+}
+
+static uint32_t
+bytes(RA8876Error (*op)())
+{
+  testBegin(tft);
+  CHECK(op() == RA8876_OK);
+  return testEnd(tft, NULL).bytes;
+}
+
+//--------------------------------------------------------------------------
+// the register sets
+
+static void
+testRegisters()
+{
+  CHECK(tft.setPip(RA8876_PIP_1, badge,  101, 50) == RA8876_OK);
+  CHECK(tft.setPip(RA8876_PIP_2, ticker, 400, 60, 64, 20) == RA8876_OK);
+
+  // PIP1: the whole surface, the X position down to a multiple of 4
+  CHECK(pip32(0, RA8876_REG_PISA0)   == badge->addr);
+  CHECK(pip16(0, RA8876_REG_PIW0)    == badge->stride);
+  CHECK(pip16(0, RA8876_REG_PWDULX0) == 100);
+  CHECK(pip16(0, RA8876_REG_PWDULY0) == 50);
+  CHECK(pip16(0, RA8876_REG_PWW0)    == badge->width);
+  CHECK(pip16(0, RA8876_REG_PWH0)    == badge->height);
+  CHECK(pip16(0, RA8876_REG_PWIULX0) == 0);
+
+  // PIP2: part of its surface; PIP1 is left as it was
+  CHECK(pip32(1, RA8876_REG_PISA0)   == ticker->addr);
+  CHECK(pip16(1, RA8876_REG_PIW0)    == ticker->stride);
+  CHECK(pip16(1, RA8876_REG_PWDULX0) == 400);
+  CHECK(pip16(1, RA8876_REG_PWDULY0) == 60);
+  CHECK(pip16(1, RA8876_REG_PWW0)    == 64);
+  CHECK(pip16(1, RA8876_REG_PWH0)    == 20);
+  CHECK(pip16(0, RA8876_REG_PWDULX0) == 100);
+
+  // each window its own depth, the last one set up stays selected
+  CHECK((ra8876Emulator.reg[RA8876_REG_PIPCDEP] & RA8876_REG_PIPCDEP_PIP1_MASK) == depthCode(0));
+  CHECK((ra8876Emulator.reg[RA8876_REG_PIPCDEP] & RA8876_REG_PIPCDEP_PIP2_MASK) == depthCode(1));
+  CHECK((ra8876Emulator.reg[RA8876_REG_MPWCTR] & RA8876_REG_MPWCTR_PIPC_MASK) == RA8876_REG_MPWCTR_PIPC_PIP2);
+
+  // not shown yet
+  CHECK((ra8876Emulator.reg[RA8876_REG_MPWCTR] & (RA8876_REG_MPWCTR_PIP1_MASK | RA8876_REG_MPWCTR_PIP2_MASK)) == 0);
+  CHECK(PIXEL(110, 60) == 0);
+  CHECK(tft.verifyShadow() == 0);
+}
+
+//--------------------------------------------------------------------------
+// on screen
+
+static void
+testScreen()
+{
+  CHECK(tft.showPip(RA8876_PIP_1, true) == RA8876_OK);
+  CHECK(tft.showPip(RA8876_PIP_2, true) == RA8876_OK);
+
+  CHECK(PIXEL(100, 50) == testRGB(Color::White));
+  CHECK(PIXEL(110, 60) == testRGB(Color::Red));
+  CHECK(PIXEL(100 + badge->width, 60) == 0);
+  CHECK(PIXEL(410, 70) == testRGB(Color::Green));
+  CHECK(PIXEL(400 + 64, 70) == 0);
+
+  // PIP1 above PIP2 where they overlap
+  CHECK(tft.movePip(RA8876_PIP_2, 120, 60) == RA8876_OK);
+  CHECK(PIXEL(130, 62) == testRGB(Color::Red));
+  CHECK(PIXEL(170, 62) == testRGB(Color::Green));
+
+  // drawing underneath does not show through
+  tft.fillRectangle(100, 50, 200, 100, Color::Blue);
+  tft.flush();
+  CHECK(PIXEL(110, 60) == testRGB(Color::Red));
+  CHECK(PIXEL(100, 49) == 0);
+
+  // the ticker scrolls through its surface, clamped at the end
+  CHECK(tft.scrollPip(RA8876_PIP_2, 200, 100) == RA8876_OK);
+  CHECK(pip16(1, RA8876_REG_PWIULX0) == ticker->width - 64);
+  CHECK(pip16(1, RA8876_REG_PWIULY0) == ticker->height - 20);
+  CHECK(tft.getPip(RA8876_PIP_2).sx == ticker->width - 64);
+}
+
+//--------------------------------------------------------------------------
+// costs
+
+static RA8876Error showBadge()      { return tft.showPip(RA8876_PIP_1, true);  }
+static RA8876Error hideBadge()      { return tft.showPip(RA8876_PIP_1, false); }
+static RA8876Error moveBadgeX()     { return tft.movePip(RA8876_PIP_1, 300, 50); }
+static RA8876Error moveBadgeXY()    { return tft.movePip(RA8876_PIP_1, 600, 200); }
+static RA8876Error moveTicker()     { return tft.movePip(RA8876_PIP_2, 500, 60); }
+static RA8876Error scrollTicker()   { return tft.scrollPip(RA8876_PIP_2, 8, 0); }
+
+static void
+testCosts()
+{
+  uint32_t n;
+
+  // a toggle is one write of MPWCTR, and none when nothing changes
+  CHECK(bytes(hideBadge) == REG_BYTES);
+  CHECK(bytes(hideBadge) == 0);
+  CHECK(bytes(showBadge) == REG_BYTES);
+  CHECK(bytes(showBadge) == 0);
+
+  // a move: the window select (when it changes) and the co-ordinates
+  // that moved, both halves of each
+  n = bytes(moveBadgeX);
+  printf("  move PIP1 in X after PIP2:     %u bytes\n", n);
+  CHECK(n == 3 * REG_BYTES);
+  CHECK(bytes(moveBadgeX) == 0);
+  n = bytes(moveBadgeXY);
+  printf("  move PIP1 in X and Y:          %u bytes\n", n);
+  CHECK(n == 4 * REG_BYTES);
+  n = bytes(moveTicker);
+  CHECK(n == 3 * REG_BYTES);
+  n = bytes(scrollTicker);
+  printf("  scroll PIP2 in X and Y:        %u bytes\n", n);
+  CHECK(n == 4 * REG_BYTES);
+
+  CHECK(pip16(0, RA8876_REG_PWDULX0) == 600);
+  CHECK(pip16(0, RA8876_REG_PWDULY0) == 200);
+  CHECK(pip16(1, RA8876_REG_PWDULX0) == 500);
+  CHECK(pip16(1, RA8876_REG_PWIULX0) == 8);
+  CHECK(pip16(1, RA8876_REG_PWIULY0) == 0);
+  CHECK(tft.verifyShadow() == 0);
+}
+
+//--------------------------------------------------------------------------
+// refused, and a freed surface
+
+static void
+testErrors()
+{
+  const RA8876Surface *s;
+
+  CHECK(tft.setPip(RA8876_PIP_1, NULL, 0, 0) == RA8876_ERROR_PARAMETER);
+  CHECK(tft.setPip(RA8876_PIP_1, badge, 1260, 0) == RA8876_ERROR_PARAMETER);
+  CHECK(tft.setPip(RA8876_PIP_1, badge, 0, 0, badge->width + 4, 0) == RA8876_ERROR_PARAMETER);
+  CHECK(tft.setPip((RA8876PipWindow)2, badge, 0, 0) == RA8876_ERROR_PARAMETER);
+  CHECK(tft.movePip(RA8876_PIP_1, 1280 - 4, 0) == RA8876_ERROR_PARAMETER);
+  CHECK(pip16(0, RA8876_REG_PWDULX0) == 600);
+
+  // a window whose surface is freed is hidden and forgotten
+  s = surface(32, 32, Color::Yellow);
+  CHECK(s != NULL);
+  if (s == NULL) return;
+  CHECK(tft.setPip(RA8876_PIP_2, s, 800, 400) == RA8876_OK);
+  CHECK(tft.showPip(RA8876_PIP_2, true) == RA8876_OK);
+  CHECK(PIXEL(810, 410) == testRGB(Color::Yellow));
+  CHECK(tft.freeSurface(s) == RA8876_OK);
+  CHECK((ra8876Emulator.reg[RA8876_REG_MPWCTR] & RA8876_REG_MPWCTR_PIP2_MASK) == 0);
+  CHECK(tft.getPip(RA8876_PIP_2).surface == NULL);
+  CHECK(tft.showPip(RA8876_PIP_2, true) == RA8876_ERROR_PARAMETER);
+  CHECK(PIXEL(810, 410) == 0);
+}
+
+int
+main()
+{
+  CHECK(tft.init());
+  tft.clearScreen(Color::Black);
+
+  printf("pip\n");
+
+  badge  = surface(64, 32,  Color::Red);
+  ticker = surface(256, 40, Color::Green);
+  CHECK((badge != NULL) && (ticker != NULL));
+  if ((badge == NULL) || (ticker == NULL)) return testDone("pip");
+
+  testRegisters();
+  testScreen();
+  testCosts();
+  testErrors();
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  return testDone("pip");
+}
+
+//--------------------------------------------------------------------------
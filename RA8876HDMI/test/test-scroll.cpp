@@ -0,0 +1,198 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// virtual canvas: a page larger than the screen is laid out in MISA/MIW,
+// scrollTo() moves the main window in 4 pixel steps across it, clamped
+// at its edge, for one register write a step; with two pages both are
+// laid out again and present() still swaps them
+
+#include "host-test.h"
+
+#if RA8876_COLOR_DEPTH != 16
+#error "the expected pixels are worked out at 16bpp"
+#endif
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+#define VIRTUAL_W           1282    // rounded up to 1284
+#define VIRTUAL_H           1000
+
+// a register write: a command and a data frame of two bytes each
+#define REG_BYTES           4
+
+static uint16_t reg16(uint8_t r) { return ra8876Emulator.reg[r] | ((uint16_t)ra8876Emulator.reg[r + 1] << 8); }
+static uint32_t reg32(uint8_t r) { return reg16(r) | ((uint32_t)reg16(r + 2) << 16); }
+
+// as the chip reads a pixel back: the high bits repeated into the low ones
+static uint32_t
+shown(Color c)
+{
+  uint8_t r = c.r & 0xf8, g = c.g & 0xfc, b = c.b & 0xf8;
+  return testRGB(Color(r | (r >> 5), g | (g >> 6), b | (b >> 5)));
+}
+
+// bands of 40 lines across the whole page, a marker in its far corner
+static Color
+band(int y)
+{
+  return Color((y / 40) * 10, 255 - (y / 40) * 10, 128);
+}
+
+static void
+content()
+{
+  for (int y = 0; y < VIRTUAL_H; y += 40)
+    CHECK(tft.bteSolidFill(0, y, tft.getVirtualWidth(), 40, band(y)) == RA8876_OK);
+  CHECK(tft.bteSolidFill(tft.getVirtualWidth() - 8, VIRTUAL_H - 8, 8, 8, Color::White) == RA8876_OK);
+  tft.flush();
+}
+
+static uint32_t
+scrollBytes(uint16_t x, uint16_t y)
+{
+  testBegin(tft);
+  tft.scrollTo(x, y);
+  return testEnd(tft, NULL).bytes;
+}
+
+//--------------------------------------------------------------------------
+// one page
+
+static void
+testScroll()
+{
+  uint32_t n, worst;
+
+  CHECK(tft.setVirtualSize(VIRTUAL_W, VIRTUAL_H) == RA8876_OK);
+  CHECK(tft.getVirtualWidth()  == 1284);
+  CHECK(tft.getVirtualHeight() == VIRTUAL_H);
+  CHECK(reg32(RA8876_REG_MISA0) == 0);
+  CHECK(reg16(RA8876_REG_MIW0)  == 1284);
+  CHECK((reg16(RA8876_REG_MWULX0) == 0) && (reg16(RA8876_REG_MWULY0) == 0));
+
+  content();
+  CHECK(PIXEL(0, 0)   == shown(band(0)));
+  CHECK(PIXEL(0, 719) == shown(band(719)));
+
+  // a line at a time down the page: one register write a step, two where
+  // the high byte of the position changes too
+  worst = 0;
+  for (int y = 1; y <= 280; y++)
+  {
+    n = scrollBytes(0, y);
+    if ((y & 0xff) != 0) CHECK(n == REG_BYTES);
+    if (n > worst) worst = n;
+  }
+  printf("  scroll a line:   %u bytes, %u at worst\n", REG_BYTES, worst);
+  CHECK(worst == 2 * REG_BYTES);
+  CHECK(reg16(RA8876_REG_MWULY0) == 280);
+  CHECK(PIXEL(0, 0)   == shown(band(280)));
+  CHECK(PIXEL(0, 719) == shown(band(999)));
+
+  // X in steps of 4 pixels
+  CHECK(scrollBytes(4, 280) == REG_BYTES);
+  CHECK(reg16(RA8876_REG_MWULX0) == 4);
+  CHECK(scrollBytes(6, 280) == 0);
+  CHECK(tft.getScrollX() == 4);
+  CHECK(scrollBytes(4, 280) == 0);
+  CHECK(PIXEL(1279, 719) == shown(Color::White));
+  CHECK(PIXEL(1271, 719) == shown(band(999)));
+
+  // clamped at the edge of the page
+  tft.scrollTo(5000, 5000);
+  CHECK((tft.getScrollX() == 4) && (tft.getScrollY() == VIRTUAL_H - 720));
+  CHECK((reg16(RA8876_REG_MWULX0) == 4) && (reg16(RA8876_REG_MWULY0) == VIRTUAL_H - 720));
+
+  // drawing is in page co-ordinates, wherever the window is
+  tft.fillRectangle(1280, 990, 1283, 999, Color::Red);
+  tft.flush();
+  CHECK(PIXEL(1276, 710) == shown(Color::Red));
+
+  tft.scrollTo(0, 0);
+  CHECK(PIXEL(0, 0) == shown(band(0)));
+}
+
+//--------------------------------------------------------------------------
+// two pages
+
+static void
+testPages()
+{
+  uint32_t page;
+
+  CHECK(tft.setDoubleBuffer(true) == RA8876_OK);
+  page = (uint32_t)1284 * VIRTUAL_H * RA8876PixelFormat::bytes;
+
+  // the canvas is the back page, one virtual page up
+  CHECK(reg32(RA8876_REG_MISA0)  == 0);
+  CHECK(reg32(RA8876_REG_CVSSA0) == page);
+  content();
+  tft.fillRectangle(0, 0, 99, 99, Color::Blue);
+  tft.flush();
+  CHECK(PIXEL(0, 0) == shown(band(0)));
+
+  CHECK(tft.present() == RA8876_OK);
+  CHECK(reg32(RA8876_REG_MISA0)  == page);
+  CHECK(reg32(RA8876_REG_CVSSA0) == 0);
+  CHECK(PIXEL(0, 0) == shown(Color::Blue));
+
+  // a new size lays both pages out again: the shown page stays shown
+  CHECK(tft.setVirtualSize(1280, 800) == RA8876_OK);
+  page = (uint32_t)1280 * 800 * RA8876PixelFormat::bytes;
+  CHECK(reg16(RA8876_REG_MIW0)   == 1280);
+  CHECK(reg32(RA8876_REG_MISA0)  == page);
+  CHECK(reg32(RA8876_REG_CVSSA0) == 0);
+  CHECK((reg16(RA8876_REG_MWULX0) == 0) && (reg16(RA8876_REG_MWULY0) == 0));
+
+  // and present() swaps them at the new size
+  tft.clearScreen(Color::Green);
+  CHECK(tft.present() == RA8876_OK);
+  CHECK(reg32(RA8876_REG_MISA0) == 0);
+  CHECK(PIXEL(0, 0)    == shown(Color::Green));
+  CHECK(PIXEL(1279, 719) == shown(Color::Green));
+  tft.scrollTo(0, 80);
+  CHECK(reg16(RA8876_REG_MWULY0) == 80);
+  CHECK(PIXEL(1279, 719) == shown(Color::Green));
+
+  CHECK(tft.setDoubleBuffer(false) == RA8876_OK);
+  CHECK(tft.verifyShadow() == 0);
+}
+
+//--------------------------------------------------------------------------
+// refused
+
+static void
+testErrors()
+{
+  CHECK(tft.setVirtualSize(1276, 720) == RA8876_ERROR_PARAMETER);
+  CHECK(tft.setVirtualSize(1280, 719) == RA8876_ERROR_PARAMETER);
+  CHECK(tft.setVirtualSize(4096, 4000) == RA8876_ERROR_MEMORY);
+  CHECK(tft.getVirtualWidth() == 1280);
+
+  // back to the screen size: nothing left to scroll
+  CHECK(tft.setVirtualSize(1280, 720) == RA8876_OK);
+  tft.scrollTo(100, 100);
+  CHECK((tft.getScrollX() == 0) && (tft.getScrollY() == 0));
+}
+
+int
+main()
+{
+  CHECK(tft.init());
+  tft.clearScreen(Color::Black);
+
+  printf("scroll\n");
+
+  testScroll();
+  testPages();
+  testErrors();
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  return testDone("scroll");
+}
+
+//--------------------------------------------------------------------------
@@ -0,0 +1,233 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// sprites: png images encoded by tools/ra8876-sprite.py (make-sprites.py
+// writes them) and decoded by drawSprite() land on screen exactly like
+// their pixels written through the memory port, also when clipped; a
+// corrupt stream is rejected
+
+#include "host-test.h"
+
+#if RA8876_COLOR_DEPTH != 16
+#error "the sprites are compiled for 16bpp (see the Makefile)"
+#endif
+
+#include "sprites.h"
+#include "sprites-ref.h"
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+// reference images are drawn this far to the right of the sprites
+#define REF_DX              640
+
+// stripes under the sprites, so that transparent pixels show
+static void
+background(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+  for (uint16_t j = 0; j < h; j += 4)
+    tft.bteSolidFill(x, y + j, w, ((h - j) < 4) ? (h - j) : 4, ((j / 4) & 1) ? Color(40, 40, 40) : Color(0, 60, 60));
+}
+
+// the pixels with alpha of 128 and above, through the memory port
+static void
+reference(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *rgba)
+{
+  Color row[300];
+
+  for (uint16_t j = 0; j < h; j++)
+  {
+    uint16_t i = 0;
+    while (i < w)
+    {
+      uint16_t n = 0;
+      while (((i + n) < w) && (rgba[((j * w) + i + n) * 4 + 3] >= 128))
+      {
+        const uint8_t *p = &rgba[((j * w) + i + n) * 4];
+        row[n++] = Color(p[0], p[1], p[2]);
+      }
+      if (n > 0) tft.putPixels(x + i, y + j, row, n);
+      i += n + ((n == 0) ? 1 : 0);
+    }
+  }
+}
+
+// sprite at (x, y), reference at (x + REF_DX, y), both with a margin of
+// background around them
+static bool
+roundTrip(const RA8876Sprite *sprite, const uint8_t *rgba, uint16_t x, uint16_t y)
+{
+  background(x - 2, y - 2, sprite->width + 4, sprite->height + 4);
+  background(x + REF_DX - 2, y - 2, sprite->width + 4, sprite->height + 4);
+
+  if (tft.drawSprite(x, y, sprite) != RA8876_OK) return false;
+  reference(x + REF_DX, y, sprite->width, sprite->height, rgba);
+  tft.flush();
+
+  return testCompare(x - 2, y - 2, x + REF_DX - 2, y - 2, sprite->width + 4, sprite->height + 4) == 0;
+}
+
+//--------------------------------------------------------------------------
+// round trip
+
+static void
+testRoundTrip()
+{
+  // the long runs are in the 16 bit count form, opaque and transparent
+  CHECK(runs_data[0] == 0xff);
+  CHECK(runs_data[4] == 0xff);
+  CHECK(span.transparent != RA8876_SPRITE_OPAQUE);
+
+  CHECK(roundTrip(&span,  span_rgba,  20,  20));
+  CHECK(roundTrip(&runs,  runs_rgba,  20,  60));
+  CHECK(roundTrip(&mixed, mixed_rgba, 20, 100));
+
+  // the transparent run across rows 2 .. 6 of span left the stripes
+  CHECK(PIXEL(20 + 35, 20 + 4) == PIXEL(20 + REF_DX + 35, 20 + 4));
+  CHECK(PIXEL(20 + 35, 20 + 4) != testRGB(Color(250, 20, 20)));
+}
+
+//--------------------------------------------------------------------------
+// clipping
+
+// pixels of (x, y, w, h) outside the clip box that differ from the
+// untouched background at (bx, by)
+static int
+outsideClip(uint16_t x, uint16_t y, uint16_t w, uint16_t h, RA8876Rect box, uint16_t bx, uint16_t by)
+{
+  int bad = 0;
+  for (int j = 0; j < h; j++)
+    for (int i = 0; i < w; i++)
+    {
+      if (((x + i) >= box.x) && ((x + i) < (box.x + box.w)) &&
+          ((y + j) >= box.y) && ((y + j) < (box.y + box.h))) continue;
+      if (PIXEL(x + i, y + j) != PIXEL(bx + i, by + j)) bad++;
+    }
+  return bad;
+}
+
+static void
+testClip()
+{
+  RA8876Rect box  = {  30, 200, 20, 12 };
+  RA8876Rect run  = { 120, 400, 100,  3 };
+
+  // a clip region inside the sprite
+  background(20,  190, mixed.width, mixed.height);
+  background(360, 190, mixed.width, mixed.height);
+  background(20 + REF_DX, 190, mixed.width, mixed.height);
+  reference(20 + REF_DX, 190, mixed.width, mixed.height, mixed_rgba);
+
+  CHECK(tft.pushClip(box) == RA8876_OK);
+  CHECK(tft.drawSprite(20, 190, &mixed) == RA8876_OK);
+  CHECK(tft.popClip() == RA8876_OK);
+  tft.flush();
+
+  CHECK(testCompare(box.x, box.y, box.x + REF_DX, box.y, box.w, box.h) == 0);
+  CHECK(outsideClip(20, 190, mixed.width, mixed.height, box, 360, 190) == 0);
+
+  // long runs (bte fills) cut by a clip region that starts part way in
+  background(20,  398, runs.width, 6);
+  background(360, 398, runs.width, 6);
+  background(20 + REF_DX, 398, runs.width, 6);
+  reference(20 + REF_DX, 399, runs.width, runs.height, runs_rgba);
+
+  CHECK(tft.pushClip(run) == RA8876_OK);
+  CHECK(tft.drawSprite(20, 399, &runs) == RA8876_OK);
+  CHECK(tft.popClip() == RA8876_OK);
+  tft.flush();
+
+  CHECK(testCompare(run.x, run.y, run.x + REF_DX, run.y, run.w, run.h) == 0);
+  CHECK(outsideClip(20, 398, runs.width, 6, run, 360, 398) == 0);
+
+  // the screen edge: the part that fits, nothing wraps to the left
+  background(1240, 700, 40, 20);
+  background(660,  300, mixed.width, mixed.height);
+  reference(660, 300, mixed.width, mixed.height, mixed_rgba);
+  CHECK(tft.drawSprite(1240, 700, &mixed) == RA8876_OK);
+  tft.flush();
+
+  CHECK(testCompare(1240, 700, 660, 300, 40, 20) == 0);
+  CHECK(testCompare(0, 700, 0, 600, 64, 20) == 0);
+  CHECK(PIXEL(0, 700) == 0);
+}
+
+//--------------------------------------------------------------------------
+// corrupt streams
+
+static void
+testCorrupt()
+{
+  RA8876Sprite bad;
+  uint8_t      data[8];
+  uint32_t     n, rejected;
+
+  // every stream cut short: part way into an op or at an op boundary
+  bad      = span;
+  rejected = 0;
+  for (n = 0; n < span.size; n++)
+  {
+    bad.size = n;
+    if (tft.drawSprite(400, 20, &bad) == RA8876_ERROR_PARAMETER) rejected++;
+  }
+  CHECK(rejected == span.size);
+
+  bad = runs;
+  for (n = 0; n < runs.size; n++)
+  {
+    bad.size = n;
+    CHECK(tft.drawSprite(400, 60, &bad) == RA8876_ERROR_PARAMETER);
+  }
+
+  // an index past the palette
+  bad        = span;
+  data[0]    = 0x00;
+  data[1]    = (uint8_t)span.colors;
+  bad.data   = data;
+  bad.size   = 2;
+  CHECK(tft.drawSprite(400, 20, &bad) == RA8876_ERROR_PARAMETER);
+
+  // a run of an index past the palette, long and short form
+  bad        = runs;
+  data[0]    = 0xff; data[1] = 0x58; data[2] = 0x02; data[3] = (uint8_t)runs.colors;
+  bad.data   = data;
+  bad.size   = 4;
+  CHECK(tft.drawSprite(400, 60, &bad) == RA8876_ERROR_PARAMETER);
+  data[0]    = 0x85;
+  data[1]    = 0xfe;
+  bad.size   = 2;
+  CHECK(tft.drawSprite(400, 60, &bad) == RA8876_ERROR_PARAMETER);
+
+  // no sprite, no palette, no colours
+  CHECK(tft.drawSprite(400, 20, NULL) == RA8876_ERROR_PARAMETER);
+  bad = span; bad.palette = NULL;
+  CHECK(tft.drawSprite(400, 20, &bad) == RA8876_ERROR_PARAMETER);
+  bad = span; bad.colors = 0;
+  CHECK(tft.drawSprite(400, 20, &bad) == RA8876_ERROR_PARAMETER);
+
+  // the driver is still in step with the chip
+  CHECK(ra8876Emulator.protocolErrors == 0);
+  CHECK(tft.verifyShadow() == 0);
+  CHECK(roundTrip(&span, span_rgba, 20, 500));
+}
+
+int
+main()
+{
+  CHECK(tft.init());
+  tft.clearScreen(Color::Black);
+
+  printf("sprite\n");
+
+  testRoundTrip();
+  testClip();
+  testCorrupt();
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  return testDone("sprite");
+}
+
+//--------------------------------------------------------------------------
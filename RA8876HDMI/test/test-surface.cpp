@@ -0,0 +1,194 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// surfaces: handed out top down, aligned, with a stride of a multiple of
+// 4 pixels; freeing joins the free blocks again and the usage report
+// follows. the display pages and the surfaces keep out of each other,
+// and running out of memory or slots is refused without a trace
+
+#include "host-test.h"
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+static uint32_t pageSize;
+
+static bool
+sameStats(const RA8876SurfaceStats &a, const RA8876SurfaceStats &b)
+{
+  return (a.total == b.total) && (a.used == b.used) && (a.largest == b.largest) &&
+         (a.surfaces == b.surfaces) && (a.freeBlocks == b.freeBlocks) && (a.fragmentation == b.fragmentation);
+}
+
+//--------------------------------------------------------------------------
+// placement
+
+static void
+testPlacement()
+{
+  const RA8876Surface *a, *b, *c, *d;
+  RA8876SurfaceStats   base, st;
+
+  base = tft.getSurfaceStats();
+  CHECK(base.total == defaultRamInfo.sz - pageSize);
+  CHECK(base.freeBlocks == 1);
+  CHECK(base.fragmentation == 0);
+
+  // the stride is a multiple of 4 pixels, the start aligned
+  a = tft.allocSurface(101, 10);
+  CHECK(a != NULL);
+  if (a == NULL) return;
+  CHECK((a->stride == 104) && (a->width == 101) && (a->height == 10));
+  CHECK(a->size == 104 * 10 * RA8876PixelFormat::bytes);
+  CHECK((a->addr & (RA8876_SURFACE_ALIGN - 1)) == 0);
+  CHECK(a->addr >= pageSize);
+
+  // the next one right below it
+  b = tft.allocSurface(64, 64);
+  c = tft.allocSurface(33, 7);
+  CHECK((b != NULL) && (c != NULL));
+  if ((b == NULL) || (c == NULL)) return;
+  CHECK((b->addr + b->size) <= a->addr);
+  CHECK((a->addr - (b->addr + b->size)) < RA8876_SURFACE_ALIGN);
+  CHECK((c->addr + c->size) <= b->addr);
+  CHECK((c->addr & (RA8876_SURFACE_ALIGN - 1)) == 0);
+
+  st = tft.getSurfaceStats();
+  CHECK(st.surfaces == base.surfaces + 3);
+  CHECK(st.used == base.used + a->size + b->size + c->size);
+  CHECK(st.freeBlocks == 1);
+
+  // a hole in the middle is reported as fragmentation
+  CHECK(tft.freeSurface(b) == RA8876_OK);
+  st = tft.getSurfaceStats();
+  CHECK(st.freeBlocks == 2);
+  CHECK(st.fragmentation > 0);
+  CHECK(st.largest == c->addr - pageSize);
+
+  // and filled again by the next surface that fits
+  d = tft.allocSurface(64, 32);
+  CHECK(d != NULL);
+  if (d == NULL) return;
+  CHECK((d->addr >= c->addr + c->size) && ((d->addr + d->size) <= a->addr));
+  CHECK(tft.freeSurface(d) == RA8876_OK);
+
+  // freeing the neighbours joins the blocks again
+  CHECK(tft.freeSurface(a) == RA8876_OK);
+  st = tft.getSurfaceStats();
+  CHECK(st.freeBlocks == 2);
+  CHECK(tft.freeSurface(c) == RA8876_OK);
+  CHECK(sameStats(tft.getSurfaceStats(), base));
+
+  // a surface only goes back once
+  CHECK(tft.freeSurface(c) == RA8876_ERROR_PARAMETER);
+  CHECK(tft.freeSurface(NULL) == RA8876_ERROR_PARAMETER);
+}
+
+//--------------------------------------------------------------------------
+// out of memory, out of slots
+
+static void
+testRefused()
+{
+  const RA8876Surface *s[RA8876_SURFACES];
+  RA8876SurfaceStats   base;
+  int                  n;
+
+  base = tft.getSurfaceStats();
+
+  // larger than the largest free block, empty or of another depth
+  CHECK(tft.allocSurface(4000, 4000) == NULL);
+  CHECK(tft.allocSurface(1280, (base.largest / (1280 * RA8876PixelFormat::bytes)) + 1) == NULL);
+  CHECK(tft.allocSurface(0, 10) == NULL);
+  CHECK(tft.allocSurface(10, 0) == NULL);
+  CHECK(tft.allocSurface(10, 10, (RA8876_COLOR_DEPTH == 8) ? 16 : 8) == NULL);
+  CHECK(sameStats(tft.getSurfaceStats(), base));
+
+  // the largest block fits exactly
+  s[0] = tft.allocSurface(1280, base.largest / (1280 * RA8876PixelFormat::bytes));
+  CHECK(s[0] != NULL);
+  CHECK(tft.allocSurface(1280, 1) == NULL);
+  CHECK(tft.freeSurface(s[0]) == RA8876_OK);
+
+  // every slot taken
+  for (n = 0; n < RA8876_SURFACES; n++)
+  {
+    s[n] = tft.allocSurface(16, 16);
+    if (s[n] == NULL) break;
+  }
+  CHECK(n == RA8876_SURFACES - base.surfaces);
+  CHECK(tft.allocSurface(16, 16) == NULL);
+  while (n-- > 0) CHECK(tft.freeSurface(s[n]) == RA8876_OK);
+
+  CHECK(sameStats(tft.getSurfaceStats(), base));
+}
+
+//--------------------------------------------------------------------------
+// the display pages
+
+static void
+testPages()
+{
+  const RA8876Surface *s;
+  RA8876SurfaceStats   base, st;
+  uint16_t             lines;
+
+  base = tft.getSurfaceStats();
+
+  // a surface reaching below where a second page would end
+  lines = (base.largest - (pageSize / 2)) / (1280 * RA8876PixelFormat::bytes);
+  s     = tft.allocSurface(1280, lines);
+  CHECK(s != NULL);
+  if (s == NULL) return;
+  CHECK(s->addr < 2 * pageSize);
+
+  CHECK(tft.setDoubleBuffer(true)          == RA8876_ERROR_MEMORY);
+  CHECK(tft.setVirtualSize(1280, 720 * 2)  == RA8876_ERROR_MEMORY);
+  CHECK(tft.getVirtualHeight() == 720);
+
+  // drawing on the page carries on
+  tft.fillRectangle(0, 0, 9, 9, Color::Red);
+  tft.flush();
+  CHECK(tft.verifyShadow() == 0);
+  CHECK(tft.freeSurface(s) == RA8876_OK);
+
+  // with two pages the surfaces start above the second one
+  CHECK(tft.setDoubleBuffer(true) == RA8876_OK);
+  st = tft.getSurfaceStats();
+  CHECK(st.total == base.total - pageSize);
+  CHECK(st.largest == base.largest - pageSize);
+
+  s = tft.allocSurface(1280, st.largest / (1280 * RA8876PixelFormat::bytes));
+  CHECK(s != NULL);
+  if (s != NULL)
+  {
+    CHECK(s->addr >= 2 * pageSize);
+    CHECK(tft.freeSurface(s) == RA8876_OK);
+  }
+  CHECK(tft.allocSurface(1280, (st.largest / (1280 * RA8876PixelFormat::bytes)) + 1) == NULL);
+
+  CHECK(tft.setDoubleBuffer(false) == RA8876_OK);
+  CHECK(sameStats(tft.getSurfaceStats(), base));
+}
+
+int
+main()
+{
+  CHECK(tft.init());
+
+  printf("surface\n");
+
+  pageSize = (uint32_t)tft.getVirtualWidth() * tft.getVirtualHeight() * RA8876PixelFormat::bytes;
+
+  testPlacement();
+  testRefused();
+  testPages();
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  return testDone("surface");
+}
+
+//--------------------------------------------------------------------------
@@ -0,0 +1,70 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// text runs: a row of columns drawn in one text mode session matches the
+// same columns drawn one by one, in fewer bytes and without a protocol
+// error when status reads for the write FIFO interleave the characters
+
+#include "host-test.h"
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+static const uint16_t    cols[]  = { 50, 150, 300, 600, 700 };
+static const char       *texts[] = { "14", "METRO", "Hasselby strand via Centralen", "12:34", "3 min" };
+
+int
+main()
+{
+  TestCost run, single;
+
+  CHECK(tft.init());
+  tft.setFont(RA8876_FONT_SIZE_32);
+  tft.clearScreen(Color::Black);
+
+  printf("text\n");
+
+  // one run for the whole row
+  ra8876Emulator.resetStats();
+  testBegin(tft);
+  CHECK(tft.beginText() == RA8876_OK);
+  for (int c = 0; c < 5; c++)
+    CHECK(tft.drawTextAt(cols[c], 100, (c == 0) ? Color::Yellow : Color::White, texts[c]) == RA8876_OK);
+  CHECK(tft.endText() == RA8876_OK);
+  run = testEnd(tft, "row as a text run");
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  // the same row, column by column
+  testBegin(tft);
+  for (int c = 0; c < 5; c++)
+  {
+    tft.setTextColor((c == 0) ? Color::Yellow : Color::White);
+    tft.setTextCursor(cols[c], 300);
+    tft.putChars(texts[c], strlen(texts[c]));
+  }
+  single = testEnd(tft, "row column by column");
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  CHECK(testCompare(0, 100, 0, 300, 1280, 40) == 0);
+  CHECK(PIXEL(0, 100) == 0);
+  CHECK(run.bytes < single.bytes);
+
+  // the status reads between characters leave the memory port selected:
+  // characters that follow one go out as data cycles only and still land
+  testBegin(tft);
+  tft.drawTextAt(50, 500, Color::White, "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA");
+  testEnd(tft, "40 characters");
+  tft.setTextColor(Color::White);
+  tft.setTextCursor(50, 600);
+  for (int i = 0; i < 40; i++) tft.putChars("A", 1);
+  tft.flush();
+  CHECK(testCompare(0, 500, 0, 600, 1280, 40) == 0);
+  CHECK(ra8876Emulator.protocolErrors == 0);
+  CHECK(tft.verifyShadow() == 0);
+
+  return testDone("text");
+}
+
+//--------------------------------------------------------------------------
@@ -0,0 +1,219 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// utf-8: transcodeUtf8() and print() turn broken sequences into one
+// replacement character each, map code points through the font table of
+// the encoding and pass Latin 1 through unchanged; long Swedish text is
+// benchmarked against a character at a time
+
+#include "host-test.h"
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+// transcodes src and compares with the expected font bytes
+static bool
+transcode(const char *src, const char *want)
+{
+  char   dst[64];
+  size_t n;
+
+  n = tft.transcodeUtf8(src, dst, sizeof(dst));
+  if ((n == strlen(want)) && (strcmp(dst, want) == 0)) return true;
+
+  printf("  transcode: got \"");
+  for (size_t i = 0; i < n; i++) printf("\\x%02x", (uint8_t)dst[i]);
+  printf("\"\n");
+  return false;
+}
+
+//--------------------------------------------------------------------------
+// Latin 1: code points U+00A0 .. U+00FF are the font bytes
+
+static void
+testLatin1()
+{
+  char   dst[8];
+
+  tft.setFont(RA8876_FONT_SIZE_32, RA8876_FONT_ENCODING_8859_1);
+
+  CHECK(transcode("abc",                      "abc"));
+  CHECK(transcode("caf\xC3\xA9",              "caf\xE9"));
+  CHECK(transcode("\xC2\xA0\xC3\xBF",         "\xA0\xFF"));
+
+  // code points the font lacks: C1 controls, the euro sign, Cyrillic
+  CHECK(transcode("\xC2\x80",                 "?"));
+  CHECK(transcode("\xE2\x82\xAC",             "?"));
+  CHECK(transcode("\xD0\x96",                 "?"));
+
+  // 4 byte sequences are outside every font: one replacement each
+  CHECK(transcode("\xF0\x9F\x98\x80",         "?"));
+  CHECK(transcode("a\xF0\x9F\x98\x80z",       "a?z"));
+
+  // truncated sequences: at the end, before ASCII, before another lead
+  CHECK(transcode("ab\xC3",                   "ab?"));
+  CHECK(transcode("\xE2\x82",                 "?"));
+  CHECK(transcode("\xC3" "A",                 "?A"));
+  CHECK(transcode("\xE2\x82" "B",             "?B"));
+  CHECK(transcode("\xF0\x9F\x98" "C",         "?C"));
+  CHECK(transcode("\xC3\xC3\xA9",             "?\xE9"));
+
+  // stray continuation bytes and invalid lead bytes
+  CHECK(transcode("\xA9x",                    "?x"));
+  CHECK(transcode("\x80\x80",                 "??"));
+  CHECK(transcode("\xC3\xA9\xA9",             "\xE9?"));
+  CHECK(transcode("\xF8\xFF" "d",             "??d"));
+
+  tft.setReplacementChar('#');
+  CHECK(transcode("\xC3" "A\xE2\x82\xAC",     "#A#"));
+  tft.setReplacementChar('?');
+
+  // the destination is always terminated, even when too small
+  CHECK(tft.transcodeUtf8("caf\xC3\xA9", dst, 4) == 3);
+  CHECK(strcmp(dst, "caf") == 0);
+  CHECK(tft.transcodeUtf8("abc", dst, 1) == 0);
+  CHECK(dst[0] == 0);
+  CHECK(tft.transcodeUtf8(NULL, dst, sizeof(dst)) == 0);
+  CHECK(tft.transcodeUtf8("abc", NULL, 0) == 0);
+}
+
+//--------------------------------------------------------------------------
+// the other encodings: looked up in the font table, Latin 1 code points
+// only pass where the table has them
+
+static void
+testFontTable()
+{
+  tft.setFont(RA8876_FONT_SIZE_32, RA8876_FONT_ENCODING_8859_5);
+
+  CHECK(transcode("\xD0\x96",                 "\xB6"));       // U+0416
+  CHECK(transcode("\xD1\x8F",                 "\xEF"));       // U+044F
+  CHECK(transcode("\xE2\x84\x96",             "\xF0"));       // U+2116
+  CHECK(transcode("\xC2\xA7\xC2\xA0",         "\xFD\xA0"));   // U+00A7 U+00A0
+  CHECK(transcode("\xC3\xA9",                 "?"));          // not in 8859-5
+  CHECK(transcode("\xD0\x96\xC3" "A",         "\xB6?A"));
+
+  tft.setFont(RA8876_FONT_SIZE_32, RA8876_FONT_ENCODING_8859_2);
+
+  CHECK(transcode("\xC5\x81\xC3\xA9",         "\xA3\xE9"));   // U+0141 U+00E9
+  CHECK(transcode("\xC3\xA0",                 "?"));          // U+00E0 is 0xE0 in Latin 1 only
+
+  tft.setFont(RA8876_FONT_SIZE_32, RA8876_FONT_ENCODING_8859_1);
+}
+
+//--------------------------------------------------------------------------
+// print() decodes the same way, also when a sequence is split across
+// calls
+
+static void
+testPrint()
+{
+  static const char *want = "caf\xE9?A?B?\xE9?x";
+
+  tft.clearScreen(Color::Black);
+  tft.setTextColor(Color::White);
+
+  // the font bytes, written as they are
+  tft.setTextCursor(0, 0);
+  tft.putChars(want, strlen(want));
+
+  tft.setTextCursor(0, 100);
+  tft.print("caf\xC3");
+  tft.print("\xA9\xC3" "A\xE2\x82" "B\xC3\xC3");
+  tft.print("\xA9\xA9x");
+  tft.flush();
+
+  CHECK(testCompare(0, 0, 0, 200, 1280, 40) != 0);
+  CHECK(testCompare(0, 0, 0, 100, 1280, 40) == 0);
+  CHECK(tft.getTextCursorX() == tft.getTextWidth(want));
+  CHECK(tft.getWriteError() == 0);
+}
+
+//--------------------------------------------------------------------------
+// throughput: long Swedish text through print(), through transcodeUtf8()
+// and putChars(), and a character at a time through putChar() as before
+// the decoder
+
+static const char *swedish[] =
+{
+  "N\xC3\xA4sta t\xC3\xA5g mot H\xC3\xA4sselby strand g\xC3\xA5r fr\xC3\xA5n sp\xC3\xA5r tv\xC3\xA5 om tre minuter",
+  "\xC3\x96stermalmstorg, R\xC3\xA5" "dmansgatan, S\xC3\xB6" "dermalm och M\xC3\xA4larh\xC3\xB6jden",
+  "F\xC3\xB6rseningar p\xC3\xA5 gr\xC3\xB6na linjen efter v\xC3\xA4xelfel vid Gullmarsplan",
+  "R\xC3\xA4ksm\xC3\xB6rg\xC3\xA5s, \xC3\xA5sn\xC3\xA4tet \xC3\xA4r \xC3\xB6ppet, \xC3\xB6l och \xC3\xA4ppelm\xC3\xB6s p\xC3\xA5 \xC3\xA5n",
+};
+
+#define SWEDISH_LINES       (sizeof(swedish) / sizeof(swedish[0]))
+
+static void
+testBench()
+{
+  TestCost printed, transcoded, single;
+  char     line[128];
+  size_t   n;
+  uint32_t bytes;
+
+  tft.clearScreen(Color::Black);
+  tft.setTextColor(Color::White);
+
+  bytes = 0;
+  for (size_t l = 0; l < SWEDISH_LINES; l++) bytes += strlen(swedish[l]);
+  printf("  %u bytes of UTF-8 in %u lines\n", bytes, (unsigned)SWEDISH_LINES);
+
+  // print(): decoded as it goes, one text run a call
+  testBegin(tft);
+  for (size_t l = 0; l < SWEDISH_LINES; l++)
+  {
+    tft.setTextCursor(0, 20 + l * 40);
+    tft.print(swedish[l]);
+  }
+  printed = testEnd(tft, "print()");
+
+  // transcoded on the host first, then one text run a line
+  testBegin(tft);
+  for (size_t l = 0; l < SWEDISH_LINES; l++)
+  {
+    n = tft.transcodeUtf8(swedish[l], line, sizeof(line));
+    tft.setTextCursor(0, 220 + l * 40);
+    tft.putChars(line, n);
+  }
+  transcoded = testEnd(tft, "transcodeUtf8() + putChars()");
+
+  // a text mode session per character
+  testBegin(tft);
+  for (size_t l = 0; l < SWEDISH_LINES; l++)
+  {
+    n = tft.transcodeUtf8(swedish[l], line, sizeof(line));
+    tft.setTextCursor(0, 420 + l * 40);
+    for (size_t i = 0; i < n; i++) tft.putChar(line[i]);
+  }
+  single = testEnd(tft, "putChar() per character");
+
+  CHECK(testCompare(0, 20, 0, 220, 1280, SWEDISH_LINES * 40) == 0);
+  CHECK(testCompare(0, 20, 0, 420, 1280, SWEDISH_LINES * 40) == 0);
+  CHECK(testCompare(0, 20, 0, 620, 1280, 40) != 0);
+  CHECK(printed.bytes    < single.bytes);
+  CHECK(transcoded.bytes < single.bytes);
+  CHECK(printed.us       < single.us);
+  CHECK(tft.getWriteError() == 0);
+}
+
+int
+main()
+{
+  CHECK(tft.init());
+
+  printf("utf8\n");
+
+  testLatin1();
+  testFontTable();
+  testPrint();
+  testBench();
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  return testDone("utf8");
+}
+
+//--------------------------------------------------------------------------
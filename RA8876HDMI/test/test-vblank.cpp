@@ -0,0 +1,177 @@
+//--------------------------------------------------------------------------
+// Copyright 2024, RIoT Secure AB
+//
+// @author Aaron Ardiri
+//--------------------------------------------------------------------------
+
+// vertical blank: the frame and blank periods the driver works out match
+// the refresh of the emulated chip, which follows the programmed timing
+// registers. the blank budget ends where the scan reaches the first
+// visible pixel, a sync off the predicted one is still caught, and
+// beginFrame() keeps a steady rate
+
+#include "host-test.h"
+
+RA8876 tft(RA8876_CS, RA8876_RESET);
+
+// one poll of the sync flag: the pause between polls and an INTF read at
+// RA8876_SPI_SPEED; the sync is seen (and placed) within this
+#define POLL_US             (RA8876_VBLANK_POLL + 40)
+
+// us into the current refresh period of the emulated chip
+static uint32_t
+scanPhase()
+{
+  return (uint32_t)((ra8876Emulator.scanTime() % ra8876Emulator.frameTime) / 1000);
+}
+
+static uint32_t
+distance(uint32_t a, uint32_t b)
+{
+  return (a > b) ? (a - b) : (b - a);
+}
+
+//--------------------------------------------------------------------------
+// periods
+
+static void
+testPeriods()
+{
+  uint32_t lines;
+
+  printf("  frame %u us, blank %u us (emulator %u ns, %u ns)\n",
+         tft.getFrameTime(), tft.getBlankTime(), ra8876Emulator.frameTime, ra8876Emulator.blankTime);
+
+  CHECK(distance(tft.getFrameTime(), ra8876Emulator.frameTime / 1000) <= 1);
+  CHECK(distance(tft.getBlankTime(), ra8876Emulator.blankTime / 1000) <= 1);
+
+  // the front porch is part of the blank: more than the sync pulse and
+  // back porch lines alone
+  lines = defaultDisplayInfo.vPulseWidth + defaultDisplayInfo.vBackPorch;
+  CHECK(tft.getBlankTime() > (uint32_t)(((uint64_t)tft.getFrameTime() * lines) /
+                                        (defaultDisplayInfo.height + lines)));
+}
+
+//--------------------------------------------------------------------------
+// waitForVBlank() and the blank budget
+
+static void
+testBlank()
+{
+  uint32_t left;
+  TestCost c;
+
+  // the first wait polls the flag
+  CHECK(tft.waitForVBlank() == RA8876_OK);
+  CHECK(ra8876Emulator.inBlank());
+  CHECK(scanPhase() <= 2 * POLL_US);
+
+  // the next sleeps towards the predicted sync and only polls near it
+  testBegin(tft);
+  CHECK(tft.waitForVBlank() == RA8876_OK);
+  c = testEnd(tft, "predicted wait");
+  CHECK(ra8876Emulator.inBlank());
+  CHECK(scanPhase() <= 2 * POLL_US);
+  CHECK(c.bytes < ((RA8876_VBLANK_MARGIN / RA8876_VBLANK_POLL) + 10) * 3);
+
+  // the time left agrees with the scan and never runs past it
+  left = tft.getBlankTimeLeft();
+  CHECK(left <= ra8876Emulator.blankLeft() / 1000);
+  CHECK(left + POLL_US >= ra8876Emulator.blankLeft() / 1000);
+
+  delayMicroseconds(left / 2);
+  left = tft.getBlankTimeLeft();
+  CHECK(left <= ra8876Emulator.blankLeft() / 1000);
+  CHECK(left + POLL_US >= ra8876Emulator.blankLeft() / 1000);
+
+  // the budget runs out just before the first visible pixel is scanned
+  delayMicroseconds(left);
+  CHECK(tft.getBlankTimeLeft() == 0);
+  CHECK(ra8876Emulator.inBlank());
+  CHECK(ra8876Emulator.blankLeft() / 1000 <= POLL_US);
+}
+
+//--------------------------------------------------------------------------
+// drift: the refresh moves against the prediction
+
+static void
+testDrift()
+{
+  uint64_t start;
+  uint32_t left;
+
+  // the sync comes 1 ms before the predicted one, while the driver is
+  // still sleeping towards it: it is caught when the sleep ends, not a
+  // frame later, and the time left is not over estimated
+  ra8876Emulator.scanShift += 1000000;
+  start = ra8876Emulator.now;
+  CHECK(tft.waitForVBlank() == RA8876_OK);
+  CHECK((ra8876Emulator.now - start) < ra8876Emulator.frameTime);
+  CHECK(ra8876Emulator.inBlank());
+  left = tft.getBlankTimeLeft();
+  CHECK(left <= ra8876Emulator.blankLeft() / 1000);
+
+  // the next wait is back in step
+  CHECK(tft.waitForVBlank() == RA8876_OK);
+  CHECK(ra8876Emulator.inBlank());
+  CHECK(scanPhase() <= 2 * POLL_US);
+
+  // the sync comes 1 ms after the predicted one: polled for
+  delayMicroseconds(5000);
+  ra8876Emulator.scanShift -= 1000000;
+  start = ra8876Emulator.now;
+  CHECK(tft.waitForVBlank() == RA8876_OK);
+  CHECK((ra8876Emulator.now - start) < ra8876Emulator.frameTime);
+  CHECK(ra8876Emulator.inBlank());
+  CHECK(scanPhase() <= 2 * POLL_US);
+  left = tft.getBlankTimeLeft();
+  CHECK(left <= ra8876Emulator.blankLeft() / 1000);
+  CHECK(left + POLL_US >= ra8876Emulator.blankLeft() / 1000);
+}
+
+//--------------------------------------------------------------------------
+// pacing: a row update each frame
+
+static void
+testPacing()
+{
+  RA8876FrameStats st;
+  Color            row[256];
+
+  for (int i = 0; i < 256; i++) row[i] = Color(i, 255 - i, 128);
+
+  tft.resetFrameStats();
+  for (int f = 0; f < 120; f++)
+  {
+    CHECK(tft.beginFrame() == RA8876_OK);
+    tft.putPixels(f, 100, row, 256);
+  }
+  st = tft.getFrameStats();
+
+  printf("  %u frames, %u missed, last %u us, worst error %u us\n",
+         st.frames, st.missed, st.lastUs, st.maxErrorUs);
+
+  CHECK(st.frames == 120);
+  CHECK(st.missed == 0);
+  CHECK(distance(st.lastUs, tft.getFrameTime()) <= POLL_US);
+  CHECK(st.maxErrorUs <= POLL_US);
+}
+
+int
+main()
+{
+  CHECK(tft.init());
+
+  printf("vblank\n");
+
+  testPeriods();
+  testBlank();
+  testDrift();
+  testPacing();
+
+  CHECK(ra8876Emulator.protocolErrors == 0);
+
+  return testDone("vblank");
+}
+
+//--------------------------------------------------------------------------
@@ -0,0 +1,270 @@
+#!/usr/bin/env python3
+#--------------------------------------------------------------------------
+# Copyright 2024, RIoT Secure AB
+#
+# @author Aaron Ardiri
+#--------------------------------------------------------------------------
+
+# compiles png images into RA8876Sprite definitions for drawSprite(): every
+# image becomes a palette of its colours and a run-length encoded stream of
+# palette indices (format described with RA8876Sprite in ra8876.h)
+#
+#   ra8876-sprite.py -o sprites.h metro.png bus.png train.png
+#
+# colours are reduced to the precision of the driver colour depth first so
+# that shades the display cannot tell apart share a palette entry. pixels
+# with alpha below 128 become the transparent index. only the python
+# standard library is used.
+
+import argparse
+import os
+import re
+import struct
+import sys
+import zlib
+
+#--------------------------------------------------------------------------
+# png decoding
+
+PNG_SIGNATURE = b'\x89PNG\r\n\x1a\n'
+
+def paeth(a, b, c):
+  p  = a + b - c
+  pa = abs(p - a)
+  pb = abs(p - b)
+  pc = abs(p - c)
+  if (pa <= pb) and (pa <= pc): return a
+  if pb <= pc: return b
+  return c
+
+def unfilter(raw, width, height, bpp, stride):
+  rows = []
+  prev = bytearray(stride)
+  pos  = 0
+  for y in range(height):
+    ftype = raw[pos]
+    line  = bytearray(raw[pos + 1:pos + 1 + stride])
+    pos  += 1 + stride
+    for i in range(stride):
+      a = line[i - bpp] if i >= bpp else 0
+      b = prev[i]
+      c = prev[i - bpp] if i >= bpp else 0
+      if   ftype == 1: line[i] = (line[i] + a) & 0xff
+      elif ftype == 2: line[i] = (line[i] + b) & 0xff
+      elif ftype == 3: line[i] = (line[i] + ((a + b) >> 1)) & 0xff
+      elif ftype == 4: line[i] = (line[i] + paeth(a, b, c)) & 0xff
+      elif ftype != 0: raise ValueError('bad filter type %d' % ftype)
+    rows.append(line)
+    prev = line
+  return rows
+
+# returns (width, height, [(r, g, b, a), ...]) in raster order
+def read_png(path):
+  with open(path, 'rb') as f:
+    data = f.read()
+  if data[:8] != PNG_SIGNATURE: raise ValueError('not a png file')
+
+  pos   = 8
+  idat  = b''
+  plte  = None
+  trns  = None
+  ihdr  = None
+  while pos < len(data):
+    length, ctype = struct.unpack('>I4s', data[pos:pos + 8])
+    chunk = data[pos + 8:pos + 8 + length]
+    pos  += 12 + length
+    if   ctype == b'IHDR': ihdr  = struct.unpack('>IIBBBBB', chunk)
+    elif ctype == b'PLTE': plte  = chunk
+    elif ctype == b'tRNS': trns  = chunk
+    elif ctype == b'IDAT': idat += chunk
+    elif ctype == b'IEND': break
+
+  width, height, depth, ctype, _, _, interlace = ihdr
+  if interlace != 0: raise ValueError('interlaced images are not supported')
+  if (ctype != 3) and (depth != 8):
+    raise ValueError('only 8 bit channels are supported (palette images may use 1, 2, 4 or 8 bits)')
+
+  channels = { 0: 1, 2: 3, 3: 1, 4: 2, 6: 4 }[ctype]
+  bits     = channels * depth
+  stride   = (width * bits + 7) // 8
+  rows     = unfilter(zlib.decompress(idat), width, height, max(1, bits // 8), stride)
+
+  pixels = []
+  for line in rows:
+    for x in range(width):
+      if ctype == 3:
+        bit = x * depth
+        i   = (line[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1)
+        a   = trns[i] if (trns is not None) and (i < len(trns)) else 255
+        pixels.append((plte[i * 3], plte[i * 3 + 1], plte[i * 3 + 2], a))
+      elif ctype == 0:
+        v = line[x]
+        a = 0 if (trns is not None) and (v == struct.unpack('>H', trns[:2])[0]) else 255
+        pixels.append((v, v, v, a))
+      elif ctype == 4:
+        v = line[x * 2]
+        pixels.append((v, v, v, line[x * 2 + 1]))
+      elif ctype == 2:
+        r, g, b = line[x * 3:x * 3 + 3]
+        a = 255
+        if (trns is not None) and ((r, g, b) == tuple(v & 0xff for v in struct.unpack('>HHH', trns[:6]))): a = 0
+        pixels.append((r, g, b, a))
+      else:
+        pixels.append(tuple(line[x * 4:x * 4 + 4]))
+  return width, height, pixels
+
+#--------------------------------------------------------------------------
+# colour reduction
+
+# keeps the bits the display has and repeats them into the low bits, so
+# that white stays white
+def reduce_channel(v, bits):
+  if bits >= 8: return v
+  v >>= 8 - bits
+  v <<= 8 - bits
+  return v | (v >> bits)
+
+def reduce_color(rgb, depth):
+  bits = { 8: (3, 3, 2), 16: (5, 6, 5), 24: (8, 8, 8) }[depth]
+  return tuple(reduce_channel(c, n) for c, n in zip(rgb, bits))
+
+#--------------------------------------------------------------------------
+# run-length encoding
+
+def encode(indices):
+  out = bytearray()
+  lit = []
+
+  def literals():
+    while lit:
+      n = min(len(lit), 128)
+      out.append(n - 1)
+      out.extend(lit[:n])
+      del lit[:n]
+
+  i = 0
+  while i < len(indices):
+    n = 1
+    while (i + n < len(indices)) and (indices[i + n] == indices[i]) and (n < 0xffff): n += 1
+
+    # three or more pixels are cheaper as a run
+    if n >= 3:
+      literals()
+      if n <= 128:
+        out.extend((0x80 | (n - 2), indices[i]))
+      else:
+        out.extend((0xff, n & 0xff, n >> 8, indices[i]))
+      i += n
+    else:
+      lit.extend(indices[i:i + n])
+      i += n
+  literals()
+  return bytes(out)
+
+# reference decoder, used to check every encoded image
+def decode(data, count):
+  out = []
+  p   = 0
+  while p < len(data):
+    op = data[p]; p += 1
+    if op < 0x80:
+      out.extend(data[p:p + op + 1]); p += op + 1
+    elif op < 0xff:
+      out.extend([data[p]] * ((op & 0x7f) + 2)); p += 1
+    else:
+      n = data[p] | (data[p + 1] << 8)
+      out.extend([data[p + 2]] * n); p += 3
+  return out[:count]
+
+#--------------------------------------------------------------------------
+# output
+
+def identifier(path):
+  name = os.path.splitext(os.path.basename(path))[0]
+  name = re.sub(r'[^0-9A-Za-z_]', '_', name)
+  if name[0].isdigit(): name = '_' + name
+  return name
+
+def byte_table(data, indent = '  '):
+  lines = []
+  for i in range(0, len(data), 16):
+    lines.append(indent + ', '.join('0x%02x' % b for b in data[i:i + 16]) + ',')
+  return '\n'.join(lines)
+
+def compile_png(path, name, depth):
+  width, height, pixels = read_png(path)
+  if (width > 0xffff) or (height > 0xffff): raise ValueError('image too large')
+
+  palette     = []
+  lookup      = {}
+  transparent = None
+  indices     = []
+  for r, g, b, a in pixels:
+    if a < 128:
+      key = None
+    else:
+      key = reduce_color((r, g, b), depth)
+    if key not in lookup:
+      lookup[key] = len(palette)
+      palette.append(key)
+      if key is None: transparent = lookup[key]
+    indices.append(lookup[key])
+
+  if len(palette) > 256:
+    raise ValueError('%d colours after reduction to %d bpp, at most 256 are possible' % (len(palette), depth))
+
+  data = encode(indices)
+  if decode(data, len(indices)) != indices: raise AssertionError('encoder self check failed')
+
+  rgb = bytearray()
+  for c in palette: rgb.extend(c if c is not None else (0, 0, 0))
+
+  text  = '// %s: %dx%d, %d colours, %d bytes (%d as raw %d bpp pixels)\n' % \
+          (os.path.basename(path), width, height, len(palette), len(rgb) + len(data),
+           width * height * depth // 8, depth)
+  text += 'const uint8_t %s_palette[] =\n{\n%s\n};\n\n' % (name, byte_table(rgb))
+  text += 'const uint8_t %s_data[] =\n{\n%s\n};\n\n' % (name, byte_table(data))
+  text += 'const RA8876Sprite %s =\n{\n' % name
+  text += '  %s_palette, %s_data, sizeof(%s_data),\n' % (name, name, name)
+  text += '  %d, %d, %d, %s\n};\n\n' % (width, height, len(palette),
+                                       'RA8876_SPRITE_OPAQUE' if transparent is None else str(transparent))
+  return text, len(rgb) + len(data), width * height * depth // 8
+
+#--------------------------------------------------------------------------
+# main
+
+def main():
+  parser = argparse.ArgumentParser(description = 'compile png images into RA8876Sprite definitions')
+  parser.add_argument('png', nargs = '+', help = 'images to compile')
+  parser.add_argument('-o', '--output', help = 'header to write (default: standard output)')
+  parser.add_argument('-d', '--depth', type = int, choices = (8, 16, 24), default = 16,
+                      help = 'driver colour depth the colours are reduced to (default: 16)')
+  args = parser.parse_args()
+
+  text  = '//--------------------------------------------------------------------------\n'
+  text += '// generated by ra8876-sprite.py, do not edit\n'
+  text += '//--------------------------------------------------------------------------\n\n'
+  total = 0
+  raw   = 0
+  for path in args.png:
+    try:
+      t, n, r = compile_png(path, identifier(path), args.depth)
+    except (OSError, ValueError) as e:
+      sys.stderr.write('%s: %s\n' % (path, e))
+      return 1
+    text  += t
+    total += n
+    raw   += r
+  text += '//--------------------------------------------------------------------------\n'
+
+  if args.output:
+    with open(args.output, 'w') as f:
+      f.write(text)
+  else:
+    sys.stdout.write(text)
+
+  sys.stderr.write('%d images, %d bytes (%d as raw pixels)\n' % (len(args.png), total, raw))
+  return 0
+
+if __name__ == '__main__':
+  sys.exit(main())